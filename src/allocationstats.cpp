@@ -0,0 +1,140 @@
+#include <atomic>
+#include <new>
+
+#include <stdlib.h>
+
+using namespace std;
+
+#include "allocationstats.h"
+
+#ifdef TRACK_ALLOCATIONS
+static atomic<size_t> allocationCount(0);
+static atomic<size_t> currentBytes(0);
+static atomic<size_t> peakBytes(0);
+
+// NOTE: Each block has its size stored in front of it so that delete knows how much is being
+//       freed. 16 bytes keeps the returned pointer as aligned as malloc's
+static const size_t ALLOCATION_HEADER_SIZE = 16;
+
+static void* trackedAllocate(size_t size)
+{
+    void* block = malloc(size + ALLOCATION_HEADER_SIZE);
+    if(!block)
+    {
+        return 0;
+    }
+    *(size_t*)block = size;
+
+    allocationCount.fetch_add(1, memory_order_relaxed);
+    size_t current = currentBytes.fetch_add(size, memory_order_relaxed) + size;
+    size_t peak = peakBytes.load(memory_order_relaxed);
+    while((current > peak) && !peakBytes.compare_exchange_weak(peak, current, memory_order_relaxed))
+    {
+    }
+    return (char*)block + ALLOCATION_HEADER_SIZE;
+}
+
+static void trackedFree(void* pointer)
+{
+    if(!pointer)
+    {
+        return;
+    }
+    char* block = (char*)pointer - ALLOCATION_HEADER_SIZE;
+    currentBytes.fetch_sub(*(size_t*)block, memory_order_relaxed);
+    free(block);
+}
+
+#endif
+
+AllocationStats allocationStats()
+{
+#ifdef TRACK_ALLOCATIONS
+    AllocationStats stats;
+    stats.allocationCount = allocationCount.load(memory_order_relaxed);
+    stats.currentBytes = currentBytes.load(memory_order_relaxed);
+    stats.peakBytes = peakBytes.load(memory_order_relaxed);
+    return stats;
+#else
+    AllocationStats stats = {};
+    return stats;
+#endif
+}
+
+void resetPeakAllocation()
+{
+#ifdef TRACK_ALLOCATIONS
+    peakBytes.store(currentBytes.load(memory_order_relaxed), memory_order_relaxed);
+#endif
+}
+
+bool allocationTrackingEnabled()
+{
+#ifdef TRACK_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef TRACK_ALLOCATIONS
+
+// The replacements themselves, which route everything through trackedAllocate and trackedFree
+void* operator new(size_t size)
+{
+    void* pointer = trackedAllocate(size);
+    if(!pointer)
+    {
+        throw bad_alloc();
+    }
+    return pointer;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept
+{
+    return trackedAllocate(size);
+}
+
+void* operator new[](size_t size, const nothrow_t&) noexcept
+{
+    return trackedAllocate(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    trackedFree(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    trackedFree(pointer);
+}
+
+void operator delete(void* pointer, const nothrow_t&) noexcept
+{
+    trackedFree(pointer);
+}
+
+void operator delete[](void* pointer, const nothrow_t&) noexcept
+{
+    trackedFree(pointer);
+}
+
+#ifdef __cpp_sized_deallocation
+void operator delete(void* pointer, size_t) noexcept
+{
+    trackedFree(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept
+{
+    trackedFree(pointer);
+}
+#endif
+
+#endif
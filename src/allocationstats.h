@@ -0,0 +1,25 @@
+#ifndef ALLOCATIONSTATS_H
+#define ALLOCATIONSTATS_H
+
+#include <stddef.h>
+
+// Counts of every allocation made through operator new (which is everything the standard
+// containers do), kept by replacing the global operator new and delete. This lets the benchmarks
+// report how much allocating each stage does.
+// NOTE: Every allocation from every thread updates the same shared counters, so the replacement is
+//       only built in with TRACK_ALLOCATIONS defined (make bench builds build/prac1-bench with it).
+//       Without it the counts stay at zero
+struct AllocationStats
+{
+    size_t allocationCount; // Ever made
+    size_t currentBytes;    // Currently allocated
+    size_t peakBytes;       // The most that has been allocated at once
+};
+
+AllocationStats allocationStats();
+// Starts tracking the peak again from the current number of bytes allocated
+void resetPeakAllocation();
+// Whether this build counts allocations at all
+bool allocationTrackingEnabled();
+
+#endif
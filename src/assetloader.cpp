@@ -0,0 +1,174 @@
+#include <iostream>
+
+using namespace std;
+
+#include "assetloader.h"
+
+struct AssetLoadJob
+{
+    string filename;
+    Mesh* mesh;
+    VertexLayout requestedLayout;
+
+    PackedMesh packed;
+    bool loaded;
+
+    AssetLoadJob* next; // In the completed stack
+};
+
+AssetLoader::AssetLoader(int threadCount)
+    : parserThreadCount(1), stopping(false), completed(0), uploadStarted(false), pending(0)
+{
+    if(threadCount <= 0)
+    {
+        threadCount = (int)thread::hardware_concurrency() - 1;
+    }
+    if(threadCount < 1)
+    {
+        threadCount = 1;
+    }
+
+    // NOTE: Each worker's share of the cores, rounded down. With the default one worker per core
+    //       (but one) this is 1, so the whole loader uses about as many threads as there are cores
+    //       rather than hardware_concurrency squared
+    parserThreadCount = (int)thread::hardware_concurrency() / threadCount;
+    if(parserThreadCount < 1)
+    {
+        parserThreadCount = 1;
+    }
+    for(int i=0; i<threadCount; i++)
+    {
+        workers.push_back(thread(&AssetLoader::workerLoop, this));
+    }
+}
+
+AssetLoader::~AssetLoader()
+{
+    stop();
+}
+
+void AssetLoader::loadOBJFile(string filename, Mesh* mesh)
+{
+    AssetLoadJob* job = new AssetLoadJob();
+    job->filename = filename;
+    job->mesh = mesh;
+    job->requestedLayout = mesh->requestedVertexLayout();
+    job->loaded = false;
+    job->next = 0;
+
+    pending++;
+    {
+        lock_guard<mutex> lock(requestMutex);
+        requests.push_back(job);
+    }
+    requestAvailable.notify_one();
+}
+
+int AssetLoader::update(size_t uploadBudget, StreamBuffer* staging)
+{
+    // Take everything the workers have finished in one go. Since it comes off a stack it's newest
+    // first, so it's reversed onto the end of the upload queue
+    AssetLoadJob* finished = completed.exchange(0, memory_order_acquire);
+    size_t firstNew = uploads.size();
+    for(AssetLoadJob* job=finished; job; job=job->next)
+    {
+        uploads.insert(uploads.begin() + firstNew, job);
+    }
+
+    int completedCount = 0;
+    while(!uploads.empty() && (uploadBudget > 0))
+    {
+        AssetLoadJob* job = uploads.front();
+        if(job->loaded)
+        {
+            if(!uploadStarted)
+            {
+                job->mesh->beginUpload(job->packed);
+                uploadStarted = true;
+            }
+            if(!job->mesh->continueUpload(job->packed, &uploadBudget, staging))
+            {
+                break;
+            }
+            completedCount++;
+        }
+
+        // NOTE: Failed loads have already reported why, so they're just dropped
+        uploads.pop_front();
+        uploadStarted = false;
+        delete job;
+        pending--;
+    }
+    return completedCount;
+}
+
+int AssetLoader::pendingCount()
+{
+    return pending;
+}
+
+void AssetLoader::stop()
+{
+    {
+        lock_guard<mutex> lock(requestMutex);
+        stopping = true;
+    }
+    requestAvailable.notify_all();
+    for(size_t i=0; i<workers.size(); i++)
+    {
+        workers[i].join();
+    }
+    workers.clear();
+
+    for(size_t i=0; i<requests.size(); i++)
+    {
+        delete requests[i];
+    }
+    requests.clear();
+    AssetLoadJob* finished = completed.exchange(0, memory_order_acquire);
+    while(finished)
+    {
+        AssetLoadJob* next = finished->next;
+        delete finished;
+        finished = next;
+    }
+    for(size_t i=0; i<uploads.size(); i++)
+    {
+        delete uploads[i];
+    }
+    uploads.clear();
+    uploadStarted = false;
+    pending = 0;
+}
+
+void AssetLoader::workerLoop()
+{
+    while(true)
+    {
+        AssetLoadJob* job = 0;
+        {
+            unique_lock<mutex> lock(requestMutex);
+            while(!stopping && requests.empty())
+            {
+                requestAvailable.wait(lock);
+            }
+            if(stopping)
+            {
+                return;
+            }
+            job = requests.front();
+            requests.pop_front();
+        }
+
+        job->loaded = job->packed.loadFromOBJFile(job->filename, job->requestedLayout,
+                                                  parserThreadCount);
+
+        // Push onto the completed stack. The release makes the packed data visible to the GL thread
+        // along with the job itself
+        job->next = completed.load(memory_order_relaxed);
+        while(!completed.compare_exchange_weak(job->next, job, memory_order_release,
+                                               memory_order_relaxed))
+        {
+        }
+    }
+}
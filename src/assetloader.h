@@ -0,0 +1,77 @@
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mesh.h"
+
+struct AssetLoadJob;
+
+// Loads meshes in the background so that the GL thread never waits on a file. Worker threads do
+// all of the loading and packing (see PackedMesh) and pass the finished meshes back through a
+// lock-free queue. The GL thread then calls update once a frame, which copies at most a fixed
+// number of bytes into the meshes' buffers, so a big mesh is spread over as many frames as it needs
+// rather than causing one long frame
+class AssetLoader
+{
+public:
+    // A threadCount of 0 uses every core but one, leaving that for the GL thread. The cores are
+    // shared out between the workers, each worker parsing its files on (at least) one thread and
+    // its share of the cores, so all of them loading at once doesn't start a parser thread per
+    // core each
+    explicit AssetLoader(int threadCount = 0);
+    ~AssetLoader();
+
+    // Queues an OBJ to be loaded into mesh, using the mesh's current vertex layout. The mesh must
+    // stay alive until the load finishes or the loader is stopped, and shouldn't be drawn from
+    // anywhere else in the meantime (it draws nothing until the upload is complete)
+    void loadOBJFile(std::string filename, Mesh* mesh);
+
+    // Must be called on the GL thread. Uploads up to uploadBudget bytes of finished meshes, oldest
+    // first, and returns the number of meshes that were completed by this call. If given, the data
+    // goes through the staging buffer (see Mesh::continueUpload)
+    int update(size_t uploadBudget, StreamBuffer* staging = 0);
+
+    // The number of loads that have been queued but not yet completely uploaded
+    int pendingCount();
+
+    // Waits for the workers to finish the file they're on and drops everything not yet uploaded
+    // (a mesh left part way through an upload keeps its buffers until its own cleanup). Called by
+    // the destructor, the loader can't be used again afterwards
+    void stop();
+
+private:
+    AssetLoader(const AssetLoader&);
+    AssetLoader& operator=(const AssetLoader&);
+
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    int parserThreadCount;
+
+    // Loads waiting for a worker. Workers sleep when there's nothing to do, so this side is
+    // simply locked
+    std::mutex requestMutex;
+    std::condition_variable requestAvailable;
+    std::deque<AssetLoadJob*> requests;
+    bool stopping;
+
+    // Finished loads, pushed by the workers and taken all at once by update. This is a stack, so
+    // update reverses it to keep the loads in order
+    std::atomic<AssetLoadJob*> completed;
+
+    // Loads that update has taken from completed, the first of which may be part way through
+    // being uploaded. Only touched by the GL thread
+    std::deque<AssetLoadJob*> uploads;
+    bool uploadStarted;
+
+    std::atomic<int> pending;
+};
+
+#endif
@@ -0,0 +1,1480 @@
+#include <algorithm>
+#include <iostream>
+#include <chrono>
+#include <thread>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+
+#include "SDL.h"
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "allocationstats.h"
+#include "benchmark.h"
+#include "framepacer.h"
+#include "geometry.h"
+#include "instancebuffer.h"
+#include "mappedfile.h"
+#include "mesh.h"
+#include "scenegraph.h"
+#include "scratcharena.h"
+#include "streambuffer.h"
+#include "tangents.h"
+#include "vertexlayout.h"
+
+static double secondsSince(chrono::steady_clock::time_point start)
+{
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+static size_t fileSize(string filename)
+{
+    MappedFile file;
+    if(!file.open(filename))
+    {
+        return 0;
+    }
+    return file.size();
+}
+
+void benchmarkOBJLoading(string filename, int iterations)
+{
+    size_t bytes = fileSize(filename);
+    if(bytes == 0)
+    {
+        cout << "Unable to open obj file: " << filename << endl;
+        return;
+    }
+    double megabytes = bytes / (1024.0 * 1024.0);
+    printf("Loading %s (%.2f MB), best of %d runs\n", filename.c_str(), megabytes, iterations);
+
+    // NOTE: Each loader is timed twice over, once for just the parse into records and once end to
+    //       end (including expanding the faces into the streams), so it's clear which half a
+    //       change to the loaders actually sped up
+    double streamBest = 0.0;
+    double streamParseBest = 0.0;
+    double mappedBest = 0.0;
+    double mappedParseBest = 0.0;
+    bool identical = true;
+    for(int i=0; i<iterations; i++)
+    {
+        GeometryData streamGeometry;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        streamGeometry.loadFromOBJFile(filename);
+        double streamTime = secondsSince(start);
+
+        GeometryData mappedGeometry;
+        start = chrono::steady_clock::now();
+        mappedGeometry.loadFromOBJFileMapped(filename);
+        double mappedTime = secondsSince(start);
+
+        if((i == 0) || (streamTime < streamBest))
+        {
+            streamBest = streamTime;
+        }
+        if((i == 0) || (streamGeometry.lastParseTime() < streamParseBest))
+        {
+            streamParseBest = streamGeometry.lastParseTime();
+        }
+        if((i == 0) || (mappedTime < mappedBest))
+        {
+            mappedBest = mappedTime;
+        }
+        if((i == 0) || (mappedGeometry.lastParseTime() < mappedParseBest))
+        {
+            mappedParseBest = mappedGeometry.lastParseTime();
+        }
+        identical = identical && streamGeometry.matches(mappedGeometry);
+    }
+
+    printf("                 parse      total      MB/s\n");
+    printf("  ifstream:    %8.2f ms %8.2f ms %8.1f\n", 1000.0 * streamParseBest, 1000.0 * streamBest,
+           megabytes / streamBest);
+    printf("  mapped:      %8.2f ms %8.2f ms %8.1f  (%.1fx)\n", 1000.0 * mappedParseBest,
+           1000.0 * mappedBest, megabytes / mappedBest, streamBest / mappedBest);
+    printf("  Output is %s\n", identical ? "identical" : "DIFFERENT");
+
+    // Thread scaling for the parallel loader, always going up to at least 16 threads so we can
+    // see how it behaves on the big build machines even when benchmarking somewhere smaller
+    int maxThreads = thread::hardware_concurrency();
+    if(maxThreads < 16)
+    {
+        maxThreads = 16;
+    }
+    GeometryData referenceGeometry;
+    referenceGeometry.loadFromOBJFileMapped(filename);
+    for(int threadCount=1; threadCount<=maxThreads; threadCount*=2)
+    {
+        double parallelBest = 0.0;
+        double parallelParseBest = 0.0;
+        bool parallelIdentical = true;
+        for(int i=0; i<iterations; i++)
+        {
+            GeometryData parallelGeometry;
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            parallelGeometry.loadFromOBJFileParallel(filename, threadCount);
+            double parallelTime = secondsSince(start);
+
+            if((i == 0) || (parallelTime < parallelBest))
+            {
+                parallelBest = parallelTime;
+            }
+            if((i == 0) || (parallelGeometry.lastParseTime() < parallelParseBest))
+            {
+                parallelParseBest = parallelGeometry.lastParseTime();
+            }
+            parallelIdentical = parallelIdentical && referenceGeometry.matches(parallelGeometry);
+        }
+        printf("  parallel x%-2d %8.2f ms %8.2f ms %8.1f  (%.1fx)%s\n", threadCount,
+               1000.0 * parallelParseBest, 1000.0 * parallelBest, megabytes / parallelBest,
+               mappedBest / parallelBest, parallelIdentical ? "" : "  DIFFERENT");
+    }
+}
+
+// The most memory the process has had resident at once, in bytes
+static size_t peakResidentMemory()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return 0;
+    }
+    return counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+    // NOTE: ru_maxrss is in KB on Linux (but bytes on macOS)
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return (size_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+// Just counts the triangles, standing in for a sink that uploads each batch and then forgets it
+class CountingSink : public TriangleSink
+{
+public:
+    CountingSink()
+        : triangleCount(0)
+    {
+    }
+
+    void addTriangles(const VertexStreams& streams)
+    {
+        triangleCount += streams.vertexCount / 3;
+    }
+
+    size_t triangleCount;
+};
+
+void benchmarkStreamingLoad(string filename, string mode)
+{
+    size_t bytes = fileSize(filename);
+    if(bytes == 0)
+    {
+        cout << "Unable to open obj file: " << filename << endl;
+        return;
+    }
+
+    size_t triangleCount = 0;
+    size_t startMemory = peakResidentMemory();
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    if(mode == "stream")
+    {
+        CountingSink sink;
+        loadOBJFileStreaming(filename, &sink);
+        triangleCount = sink.triangleCount;
+    }
+    else if(mode == "geometry")
+    {
+        GeometryData geometry;
+        geometry.loadFromOBJFileStreaming(filename);
+        triangleCount = geometry.vertexCount() / 3;
+    }
+    else if(mode == "mapped")
+    {
+        GeometryData geometry;
+        geometry.loadFromOBJFileMapped(filename);
+        triangleCount = geometry.vertexCount() / 3;
+    }
+    else
+    {
+        cout << "Unknown loader " << mode << ", expected stream, geometry or mapped" << endl;
+        return;
+    }
+    double time = secondsSince(start);
+
+    printf("%s loader on %s (%.1f MB)\n", mode.c_str(), filename.c_str(), bytes / (1024.0 * 1024.0));
+    printf("  %zu triangles in %.2f ms (%.1f MB/s)\n", triangleCount, 1000.0 * time,
+           bytes / (1024.0 * 1024.0) / time);
+    printf("  peak resident memory %.1f MB (%.1f MB before loading)\n",
+           peakResidentMemory() / (1024.0 * 1024.0), startMemory / (1024.0 * 1024.0));
+}
+
+static const char* allocationLoaderNames[] = {
+    "ifstream:", "mapped:", "parallel:", "parallel indexed:", "streaming:"
+};
+
+static void loadWithLoader(int loader, string filename, GeometryData& geometry)
+{
+    switch(loader)
+    {
+    case 0:
+        geometry.loadFromOBJFile(filename);
+        break;
+    case 1:
+        geometry.loadFromOBJFileMapped(filename);
+        break;
+    case 2:
+        geometry.loadFromOBJFileParallel(filename);
+        break;
+    case 3:
+        geometry.setIndexed(true);
+        geometry.loadFromOBJFileParallel(filename);
+        break;
+    case 4:
+        geometry.loadFromOBJFileStreaming(filename);
+        break;
+    }
+}
+
+void benchmarkLoaderAllocations(string filename)
+{
+    if(!allocationTrackingEnabled())
+    {
+        cout << "Allocation tracking isn't built in, build with make bench and run build/prac1-bench instead" << endl;
+        return;
+    }
+
+    size_t bytes = fileSize(filename);
+    if(bytes == 0)
+    {
+        cout << "Unable to open obj file: " << filename << endl;
+        return;
+    }
+
+    printf("Allocations while loading %s (%.1f MB)\n", filename.c_str(), bytes / (1024.0 * 1024.0));
+    for(int loader=0; loader<5; loader++)
+    {
+        AllocationStats before = allocationStats();
+        resetPeakAllocation();
+
+        size_t resultBytes = 0;
+        {
+            GeometryData geometry;
+            loadWithLoader(loader, filename, geometry);
+            resultBytes = allocationStats().currentBytes - before.currentBytes;
+        }
+        AllocationStats after = allocationStats();
+
+        // NOTE: The peak is reported relative to what the geometry itself ends up taking, since
+        //       anything over that is only temporary
+        printf("  %-18s %8zu allocations  peak %8.1f MB  result %8.1f MB  (peak %.2fx result)\n",
+               allocationLoaderNames[loader], after.allocationCount - before.allocationCount,
+               (after.peakBytes - before.currentBytes) / (1024.0 * 1024.0),
+               resultBytes / (1024.0 * 1024.0),
+               (after.peakBytes - before.currentBytes) / (double)(resultBytes ? resultBytes : 1));
+    }
+}
+
+// Writes a small prop-sized OBJ: a bumpy grid of quads with texture coordinates and normals
+static bool writeBulkOBJFile(string filename, int width, int height)
+{
+    FILE* file = fopen(filename.c_str(), "w");
+    if(!file)
+    {
+        return false;
+    }
+    for(int y=0; y<=height; y++)
+    {
+        for(int x=0; x<=width; x++)
+        {
+            fprintf(file, "v %f %f %f\n", (float)x, 0.1f * (float)((x*y) % 5), (float)y);
+            fprintf(file, "vt %f %f\n", x / (float)width, y / (float)height);
+            fprintf(file, "vn 0 1 0\n");
+        }
+    }
+    for(int y=0; y<height; y++)
+    {
+        for(int x=0; x<width; x++)
+        {
+            int corners[4] = { (y*(width+1)) + x + 1, (y*(width+1)) + x + 2,
+                               ((y+1)*(width+1)) + x + 2, ((y+1)*(width+1)) + x + 1 };
+            fprintf(file, "f");
+            for(int i=0; i<4; i++)
+            {
+                fprintf(file, " %d/%d/%d", corners[i], corners[i], corners[i]);
+            }
+            fprintf(file, "\n");
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+static const char* bulkLoaderNames[] = { "ifstream", "mapped", "mapped indexed" };
+
+void benchmarkBulkLoading(string directory, int fileCount)
+{
+    // NOTE: A fixed seed so every run loads the same set of files, each somewhere between 32 and
+    //       1800 triangles
+    srand(1234);
+    vector<string> filenames;
+    size_t totalBytes = 0;
+    for(int i=0; i<fileCount; i++)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "/bulk%04d.obj", i);
+        string filename = directory + name;
+        if(!writeBulkOBJFile(filename, 4 + (rand() % 27), 4 + (rand() % 27)))
+        {
+            cout << "Unable to write obj file: " << filename << endl;
+            break;
+        }
+        filenames.push_back(filename);
+        totalBytes += fileSize(filename);
+    }
+    printf("Loading %zu small OBJ files (%.1f MB in total), best of 3 runs\n", filenames.size(),
+           totalBytes / (1024.0 * 1024.0));
+
+    if(!allocationTrackingEnabled())
+    {
+        printf("  (allocation tracking isn't built in, build with make bench for the allocation counts)\n");
+    }
+
+    ScratchArena arena;
+    for(int loader=0; loader<3; loader++)
+    {
+        double heapBest = 0.0;
+        double arenaBest = 0.0;
+        size_t heapAllocations = 0;
+        size_t arenaAllocations = 0;
+        bool identical = true;
+        for(int run=0; run<3; run++)
+        {
+            for(int useArena=0; useArena<2; useArena++)
+            {
+                ScratchArena* scratch = useArena ? &arena : 0;
+                size_t allocationsBefore = allocationStats().allocationCount;
+                chrono::steady_clock::time_point start = chrono::steady_clock::now();
+                for(size_t i=0; i<filenames.size(); i++)
+                {
+                    GeometryData geometry;
+                    geometry.setIndexed(loader == 2);
+                    if(loader == 0)
+                    {
+                        geometry.loadFromOBJFile(filenames[i], scratch);
+                    }
+                    else
+                    {
+                        geometry.loadFromOBJFileMapped(filenames[i], scratch);
+                    }
+                }
+                double time = secondsSince(start);
+                size_t allocations = allocationStats().allocationCount - allocationsBefore;
+
+                if(useArena)
+                {
+                    arenaBest = ((run == 0) || (time < arenaBest)) ? time : arenaBest;
+                    arenaAllocations = allocations;
+                }
+                else
+                {
+                    heapBest = ((run == 0) || (time < heapBest)) ? time : heapBest;
+                    heapAllocations = allocations;
+                }
+            }
+        }
+
+        // Loading the first and last files again both ways checks the arena doesn't change the result
+        for(size_t i=0; i<filenames.size(); i+=(filenames.size() > 1) ? filenames.size()-1 : 1)
+        {
+            GeometryData heapGeometry;
+            GeometryData arenaGeometry;
+            heapGeometry.setIndexed(loader == 2);
+            arenaGeometry.setIndexed(loader == 2);
+            if(loader == 0)
+            {
+                heapGeometry.loadFromOBJFile(filenames[i]);
+                arenaGeometry.loadFromOBJFile(filenames[i], &arena);
+            }
+            else
+            {
+                heapGeometry.loadFromOBJFileMapped(filenames[i]);
+                arenaGeometry.loadFromOBJFileMapped(filenames[i], &arena);
+            }
+            identical = identical && heapGeometry.matches(arenaGeometry);
+        }
+
+        double files = filenames.empty() ? 1.0 : (double)filenames.size();
+        printf("  %s:\n", bulkLoaderNames[loader]);
+        printf("    heap:   %8.2f ms  %7.1f us/file  %8.1f allocations/file\n", 1000.0 * heapBest,
+               1000000.0 * heapBest / files, heapAllocations / files);
+        printf("    arena:  %8.2f ms  %7.1f us/file  %8.1f allocations/file  (%.2fx)%s\n",
+               1000.0 * arenaBest, 1000000.0 * arenaBest / files, arenaAllocations / files,
+               heapBest / arenaBest, identical ? "" : "  DIFFERENT");
+    }
+    printf("  arena capacity %.1f KB\n", arena.capacity() / 1024.0);
+
+    for(size_t i=0; i<filenames.size(); i++)
+    {
+        remove(filenames[i].c_str());
+    }
+}
+
+static void printVertexCacheStats(const char* label, VertexCacheStats& stats)
+{
+    printf("  %-22s ACMR %.3f  ATVR %.3f  (%d vertices, %d triangles, %d entry FIFO)\n", label,
+           stats.acmr, stats.atvr, stats.vertexCount, stats.triangleCount, stats.cacheSize);
+}
+
+void benchmarkVertexCache(string filename)
+{
+    GeometryData indexedGeometry;
+    indexedGeometry.setIndexed(true);
+    indexedGeometry.loadFromOBJFileMapped(filename);
+    if(indexedGeometry.vertexCount() == 0)
+    {
+        cout << "No geometry loaded from " << filename << endl;
+        return;
+    }
+
+    VertexCacheStats before;
+    VertexCacheStats after;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    indexedGeometry.optimizeVertexCache(&before, &after);
+    double indexedTime = secondsSince(start);
+
+    printf("Vertex cache optimization of %s\n", filename.c_str());
+    printf("Indexed loader output (%.2f ms)\n", 1000.0 * indexedTime);
+    printVertexCacheStats("before:", before);
+    printVertexCacheStats("after:", after);
+
+    GeometryData expandedGeometry;
+    expandedGeometry.loadFromOBJFileMapped(filename);
+    start = chrono::steady_clock::now();
+    expandedGeometry.optimizeVertexCache(&before, &after);
+    double expandedTime = secondsSince(start);
+
+    printf("Un-indexed loader output, welded (%.2f ms)\n", 1000.0 * expandedTime);
+    printVertexCacheStats("before (after weld):", before);
+    printVertexCacheStats("after:", after);
+}
+
+static void reportVertexCompression(const char* label, const VertexCompression& compression,
+                                    GeometryData& geometry)
+{
+    VertexStreams streams = geometry.streams();
+    VertexLayout layout = makeInterleavedVertexLayout(VERTEX_ALL_ATTRIBUTES_BIT);
+    compressVertexLayout(&layout, compression);
+    layout = restrictVertexLayout(layout, streams);
+
+    vector<unsigned char> buffers[VERTEX_ATTRIBUTE_COUNT];
+    packVertexLayout(layout, streams, buffers);
+    VertexLayoutError error = measureVertexLayoutError(layout, streams, buffers);
+
+    printf("  %-28s %3d bytes/vertex  pos %.6f  uv %.6f  normal %6.3f deg  tangent %6.3f deg"
+           "  bitangent %6.3f deg\n", label, (int)layout.strides[0], error.maxPositionError,
+           error.maxTextureCoordError, error.maxNormalAngle, error.maxTangentAngle,
+           error.maxBitangentAngle);
+}
+
+void benchmarkVertexCompression(string filename)
+{
+    GeometryData geometry;
+    geometry.setIndexed(true);
+    geometry.loadFromOBJFileParallel(filename);
+    if(geometry.vertexCount() == 0)
+    {
+        cout << "No geometry loaded from " << filename << endl;
+        return;
+    }
+
+    printf("Vertex compression of %s (%d vertices), maximum errors:\n", filename.c_str(),
+           geometry.vertexCount());
+
+    VertexCompression compression = {};
+    reportVertexCompression("float:", compression, geometry);
+
+    compression.halfFloatTextureCoords = true;
+    reportVertexCompression("+ half uv:", compression, geometry);
+
+    compression.packNormals = true;
+    reportVertexCompression("+ 2_10_10_10 normal:", compression, geometry);
+
+    compression.octahedralNormals = true;
+    reportVertexCompression("+ octahedral normal:", compression, geometry);
+
+    compression.packTangentFrame = true;
+    reportVertexCompression("+ packed tangent frame:", compression, geometry);
+
+    compression.quantizePositions = true;
+    reportVertexCompression("+ 16-bit positions:", compression, geometry);
+}
+
+// The (bi)tangent generation as expandFaces used to do it, one face at a time appending to the
+// output streams, kept here as the baseline for the batched kernels
+static void pushTriangleTangents(const vector<float>& positions, const vector<float>& texCoords,
+                                 vector<float>& tangents, vector<float>& bitangents)
+{
+    int triangleCount = positions.size() / 9;
+    for(int triangle=0; triangle<triangleCount; triangle++)
+    {
+        const float* p = &positions[9*triangle];
+        const float* uv = &texCoords[6*triangle];
+        float tangent[3];
+        float bitangent[3];
+        computeFaceTangents(&p[0], &p[3], &p[6], &uv[0], &uv[2], &uv[4], tangent, bitangent);
+        for(int vertIndex=0; vertIndex<3; vertIndex++)
+        {
+            tangents.push_back(tangent[0]);
+            tangents.push_back(tangent[1]);
+            tangents.push_back(tangent[2]);
+
+            bitangents.push_back(bitangent[0]);
+            bitangents.push_back(bitangent[1]);
+            bitangents.push_back(bitangent[2]);
+        }
+    }
+}
+
+static int countNonFinite(const vector<float>& values)
+{
+    int count = 0;
+    for(size_t i=0; i<values.size(); i++)
+    {
+        if(!(values[i] - values[i] == 0.0f))
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+void benchmarkTangents(int triangleCount)
+{
+    // NOTE: A fixed seed so every run times the same mesh. Roughly 1 in 64 triangles gets a
+    //       degenerate UV mapping (all 3 UVs the same) since real meshes do have a few of those
+    srand(1234);
+    vector<float> positions(9*(size_t)triangleCount);
+    vector<float> texCoords(6*(size_t)triangleCount);
+    for(size_t i=0; i<positions.size(); i++)
+    {
+        positions[i] = (rand() / (float)RAND_MAX) * 2.0f - 1.0f;
+    }
+    for(size_t i=0; i<texCoords.size(); i++)
+    {
+        texCoords[i] = rand() / (float)RAND_MAX;
+    }
+    for(int triangle=0; triangle<triangleCount; triangle+=64)
+    {
+        for(int i=2; i<6; i++)
+        {
+            texCoords[(6*triangle)+i] = texCoords[(6*triangle)+(i%2)];
+        }
+    }
+
+    const int iterations = 5;
+    double pushTime = 0.0;
+    double scalarTime = 0.0;
+    double simdTime = 0.0;
+    vector<float> pushTangents, pushBitangents;
+    vector<float> scalarTangents, scalarBitangents;
+    vector<float> simdTangents, simdBitangents;
+    for(int iteration=0; iteration<iterations; iteration++)
+    {
+        vector<float>().swap(pushTangents);
+        vector<float>().swap(pushBitangents);
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        pushTriangleTangents(positions, texCoords, pushTangents, pushBitangents);
+        pushTime += secondsSince(start);
+
+        vector<float>().swap(scalarTangents);
+        vector<float>().swap(scalarBitangents);
+        start = chrono::steady_clock::now();
+        scalarTangents.resize(positions.size());
+        scalarBitangents.resize(positions.size());
+        computeTriangleTangentsScalar(&positions[0], &texCoords[0], triangleCount,
+                                      &scalarTangents[0], &scalarBitangents[0]);
+        scalarTime += secondsSince(start);
+
+        vector<float>().swap(simdTangents);
+        vector<float>().swap(simdBitangents);
+        start = chrono::steady_clock::now();
+        simdTangents.resize(positions.size());
+        simdBitangents.resize(positions.size());
+        computeTriangleTangents(&positions[0], &texCoords[0], triangleCount,
+                                &simdTangents[0], &simdBitangents[0]);
+        simdTime += secondsSince(start);
+    }
+
+    bool scalarMatches = (scalarTangents == pushTangents) && (scalarBitangents == pushBitangents);
+    bool simdMatches = (simdTangents == pushTangents) && (simdBitangents == pushBitangents);
+    int nonFinite = countNonFinite(simdTangents) + countNonFinite(simdBitangents);
+
+    printf("Tangent generation for %d triangles (average of %d runs)\n", triangleCount, iterations);
+    printf("  %-22s %8.2f ms\n", "per face push_back:", 1000.0 * pushTime / iterations);
+    printf("  %-22s %8.2f ms  (%.2fx)  %s\n", "batched scalar:", 1000.0 * scalarTime / iterations,
+           pushTime / scalarTime, scalarMatches ? "identical" : "MISMATCH");
+    printf("  %-22s %8.2f ms  (%.2fx)  %s\n", "batched simd:", 1000.0 * simdTime / iterations,
+           pushTime / simdTime, simdMatches ? "identical" : "MISMATCH");
+    printf("  kernel: %s, non-finite outputs: %d\n", triangleTangentKernelName(), nonFinite);
+
+    // Smooth tangents need shared vertices, so for those we use a bumpy grid with the same number
+    // of triangles, again with a fixed seed
+    int gridSize = (int)sqrt(triangleCount / 2.0) + 1;
+    int gridVertexCount = gridSize * gridSize;
+    vector<float> gridPositions(3*(size_t)gridVertexCount);
+    vector<float> gridTexCoords(2*(size_t)gridVertexCount);
+    vector<float> gridNormals(3*(size_t)gridVertexCount);
+    for(int y=0; y<gridSize; y++)
+    {
+        for(int x=0; x<gridSize; x++)
+        {
+            int vertex = (y*gridSize) + x;
+            float jitter = (rand() / (float)RAND_MAX) - 0.5f;
+            gridPositions[3*vertex] = (float)x;
+            gridPositions[(3*vertex)+1] = (float)y;
+            gridPositions[(3*vertex)+2] = sin(0.1f * x) * cos(0.1f * y) + 0.1f * jitter;
+            gridTexCoords[2*vertex] = (x + 0.2f * jitter) / gridSize;
+            gridTexCoords[(2*vertex)+1] = (y - 0.2f * jitter) / gridSize;
+            gridNormals[3*vertex] = -0.1f * cos(0.1f * x) * cos(0.1f * y);
+            gridNormals[(3*vertex)+1] = 0.1f * sin(0.1f * x) * sin(0.1f * y);
+            gridNormals[(3*vertex)+2] = 1.0f;
+        }
+    }
+    vector<unsigned int> gridIndices;
+    gridIndices.reserve(6*(size_t)(gridSize-1)*(gridSize-1));
+    for(int y=0; y<gridSize-1; y++)
+    {
+        for(int x=0; x<gridSize-1; x++)
+        {
+            unsigned int corner = (y*gridSize) + x;
+            unsigned int quad[6] = { corner, corner+1, corner+gridSize+1,
+                                     corner, corner+gridSize+1, corner+gridSize };
+            gridIndices.insert(gridIndices.end(), quad, quad+6);
+        }
+    }
+
+    printf("Smooth tangent frames for %d triangles, %d vertices\n", (int)gridIndices.size()/3,
+           gridVertexCount);
+    vector<float> firstTangents, firstBitangents;
+    double firstTime = 0.0;
+    int threadCounts[] = { 1, 2, 4, 8 };
+    for(int i=0; i<4; i++)
+    {
+        vector<float> smoothTangents(3*(size_t)gridVertexCount);
+        vector<float> smoothBitangents(3*(size_t)gridVertexCount);
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        computeVertexTangents(&gridPositions[0], &gridTexCoords[0], &gridNormals[0], &gridIndices[0],
+                              (int)gridIndices.size(), gridVertexCount,
+                              &smoothTangents[0], &smoothBitangents[0], threadCounts[i]);
+        double time = secondsSince(start);
+
+        if(i == 0)
+        {
+            firstTangents.swap(smoothTangents);
+            firstBitangents.swap(smoothBitangents);
+            firstTime = time;
+            printf("  %d thread:  %8.2f ms\n", threadCounts[i], 1000.0 * time);
+            continue;
+        }
+        bool identical = (smoothTangents == firstTangents) && (smoothBitangents == firstBitangents);
+        printf("  %d threads: %8.2f ms  (%.2fx)  %s\n", threadCounts[i], 1000.0 * time,
+               firstTime / time, identical ? "identical" : "MISMATCH");
+    }
+}
+
+// What keeping world transforms used to cost, every one recomputed every frame whether or not
+// anything moved
+static void recomputeAllWorldTransforms(const vector<glm::mat4>& localTransforms, const vector<int>& parents,
+                                        vector<glm::mat4>& worldTransforms)
+{
+    for(size_t node=0; node<parents.size(); node++)
+    {
+        if(parents[node] == SCENE_NO_PARENT)
+        {
+            worldTransforms[node] = localTransforms[node];
+        }
+        else
+        {
+            worldTransforms[node] = worldTransforms[parents[node]] * localTransforms[node];
+        }
+    }
+}
+
+static glm::mat4 randomLocalTransform()
+{
+    glm::vec3 offset((rand() / (float)RAND_MAX) - 0.5f, (rand() / (float)RAND_MAX) - 0.5f,
+                     (rand() / (float)RAND_MAX) - 0.5f);
+    float angle = (rand() / (float)RAND_MAX) * 6.283f;
+    return glm::rotate(glm::translate(glm::mat4(1.0f), offset), angle, glm::vec3(0, 1, 0));
+}
+
+// Moves movedCount random nodes (only leaves when leavesOnly is set) each frame for frameCount
+// frames and times the scene graph's update, then checks every world transform against a full
+// recompute
+static void benchmarkSceneGraphMoves(const char* label, SceneGraph& scene, vector<glm::mat4>& localTransforms,
+                                     const vector<int>& parents, const vector<int>& movable,
+                                     int movedCount, int frameCount)
+{
+    long long recomputedCount = 0;
+    double time = 0.0;
+    for(int frame=0; frame<frameCount; frame++)
+    {
+        for(int i=0; i<movedCount; i++)
+        {
+            int node = movable[rand() % movable.size()];
+            localTransforms[node] = randomLocalTransform();
+            scene.setLocalTransform(node, localTransforms[node]);
+        }
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        recomputedCount += scene.updateWorldTransforms();
+        time += secondsSince(start);
+    }
+
+    vector<glm::mat4> expected(parents.size());
+    recomputeAllWorldTransforms(localTransforms, parents, expected);
+    bool identical = true;
+    for(size_t node=0; node<parents.size(); node++)
+    {
+        identical = identical && (scene.worldTransform(node) == expected[node]);
+    }
+    printf("  %-26s %9.2f us  %9.1f nodes recomputed  %s\n", label, 1e6 * time / frameCount,
+           recomputedCount / (double)frameCount, identical ? "identical" : "MISMATCH");
+}
+
+void benchmarkSceneGraph(int nodeCount)
+{
+    // NOTE: A fixed seed so every run builds the same hierarchy. Each node's parent is one of the
+    //       few hundred nodes before it, which gives a deep hierarchy (a few hundred levels) where
+    //       most nodes have a handful of children
+    srand(1234);
+    SceneGraph scene;
+    scene.reserve(nodeCount);
+    vector<glm::mat4> localTransforms;
+    vector<int> parents;
+    vector<int> childCounts(nodeCount, 0);
+    for(int node=0; node<nodeCount; node++)
+    {
+        int parent = (node == 0) ? SCENE_NO_PARENT : max(0, node - 1 - (rand() % 256));
+        glm::mat4 transform = randomLocalTransform();
+        scene.createNode(parent, transform);
+        localTransforms.push_back(transform);
+        parents.push_back(parent);
+        if(parent != SCENE_NO_PARENT)
+        {
+            childCounts[parent]++;
+        }
+    }
+    scene.updateWorldTransforms();
+
+    vector<int> allNodes;
+    vector<int> leaves;
+    for(int node=0; node<nodeCount; node++)
+    {
+        allNodes.push_back(node);
+        if(childCounts[node] == 0)
+        {
+            leaves.push_back(node);
+        }
+    }
+
+    const int frameCount = 200;
+    printf("Scene graph of %d nodes (%d leaves), average per frame over %d frames\n", nodeCount,
+           (int)leaves.size(), frameCount);
+
+    vector<glm::mat4> worldTransforms(nodeCount);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for(int frame=0; frame<frameCount; frame++)
+    {
+        recomputeAllWorldTransforms(localTransforms, parents, worldTransforms);
+    }
+    printf("  %-26s %9.2f us  %9d nodes recomputed\n", "recompute every node:",
+           1e6 * secondsSince(start) / frameCount, nodeCount);
+
+    benchmarkSceneGraphMoves("nothing moved:", scene, localTransforms, parents, leaves, 0, frameCount);
+    benchmarkSceneGraphMoves("10 leaves moved:", scene, localTransforms, parents, leaves, 10, frameCount);
+    benchmarkSceneGraphMoves("100 leaves moved:", scene, localTransforms, parents, leaves, 100, frameCount);
+    benchmarkSceneGraphMoves("10 nodes moved:", scene, localTransforms, parents, allNodes, 10, frameCount);
+    vector<int> root(1, 0);
+    benchmarkSceneGraphMoves("root moved:", scene, localTransforms, parents, root, 1, frameCount);
+}
+
+// Creates a hidden window with the same kind of context the real window uses, with an offscreen
+// framebuffer bound so that what we draw doesn't depend on the window system at all
+static SDL_Window* createBenchmarkContext(SDL_GLContext* context, GLuint* framebuffer,
+                                          GLuint* renderbuffers)
+{
+    if(SDL_Init(SDL_INIT_VIDEO) != 0)
+    {
+        cout << "Unable to initialize SDL" << endl;
+        return 0;
+    }
+
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 2);
+    SDL_Window* window = SDL_CreateWindow("Benchmark", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+                                          640, 480, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    if(!window)
+    {
+        cout << "Unable to create benchmark window" << endl;
+        SDL_Quit();
+        return 0;
+    }
+    *context = SDL_GL_CreateContext(window);
+    SDL_GL_MakeCurrent(window, *context);
+
+    glewExperimental = true;
+    glewInit();
+    glGetError(); // Consume the error erroneously set by glewInit()
+
+    glGenRenderbuffers(2, renderbuffers);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, 640, 480);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 640, 480);
+    glGenFramebuffers(1, framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, *framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+    glViewport(0, 0, 640, 480);
+    glEnable(GL_DEPTH_TEST);
+
+    cout << "Benchmarking on " << glGetString(GL_RENDERER) << endl;
+    return window;
+}
+
+static void destroyBenchmarkContext(SDL_Window* window, SDL_GLContext context, GLuint framebuffer,
+                                    GLuint* renderbuffers)
+{
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(2, renderbuffers);
+    SDL_GL_DeleteContext(context);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+}
+
+static GLuint compileBenchmarkProgram(const char* vertexSource, const char* fragmentSource)
+{
+    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertexShader, 1, &vertexSource, NULL);
+    glCompileShader(vertexShader);
+    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragmentShader, 1, &fragmentSource, NULL);
+    glCompileShader(fragmentShader);
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glLinkProgram(program);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    GLint linkStatus;
+    glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+    if(linkStatus != GL_TRUE)
+    {
+        GLchar message[1024];
+        glGetProgramInfoLog(program, 1024, NULL, message);
+        cout << "Benchmark shader error: " << message << endl;
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+// NOTE: This reads every attribute so that the driver can't skip fetching any of them
+static const char* layoutVertexShader =
+    "#version 330 core\n"
+    "layout(location = 0) in vec3 position;\n"
+    "layout(location = 1) in vec2 textureCoord;\n"
+    "layout(location = 2) in vec3 normal;\n"
+    "layout(location = 3) in vec3 tangent;\n"
+    "layout(location = 4) in vec3 bitangent;\n"
+    "out vec3 shade;\n"
+    "void main()\n"
+    "{\n"
+    "    shade = (0.5*normal) + (0.25*tangent) + (0.25*bitangent) + vec3(textureCoord, 0.0);\n"
+    "    gl_Position = vec4(0.5*position, 1.0);\n"
+    "}\n";
+
+static const char* layoutFragmentShader =
+    "#version 330 core\n"
+    "in vec3 shade;\n"
+    "out vec3 color;\n"
+    "void main()\n"
+    "{\n"
+    "    color = shade;\n"
+    "}\n";
+
+static void benchmarkLayout(const char* label, const VertexLayout& layout, GeometryData& geometry,
+                            int drawIterations)
+{
+    Mesh mesh;
+    mesh.setVertexLayout(layout);
+
+    glFinish();
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    mesh.upload(geometry);
+    glFinish();
+    double uploadTime = secondsSince(start);
+
+    // One untimed draw first so that any lazy driver work on the new buffers isn't counted
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    mesh.draw();
+    glFinish();
+
+    start = chrono::steady_clock::now();
+    for(int i=0; i<drawIterations; i++)
+    {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        mesh.draw();
+    }
+    glFinish();
+    double drawTime = secondsSince(start) / drawIterations;
+
+    printf("  %-12s upload %8.2f MB in %8.2f ms, draw %8.3f ms\n", label,
+           mesh.uploadedSize() / (1024.0 * 1024.0), 1000.0 * uploadTime, 1000.0 * drawTime);
+    mesh.cleanup();
+}
+
+void benchmarkVertexLayouts(string filename)
+{
+    GeometryData geometry;
+    geometry.setIndexed(true);
+    geometry.loadFromOBJFileParallel(filename);
+    if(geometry.vertexCount() == 0)
+    {
+        cout << "No geometry loaded from " << filename << endl;
+        return;
+    }
+    geometry.optimizeVertexCache();
+
+    SDL_GLContext context;
+    GLuint framebuffer;
+    GLuint renderbuffers[2];
+    SDL_Window* window = createBenchmarkContext(&context, &framebuffer, renderbuffers);
+    if(!window)
+    {
+        return;
+    }
+
+    GLuint program = compileBenchmarkProgram(layoutVertexShader, layoutFragmentShader);
+    if(program)
+    {
+        glUseProgram(program);
+        printf("Vertex layouts for %s (%d vertices, %d triangles)\n", filename.c_str(),
+               geometry.vertexCount(), geometry.indexCount()/3);
+        benchmarkLayout("separate:", makeSeparateVertexLayout(VERTEX_ALL_ATTRIBUTES_BIT), geometry, 20);
+        benchmarkLayout("interleaved:", makeInterleavedVertexLayout(VERTEX_ALL_ATTRIBUTES_BIT), geometry, 20);
+        glDeleteProgram(program);
+    }
+
+    destroyBenchmarkContext(window, context, framebuffer, renderbuffers);
+}
+
+static const char* streamVertexShader =
+    "#version 330 core\n"
+    "layout(location = 0) in vec3 position;\n"
+    "void main()\n"
+    "{\n"
+    "    gl_Position = vec4(position, 1.0);\n"
+    "}\n";
+
+static const char* streamFragmentShader =
+    "#version 330 core\n"
+    "out vec3 color;\n"
+    "void main()\n"
+    "{\n"
+    "    color = vec3(0.0, 0.0, 0.0);\n"
+    "}\n";
+
+enum StreamUploadMethod
+{
+    STREAM_BUFFER_DATA,
+    STREAM_BUFFER_SUB_DATA,
+    STREAM_MAP_UNSYNCHRONIZED,
+    STREAM_MAP_PERSISTENT
+};
+
+// Fills in one frame of a grid of small triangles that wobble over time, standing in for any
+// geometry that's regenerated every frame (particles, skinning on the CPU, UI and so on)
+static void writeStreamFrame(float* positions, int triangleCount, int frame)
+{
+    int columns = (int)sqrtf((float)triangleCount) + 1;
+    float cellSize = 2.0f / columns;
+    float wobble = 0.25f * cellSize * sinf(0.1f * frame);
+    for(int triangle=0; triangle<triangleCount; triangle++)
+    {
+        float x = -1.0f + cellSize * (triangle % columns);
+        float y = -1.0f + cellSize * (triangle / columns);
+        float* vertex = &positions[9*triangle];
+        vertex[0] = x;
+        vertex[1] = y;
+        vertex[2] = 0.0f;
+        vertex[3] = x + cellSize;
+        vertex[4] = y + wobble;
+        vertex[5] = 0.0f;
+        vertex[6] = x + 0.5f*cellSize;
+        vertex[7] = y + cellSize;
+        vertex[8] = 0.0f;
+    }
+}
+
+static void benchmarkStreamMethod(const char* label, StreamUploadMethod method, int triangleCount,
+                                  int frameCount)
+{
+    size_t frameSize = 9 * sizeof(float) * (size_t)triangleCount;
+    vector<float> positions(9 * (size_t)triangleCount);
+
+    GLuint vao = 0;
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glEnableVertexAttribArray(0);
+
+    GLuint buffer = 0;
+    StreamBuffer stream;
+    if((method == STREAM_MAP_UNSYNCHRONIZED) || (method == STREAM_MAP_PERSISTENT))
+    {
+        if(!stream.create(frameSize, method == STREAM_MAP_PERSISTENT))
+        {
+            glDeleteVertexArrays(1, &vao);
+            return;
+        }
+        if((method == STREAM_MAP_PERSISTENT) && !stream.isPersistent())
+        {
+            printf("  %-22s not supported\n", label);
+            stream.destroy();
+            glDeleteVertexArrays(1, &vao);
+            return;
+        }
+    }
+    else
+    {
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferData(GL_ARRAY_BUFFER, frameSize, 0, GL_STREAM_DRAW);
+    }
+
+    glFinish();
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for(int frame=0; frame<frameCount; frame++)
+    {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        size_t offset = 0;
+        if(buffer)
+        {
+            writeStreamFrame(&positions[0], triangleCount, frame);
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            if(method == STREAM_BUFFER_DATA)
+            {
+                glBufferData(GL_ARRAY_BUFFER, frameSize, &positions[0], GL_STREAM_DRAW);
+            }
+            else
+            {
+                glBufferSubData(GL_ARRAY_BUFFER, 0, frameSize, &positions[0]);
+            }
+        }
+        else
+        {
+            // NOTE: The mapped paths write straight into the buffer, with no copy on the CPU side
+            float* mapped = (float*)stream.beginWrite(frameSize, 16, &offset);
+            writeStreamFrame(mapped, triangleCount, frame);
+            stream.endWrite();
+            glBindBuffer(GL_ARRAY_BUFFER, stream.buffer());
+        }
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)offset);
+        glDrawArrays(GL_TRIANGLES, 0, 3*triangleCount);
+        if(!buffer)
+        {
+            stream.endFrame();
+        }
+        // Stands in for the swap, which lets the GPU start on the frame while the CPU moves on
+        glFlush();
+    }
+    glFinish();
+    double frameTime = secondsSince(start) / frameCount;
+
+    printf("  %-22s %8.3f ms per frame  %8.1f MB/s", label, 1000.0 * frameTime,
+           frameSize / (1024.0 * 1024.0) / frameTime);
+    if(buffer)
+    {
+        printf("\n");
+        glDeleteBuffers(1, &buffer);
+    }
+    else
+    {
+        printf("  (%d stalls)\n", stream.stallCount());
+        stream.destroy();
+    }
+    glDeleteVertexArrays(1, &vao);
+}
+
+void benchmarkStreamBuffer(int triangleCount)
+{
+    SDL_GLContext context;
+    GLuint framebuffer;
+    GLuint renderbuffers[2];
+    SDL_Window* window = createBenchmarkContext(&context, &framebuffer, renderbuffers);
+    if(!window)
+    {
+        return;
+    }
+
+    GLuint program = compileBenchmarkProgram(streamVertexShader, streamFragmentShader);
+    if(program)
+    {
+        glUseProgram(program);
+        const int frameCount = 200;
+        printf("Streaming %d triangles (%.2f MB) every frame for %d frames\n", triangleCount,
+               9 * sizeof(float) * triangleCount / (1024.0 * 1024.0), frameCount);
+        benchmarkStreamMethod("glBufferData:", STREAM_BUFFER_DATA, triangleCount, frameCount);
+        benchmarkStreamMethod("glBufferSubData:", STREAM_BUFFER_SUB_DATA, triangleCount, frameCount);
+        benchmarkStreamMethod("map unsynchronized:", STREAM_MAP_UNSYNCHRONIZED, triangleCount, frameCount);
+        benchmarkStreamMethod("map persistent:", STREAM_MAP_PERSISTENT, triangleCount, frameCount);
+        glDeleteProgram(program);
+    }
+
+    destroyBenchmarkContext(window, context, framebuffer, renderbuffers);
+}
+
+// The same as SimpleTransform.vertexshader and SingleColor.fragmentshader, apart from the camera
+// which is left out
+static const char* instanceVertexShader =
+    "#version 330 core\n"
+    "layout(location = 0) in vec3 position;\n"
+    "layout(location = 5) in mat4 instanceTransform;\n"
+    "layout(location = 9) in vec4 instanceColor;\n"
+    "uniform mat4 Model;\n"
+    "out vec4 fragmentColor;\n"
+    "void main()\n"
+    "{\n"
+    "    gl_Position = Model * instanceTransform * vec4(position, 1.0);\n"
+    "    fragmentColor = instanceColor;\n"
+    "}\n";
+
+static const char* instanceFragmentShader =
+    "#version 330 core\n"
+    "in vec4 fragmentColor;\n"
+    "out vec3 color;\n"
+    "void main()\n"
+    "{\n"
+    "    color = fragmentColor.rgb;\n"
+    "}\n";
+
+enum InstanceDrawMethod
+{
+    INSTANCE_DRAW_SEPARATELY,
+    INSTANCE_DRAW_INSTANCED,
+    INSTANCE_DRAW_INSTANCED_ONE_COLOR
+};
+
+// A small cube, standing in for the low detail meshes that crowds are made of
+static void uploadInstanceCube(Mesh& mesh)
+{
+    const float positions[] = {
+        -1, -1, -1,   1, -1, -1,   1,  1, -1,  -1,  1, -1,
+        -1, -1,  1,   1, -1,  1,   1,  1,  1,  -1,  1,  1
+    };
+    const unsigned short indices[] = {
+        0, 2, 1,  0, 3, 2,   4, 5, 6,  4, 6, 7,   0, 1, 5,  0, 5, 4,
+        3, 6, 2,  3, 7, 6,   0, 4, 7,  0, 7, 3,   1, 2, 6,  1, 6, 5
+    };
+    VertexStreams streams = {};
+    streams.vertexCount = 8;
+    streams.indexCount = 36;
+    streams.indexSize = 2;
+    streams.positions = positions;
+    streams.indices = indices;
+    mesh.upload(streams);
+}
+
+// Draws instanceCount cubes for frameCount frames, either with a draw call (and a new Model
+// matrix) each as the window draws its model, or instanced. Returns the average time per frame
+// and fills in a checksum of the last frame, to check every method draws the same thing
+static double benchmarkInstanceMethod(const char* label, InstanceDrawMethod method, Mesh& mesh,
+                                      GLint modelLocation, InstanceBuffer& instances,
+                                      const vector<glm::mat4>& transforms, const vector<glm::vec4>& colors,
+                                      int frameCount, unsigned int* checksum)
+{
+    int instanceCount = transforms.size();
+    glm::mat4 identity(1.0f);
+    glUniformMatrix4fv(modelLocation, 1, GL_FALSE, &identity[0][0]);
+    setSingleInstanceAttributes(glm::vec4(1.0f));
+
+    // One untimed frame first, so that any lazy driver work isn't counted
+    glFinish();
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for(int frame=-1; frame<frameCount; frame++)
+    {
+        if(frame == 0)
+        {
+            glFinish();
+            start = chrono::steady_clock::now();
+        }
+
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        if(method == INSTANCE_DRAW_SEPARATELY)
+        {
+            for(int i=0; i<instanceCount; i++)
+            {
+                glUniformMatrix4fv(modelLocation, 1, GL_FALSE, (const GLfloat*)&transforms[i]);
+                glVertexAttrib4f(INSTANCE_COLOR_LOCATION, colors[i].x, colors[i].y, colors[i].z, colors[i].w);
+                mesh.draw();
+            }
+        }
+        else
+        {
+            bool oneColor = (method == INSTANCE_DRAW_INSTANCED_ONE_COLOR);
+            instances.submit(&transforms[0], instanceCount, oneColor ? 0 : &colors[0], colors[0]);
+            instances.draw(mesh);
+            instances.endFrame();
+        }
+    }
+    glFinish();
+    double time = secondsSince(start) / frameCount;
+
+    vector<unsigned char> pixels(4 * 640 * 480);
+    glReadPixels(0, 0, 640, 480, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+    *checksum = 0;
+    for(size_t i=0; i<pixels.size(); i++)
+    {
+        *checksum = (*checksum * 31) + pixels[i];
+    }
+
+    printf("  %-26s %9.3f ms  %8.2f M instances/s\n", label, 1000.0 * time,
+           instanceCount / (1e6 * time));
+    return time;
+}
+
+void benchmarkInstancing(int maxInstances)
+{
+    SDL_GLContext context;
+    GLuint framebuffer;
+    GLuint renderbuffers[2];
+    SDL_Window* window = createBenchmarkContext(&context, &framebuffer, renderbuffers);
+    if(!window)
+    {
+        return;
+    }
+
+    GLuint program = compileBenchmarkProgram(instanceVertexShader, instanceFragmentShader);
+    InstanceBuffer instances;
+    if(program && instances.create(maxInstances))
+    {
+        glUseProgram(program);
+        glEnable(GL_CULL_FACE);
+        GLint modelLocation = glGetUniformLocation(program, "Model");
+        Mesh mesh;
+        uploadInstanceCube(mesh);
+
+        // NOTE: A fixed seed so every run draws the same crowd
+        srand(1234);
+        for(int instanceCount=1000; instanceCount<=maxInstances; instanceCount*=10)
+        {
+            // The cubes are spread over a grid covering the screen, each spun a random amount, and
+            // small enough that the time goes on the draws rather than filling pixels
+            int columns = (int)sqrtf((float)instanceCount) + 1;
+            float cellSize = 2.0f / columns;
+            vector<glm::mat4> transforms(instanceCount);
+            vector<glm::vec4> colors(instanceCount);
+            for(int i=0; i<instanceCount; i++)
+            {
+                glm::vec3 center(-1.0f + cellSize * ((i % columns) + 0.5f),
+                                 -1.0f + cellSize * ((i / columns) + 0.5f), 0.0f);
+                float angle = (rand() / (float)RAND_MAX) * 6.283f;
+                transforms[i] = glm::translate(glm::mat4(1.0f), center);
+                transforms[i] = glm::rotate(transforms[i], angle, glm::vec3(1, 1, 0));
+                transforms[i] = glm::scale(transforms[i], glm::vec3(0.3f * cellSize));
+                colors[i] = glm::vec4(rand() / (float)RAND_MAX, rand() / (float)RAND_MAX,
+                                      rand() / (float)RAND_MAX, 1.0f);
+            }
+
+            // Enough frames to take a moment with the slowest method
+            int frameCount = max(5, 2000000 / instanceCount);
+            printf("%d instances of a %d triangle mesh, average of %d frames\n", instanceCount,
+                   mesh.indexCount()/3, frameCount);
+            unsigned int separateChecksum;
+            unsigned int instancedChecksum;
+            unsigned int oneColorChecksum;
+            double separateTime = benchmarkInstanceMethod("one draw each:", INSTANCE_DRAW_SEPARATELY, mesh,
+                                                          modelLocation, instances, transforms, colors,
+                                                          frameCount, &separateChecksum);
+            double instancedTime = benchmarkInstanceMethod("instanced:", INSTANCE_DRAW_INSTANCED, mesh,
+                                                           modelLocation, instances, transforms, colors,
+                                                           frameCount, &instancedChecksum);
+            printf("  %-26s %.2fx, %s\n", "", separateTime / instancedTime,
+                   (instancedChecksum == separateChecksum) ? "identical" : "MISMATCH");
+            benchmarkInstanceMethod("instanced, one colour:", INSTANCE_DRAW_INSTANCED_ONE_COLOR, mesh,
+                                    modelLocation, instances, transforms, colors, frameCount,
+                                    &oneColorChecksum);
+        }
+        if(instances.stallCount() > 0)
+        {
+            printf("  stalled waiting for the GPU %d times\n", instances.stallCount());
+        }
+        mesh.cleanup();
+    }
+    instances.destroy();
+    if(program)
+    {
+        glDeleteProgram(program);
+    }
+
+    destroyBenchmarkContext(window, context, framebuffer, renderbuffers);
+}
+
+static Uint64 randomInputInterval(Uint64 meanTicks)
+{
+    return (Uint64)((rand() / (double)RAND_MAX) * 2 * meanTicks);
+}
+
+// Runs frames the way the main loop does and measures how long input waits to be seen on screen.
+// The input is simulated, with events arriving at random times (every 4ms on average, like a
+// 250Hz mouse), and each frame takes every event that has arrived when it starts as the real loop
+// polls the event queue. An event's latency runs from when it arrived until the frame that read it
+// has finished on the GPU, which stands in for it reaching the display. Without a pacer this runs
+// the old loop, which slept for 10ms after every frame
+static void benchmarkPacingLoop(const char* label, FramePacer* pacer, int triangleCount, int frameCount)
+{
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 meanInputTicks = frequency / 250;
+    srand(1234);
+
+    vector<double> latencies;
+    vector<double> frameTimes;
+    Uint64 nextInput = SDL_GetPerformanceCounter() + randomInputInterval(meanInputTicks);
+    Uint64 start = SDL_GetPerformanceCounter();
+    Uint64 lastFrame = start;
+    for(int frame=0; frame<frameCount; frame++)
+    {
+        if(pacer)
+        {
+            pacer->waitForNextFrame();
+            pacer->beginFrame();
+        }
+
+        Uint64 frameStart = SDL_GetPerformanceCounter();
+        vector<Uint64> inputs;
+        while(nextInput <= frameStart)
+        {
+            inputs.push_back(nextInput);
+            nextInput += randomInputInterval(meanInputTicks);
+        }
+        if(frame > 0)
+        {
+            frameTimes.push_back((1000.0 * (frameStart - lastFrame)) / frequency);
+        }
+        lastFrame = frameStart;
+
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glDrawArrays(GL_TRIANGLES, 0, 3*triangleCount);
+        glFinish();
+
+        Uint64 frameEnd = SDL_GetPerformanceCounter();
+        for(size_t i=0; i<inputs.size(); i++)
+        {
+            latencies.push_back((1000.0 * (frameEnd - inputs[i])) / frequency);
+        }
+
+        if(!pacer)
+        {
+            SDL_Delay(10);
+        }
+    }
+    double seconds = (double)(SDL_GetPerformanceCounter() - start) / frequency;
+
+    double frameTimeTotal = 0.0;
+    for(size_t i=0; i<frameTimes.size(); i++)
+    {
+        frameTimeTotal += frameTimes[i];
+    }
+    double frameTimeAverage = frameTimeTotal / frameTimes.size();
+    double frameTimeVariance = 0.0;
+    for(size_t i=0; i<frameTimes.size(); i++)
+    {
+        frameTimeVariance += (frameTimes[i] - frameTimeAverage) * (frameTimes[i] - frameTimeAverage);
+    }
+    double jitter = sqrt(frameTimeVariance / frameTimes.size());
+
+    sort(latencies.begin(), latencies.end());
+    double latencyTotal = 0.0;
+    for(size_t i=0; i<latencies.size(); i++)
+    {
+        latencyTotal += latencies[i];
+    }
+    printf("  %-22s %7.1f fps  frame jitter %6.3fms  input latency avg %6.2fms p99 %6.2fms\n", label,
+           frameCount / seconds, jitter, latencyTotal / latencies.size(),
+           latencies[(size_t)ceil(0.99 * latencies.size()) - 1]);
+}
+
+void benchmarkFramePacing(int triangleCount)
+{
+    SDL_GLContext context;
+    GLuint framebuffer;
+    GLuint renderbuffers[2];
+    SDL_Window* window = createBenchmarkContext(&context, &framebuffer, renderbuffers);
+    if(!window)
+    {
+        return;
+    }
+
+    GLuint program = compileBenchmarkProgram(streamVertexShader, streamFragmentShader);
+    if(program)
+    {
+        glUseProgram(program);
+
+        // The scene is just a static grid of triangles, drawn every frame
+        vector<float> positions(9 * (size_t)triangleCount);
+        writeStreamFrame(&positions[0], triangleCount, 0);
+        GLuint vao;
+        glGenVertexArrays(1, &vao);
+        glBindVertexArray(vao);
+        GLuint buffer;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(float), &positions[0], GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+        // NOTE: The benchmark window is hidden, so vsync can't be measured here
+        const int frameCount = 300;
+        printf("Drawing %d triangles for %d frames with each loop\n", triangleCount, frameCount);
+        benchmarkPacingLoop("SDL_Delay(10) loop:", 0, triangleCount, frameCount);
+        FramePacer pacer;
+        pacer.setPacing(FRAME_PACING_CAPPED, 60.0);
+        benchmarkPacingLoop("capped at 60fps:", &pacer, triangleCount, frameCount);
+        pacer.setPacing(FRAME_PACING_CAPPED, 100.0);
+        benchmarkPacingLoop("capped at 100fps:", &pacer, triangleCount, frameCount);
+        pacer.setPacing(FRAME_PACING_UNCAPPED);
+        benchmarkPacingLoop("uncapped:", &pacer, triangleCount, frameCount);
+
+        glDeleteBuffers(1, &buffer);
+        glDeleteVertexArrays(1, &vao);
+        glDeleteProgram(program);
+    }
+
+    destroyBenchmarkContext(window, context, framebuffer, renderbuffers);
+}
@@ -0,0 +1,70 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <string>
+
+// Command line benchmarks, these are run from main before any window or GL context is created
+// (see the usage printed by main for the flags that select them)
+
+// Loads the same OBJ file with each loader path and reports the throughput of each, along with
+// whether they produced identical geometry, with the parse timed separately from the whole load.
+// The parallel loader is run with 1 up to (at least) 16 threads to show how it scales
+void benchmarkOBJLoading(std::string filename, int iterations);
+
+// Loads an OBJ with one loader (since peak memory use can only be measured once per process) and
+// reports the time taken and the peak resident memory. mode is "stream" for loadOBJFileStreaming
+// into a sink that just counts the triangles, "geometry" for streaming into a GeometryData, or
+// "mapped" for the memory mapped loader to compare against
+void benchmarkStreamingLoad(std::string filename, std::string mode);
+
+// Loads an OBJ with each loader in turn and reports the number of allocations each made, the peak
+// amount of memory allocated while loading and the size of the final geometry
+void benchmarkLoaderAllocations(std::string filename);
+
+// Writes fileCount small OBJ files into directory (which must exist) and loads them all, one after
+// another, with each loader both with and without a ScratchArena for the temporary data. Reports
+// the time and the number of allocations per file, then deletes the files again
+void benchmarkBulkLoading(std::string directory, int fileCount);
+
+// Runs the vertex cache optimization over an OBJ file, both on the indexed loader output and on the
+// welded un-indexed output, and reports the ACMR/ATVR before and after along with the time taken
+void benchmarkVertexCache(std::string filename);
+
+// Uploads and draws an OBJ with the separate (one buffer per attribute) and interleaved vertex
+// layouts, reporting the upload size and time and the GPU time per draw for each. This opens a
+// hidden window to get a GL context
+void benchmarkVertexLayouts(std::string filename);
+
+// Packs an OBJ with a range of compressed vertex formats and reports the vertex size and the largest
+// position, texture coordinate and angular errors of each, to help pick safe settings per model
+void benchmarkVertexCompression(std::string filename);
+
+// Rewrites a grid of triangles every frame and draws it, uploading with glBufferData,
+// glBufferSubData and a StreamBuffer (both mapped unsynchronized and persistently mapped), and
+// reports the time per frame of each. Like --bench-layout this opens a hidden window
+void benchmarkStreamBuffer(int triangleCount);
+
+// Draws a grid of triangles with the old main loop (which slept for 10ms after every frame) and
+// with the FramePacer capped at 60 and 100 frames per second and uncapped, and reports the frame
+// rate, the frame time jitter and the latency of simulated input events. Like --bench-layout this
+// opens a hidden window
+void benchmarkFramePacing(int triangleCount);
+
+// Generates the (bi)tangents of a random in memory mesh with the original per face loop, the
+// batched scalar kernel and the batched SIMD kernel, and reports the time taken by each along with
+// whether they all produced identical results. Then builds smooth tangent frames for a grid of the
+// same size with 1 to 8 threads, to check the results don't depend on the thread count
+void benchmarkTangents(int triangleCount);
+
+// Draws a crowd of 1,000 small meshes, then 10,000 and so on up to maxInstances, with a draw call
+// each and then instanced through an InstanceBuffer (with a colour per instance, and with one
+// colour for all of them), and reports the time per frame of each. Like --bench-layout this opens a
+// hidden window
+void benchmarkInstancing(int maxInstances);
+
+// Builds a scene graph of nodeCount nodes and times updating its world transforms when nothing,
+// a few leaves, a few nodes anywhere in the hierarchy and the root move each frame, against
+// recomputing every node every frame. Also checks the cached transforms match a full recompute
+void benchmarkSceneGraph(int nodeCount);
+
+#endif
@@ -0,0 +1,139 @@
+#include <iostream>
+
+#include <string.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#include "filewatcher.h"
+
+#ifndef __linux__
+
+FileWatcher::FileWatcher()
+    : inotifyDescriptor(-1)
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+}
+
+bool FileWatcher::watch(string filename)
+{
+    cout << "Watching files is only supported on linux, " << filename << " won't be reloaded" << endl;
+    return false;
+}
+
+vector<string> FileWatcher::changedFiles()
+{
+    return vector<string>();
+}
+
+#else
+
+FileWatcher::FileWatcher()
+{
+    inotifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(inotifyDescriptor < 0)
+    {
+        cout << "Unable to start watching files: " << strerror(errno) << endl;
+    }
+}
+
+FileWatcher::~FileWatcher()
+{
+    if(inotifyDescriptor >= 0)
+    {
+        close(inotifyDescriptor);
+    }
+}
+
+bool FileWatcher::watch(string filename)
+{
+    if(inotifyDescriptor < 0)
+    {
+        return false;
+    }
+
+    WatchedFile file;
+    file.filename = filename;
+    string directory = ".";
+    size_t slash = filename.find_last_of('/');
+    if(slash == string::npos)
+    {
+        file.name = filename;
+    }
+    else
+    {
+        directory = filename.substr(0, slash + 1);
+        file.name = filename.substr(slash + 1);
+    }
+
+    // NOTE: Only finished writes are watched for (not IN_MODIFY), so we don't see a file that's only
+    //       been partly written. Watching the same directory twice just gives the same descriptor
+    file.watchDescriptor = inotify_add_watch(inotifyDescriptor, directory.c_str(),
+                                             IN_CLOSE_WRITE | IN_MOVED_TO);
+    if(file.watchDescriptor < 0)
+    {
+        cout << "Unable to watch " << filename << ": " << strerror(errno) << endl;
+        return false;
+    }
+    files.push_back(file);
+    return true;
+}
+
+vector<string> FileWatcher::changedFiles()
+{
+    vector<string> changed;
+    if(inotifyDescriptor < 0)
+    {
+        return changed;
+    }
+
+    // The buffer has to be aligned for inotify_event, and big enough for at least one event with
+    // the longest name
+    alignas(struct inotify_event) char buffer[4096];
+    while(true)
+    {
+        ssize_t length = read(inotifyDescriptor, buffer, sizeof(buffer));
+        if(length <= 0)
+        {
+            // EAGAIN just means there's nothing more to read
+            break;
+        }
+
+        for(char* next = buffer; next < buffer + length; )
+        {
+            const struct inotify_event* event = (const struct inotify_event*)next;
+            next += sizeof(struct inotify_event) + event->len;
+            if(event->len == 0)
+            {
+                continue;
+            }
+            for(size_t i=0; i<files.size(); i++)
+            {
+                if((files[i].watchDescriptor != event->wd) || (files[i].name != event->name))
+                {
+                    continue;
+                }
+                bool alreadyChanged = false;
+                for(size_t j=0; j<changed.size(); j++)
+                {
+                    alreadyChanged = alreadyChanged || (changed[j] == files[i].filename);
+                }
+                if(!alreadyChanged)
+                {
+                    changed.push_back(files[i].filename);
+                }
+            }
+        }
+    }
+    return changed;
+}
+
+#endif
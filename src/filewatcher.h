@@ -0,0 +1,43 @@
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <string>
+#include <vector>
+
+// Tells us when files have been saved, so that things loaded from them (shaders, for now) can be
+// reloaded while the program is running. The kernel queues the changes in the background with
+// inotify, and changedFiles just collects them without ever blocking, so it's cheap enough to call
+// every frame.
+// The directories the files are in are watched rather than the files themselves, since a lot of
+// editors save by writing a new file and renaming it over the old one, which would end a watch on
+// the old file
+// NOTE: This is only implemented on linux, elsewhere watch just fails and nothing ever changes
+class FileWatcher
+{
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    // filename is reported back exactly as it's given here
+    bool watch(std::string filename);
+
+    // Returns each watched file that has been saved since the last call, once (however many times
+    // it was written in between)
+    std::vector<std::string> changedFiles();
+
+private:
+    FileWatcher(const FileWatcher&);
+    FileWatcher& operator=(const FileWatcher&);
+
+    struct WatchedFile
+    {
+        std::string filename;
+        std::string name; // Without the directory, as inotify reports it
+        int watchDescriptor;
+    };
+
+    int inotifyDescriptor;
+    std::vector<WatchedFile> files;
+};
+
+#endif
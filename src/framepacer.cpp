@@ -0,0 +1,97 @@
+#include "framepacer.h"
+
+// NOTE: More updates than this are never run in one frame. The rest of the time is dropped, which
+//       slows the simulation down rather than letting a slow frame cause even slower ones
+static const int MAX_UPDATES_PER_FRAME = 8;
+
+// NOTE: SDL_Delay can oversleep by a millisecond or more (a lot more on Windows, depending on the
+//       timer resolution), so we only sleep until this close to the deadline and then spin
+static const double SLEEP_MARGIN_SECONDS = 0.002;
+
+FramePacer::FramePacer(double updateRate)
+    : mode(FRAME_PACING_VSYNC), frequency(SDL_GetPerformanceFrequency()), frameTicks(0), nextFrame(0),
+      lastFrame(0), accumulated(0)
+{
+    updateTicks = frequency / updateRate;
+}
+
+void FramePacer::setPacing(FramePacing pacing, double frameRate)
+{
+    mode = pacing;
+    frameTicks = (frameRate > 0.0) ? (Uint64)(frequency / frameRate) : 0;
+    nextFrame = 0;
+}
+
+FramePacing FramePacer::pacing()
+{
+    return mode;
+}
+
+void FramePacer::waitForNextFrame()
+{
+    if((mode != FRAME_PACING_CAPPED) || (frameTicks == 0))
+    {
+        return;
+    }
+
+    Uint64 now = SDL_GetPerformanceCounter();
+    if(nextFrame == 0)
+    {
+        nextFrame = now;
+    }
+    if(now < nextFrame)
+    {
+        sleepUntil(nextFrame);
+        nextFrame += frameTicks;
+    }
+    else
+    {
+        // A frame that runs late moves the schedule along with it, otherwise the following frames
+        // would run back to back trying to catch up
+        nextFrame = now + frameTicks;
+    }
+}
+
+int FramePacer::beginFrame()
+{
+    Uint64 now = SDL_GetPerformanceCounter();
+    if(lastFrame == 0)
+    {
+        lastFrame = now;
+    }
+    accumulated += now - lastFrame;
+    lastFrame = now;
+
+    int updateCount = accumulated / updateTicks;
+    accumulated -= updateCount * updateTicks;
+    if(updateCount > MAX_UPDATES_PER_FRAME)
+    {
+        updateCount = MAX_UPDATES_PER_FRAME;
+    }
+    return updateCount;
+}
+
+double FramePacer::timestep()
+{
+    return (double)updateTicks / frequency;
+}
+
+double FramePacer::interpolation()
+{
+    return (double)accumulated / updateTicks;
+}
+
+void FramePacer::sleepUntil(Uint64 time)
+{
+    Uint64 marginTicks = SLEEP_MARGIN_SECONDS * frequency;
+    Uint64 now = SDL_GetPerformanceCounter();
+    while(now < time)
+    {
+        Uint64 remaining = time - now;
+        if(remaining > marginTicks)
+        {
+            SDL_Delay((Uint32)((1000 * (remaining - marginTicks)) / frequency));
+        }
+        now = SDL_GetPerformanceCounter();
+    }
+}
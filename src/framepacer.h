@@ -0,0 +1,55 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include "SDL.h"
+
+enum FramePacing
+{
+    FRAME_PACING_VSYNC, // The swap waits for the display, so the pacer doesn't wait at all
+    FRAME_PACING_CAPPED, // The pacer waits so that frames start at a fixed rate
+    FRAME_PACING_UNCAPPED // Frames are rendered as fast as possible
+};
+
+// Decides when frames start and how far the simulation moves on each frame. The simulation always
+// advances in fixed steps of 1/updateRate seconds, as many as the time since the last frame covers,
+// so it behaves the same at any frame rate. Whatever time is left over is given as an
+// interpolation factor, for rendering part way between the last two steps so that the motion is
+// still smooth when the frame rate doesn't match the update rate
+// NOTE: All of the timing uses SDL_GetPerformanceCounter, since millisecond ticks are too coarse to
+//       pace frames that only last a few milliseconds
+class FramePacer
+{
+public:
+    explicit FramePacer(double updateRate = 120.0);
+
+    // frameRate is only used when capped
+    void setPacing(FramePacing pacing, double frameRate = 60.0);
+    FramePacing pacing();
+
+    // When capped, sleeps until the next frame is due. This should be called before input is read,
+    // so that the input is as recent as possible when the frame is rendered
+    void waitForNextFrame();
+
+    // Called once at the start of each frame, returns the number of fixed updates to run. After a
+    // long pause (such as a breakpoint or the window being dragged) the extra time is dropped,
+    // rather than running a burst of updates that would make the next frame slow too
+    int beginFrame();
+
+    // In seconds
+    double timestep();
+    // How far between the last two updates this frame falls, from 0 to 1
+    double interpolation();
+
+private:
+    void sleepUntil(Uint64 time);
+
+    FramePacing mode;
+    Uint64 frequency;
+    Uint64 updateTicks;
+    Uint64 frameTicks; // Between the starts of capped frames
+    Uint64 nextFrame;
+    Uint64 lastFrame;
+    Uint64 accumulated; // Time not yet simulated
+};
+
+#endif
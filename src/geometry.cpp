@@ -1,19 +1,27 @@
+#include <chrono>
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <thread>
 
 #include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 using namespace std;
 
 #include "geometry.h"
+#include "mappedfile.h"
+#include "scratcharena.h"
+#include "tangents.h"
+#include "triangulate.h"
 
 // NOTE: The WaveFront OBJ format spec, states that meshes are allowed to be defined by faces
-//       consisting of 3 or more vertices. For the purposes of this loader (and since this is the
-//       most common case) we only support triangle faces (defined by exactly 3 vertices) and as a
-//       result, the loader will ignore any data after the third vertex for each face
+//       consisting of 3 or more vertices. The loaders split these into triangles as they go (see
+//       triangulatePolygon), though any vertices past MAX_POLYGON_CORNERS are ignored
 //
-//       Similarly, the spec allows for vertex positions and texture coordinates to both have a
+//       The spec also allows for vertex positions and texture coordinates to both have a
 //       w-coordinate. The loader will ignore these and assumes that all vertex specifications contain
 //       exactly 3 values, and that all texture coordinate specifications contain exactly 2 values
 
@@ -31,9 +39,151 @@ enum OBJDataType
     COMMENT
 };
 
-void GeometryData::loadFromOBJFile(string filename)
+// How many of each kind of record a range of an OBJ file holds, so that everything can be
+// allocated once at the right size up front instead of growing (and copying) as it's parsed
+struct OBJRecordCounts
 {
-    GeometryData tempGeom;
+    size_t vertices;
+    size_t textureCoords;
+    size_t normals;
+    size_t triangles; // After polygons are split up
+};
+
+// A quick pass over the text that only looks at the start of each line (and the vertex count of
+// faces), which is far cheaper than actually parsing the numbers. The counts are added to counts
+static void countOBJRecords(const char* start, const char* end, OBJRecordCounts* counts)
+{
+    const char* p = start;
+    while(p < end)
+    {
+        while((p < end) && ((*p == ' ') || (*p == '\t') || (*p == '\r') || (*p == '\n')))
+        {
+            p++;
+        }
+        if(p >= end)
+        {
+            break;
+        }
+
+        char typeChar1 = *p++;
+        char typeChar2 = (p < end) ? *p : '\0';
+        if(typeChar1 == 'v')
+        {
+            counts->vertices += ((typeChar2 == ' ') || (typeChar2 == '\t')) ? 1 : 0;
+            counts->textureCoords += (typeChar2 == 't') ? 1 : 0;
+            counts->normals += (typeChar2 == 'n') ? 1 : 0;
+        }
+        else if(typeChar1 == 'f')
+        {
+            // Each run of non-whitespace is one vertex of the face
+            int cornerCount = 0;
+            bool inCorner = false;
+            while((p < end) && (*p != '\n') && (*p != '#'))
+            {
+                bool isSpace = (*p == ' ') || (*p == '\t') || (*p == '\r');
+                cornerCount += (!isSpace && !inCorner) ? 1 : 0;
+                inCorner = !isSpace;
+                p++;
+            }
+            cornerCount = (cornerCount > MAX_POLYGON_CORNERS) ? MAX_POLYGON_CORNERS : cornerCount;
+            counts->triangles += (cornerCount >= 3) ? (cornerCount - 2) : 0;
+        }
+
+        const char* newline = (const char*)memchr(p, '\n', end - p);
+        p = newline ? (newline + 1) : end;
+    }
+}
+
+static void reserveOBJRecords(const OBJRecordCounts& counts, ScratchVector<float>& vertices,
+                              ScratchVector<float>& textureCoords, ScratchVector<float>& normals,
+                              ScratchVector<FaceData>& faces)
+{
+    vertices.reserve(vertices.size() + 3*counts.vertices);
+    textureCoords.reserve(textureCoords.size() + 2*counts.textureCoords);
+    normals.reserve(normals.size() + 3*counts.normals);
+    faces.reserve(faces.size() + counts.triangles);
+}
+
+// The v/vt/vn records and triangles of a whole file, which are only needed until they've been
+// turned into the final vertex streams, so they're kept in the caller's scratch arena if there is one
+struct OBJRecords
+{
+    OBJRecords(ScratchArena* arena)
+        : vertices(arena), textureCoords(arena), normals(arena), faces(arena)
+    {
+    }
+
+    ScratchVector<float> vertices;
+    ScratchVector<float> textureCoords;
+    ScratchVector<float> normals;
+    ScratchVector<FaceData> faces;
+};
+
+// Redoes the triangulation of a polygon that was split as a fan (because its positions weren't
+// known yet, e.g. a face referring forward to vertices later in the file), now that they are
+static void retriangulateFan(FaceData* faces, int cornerCount, const ScratchVector<float>& vertices)
+{
+    // NOTE: A fan of triangles (0, i, i+1) has every corner as the third vertex of a triangle, apart
+    //       from the first two
+    int cornerVertices[MAX_POLYGON_CORNERS];
+    int cornerTexCoords[MAX_POLYGON_CORNERS];
+    int cornerNormals[MAX_POLYGON_CORNERS];
+    for(int corner=0; corner<cornerCount; corner++)
+    {
+        const FaceData& face = (corner < 2) ? faces[0] : faces[corner-2];
+        int index = (corner < 2) ? corner : 2;
+        cornerVertices[corner] = face.vertexIndex[index];
+        cornerTexCoords[corner] = face.texCoordIndex[index];
+        cornerNormals[corner] = face.normalIndex[index];
+    }
+
+    int triangles[3*(MAX_POLYGON_CORNERS-2)];
+    triangulatePolygon(vertices.empty() ? 0 : &vertices[0], vertices.size() / 3, cornerVertices,
+                       cornerCount, triangles);
+    for(int triangle=0; triangle<cornerCount-2; triangle++)
+    {
+        for(int index=0; index<3; index++)
+        {
+            int corner = triangles[(3*triangle)+index];
+            faces[triangle].vertexIndex[index] = cornerVertices[corner];
+            faces[triangle].texCoordIndex[index] = cornerTexCoords[corner];
+            faces[triangle].normalIndex[index] = cornerNormals[corner];
+        }
+    }
+}
+
+// pendingPolygons holds pairs of (first face, corner count) for the polygons to redo
+static void retriangulatePendingPolygons(const ScratchVector<int>& pendingPolygons, OBJRecords& tempGeom)
+{
+    for(size_t i=0; i<pendingPolygons.size(); i+=2)
+    {
+        retriangulateFan(&tempGeom.faces[pendingPolygons[i]], pendingPolygons[i+1], tempGeom.vertices);
+    }
+}
+
+GeometryData::GeometryData()
+    : indexed(false), parseSeconds(0.0)
+{
+}
+
+void GeometryData::setIndexed(bool indexed)
+{
+    this->indexed = indexed;
+}
+
+bool GeometryData::isIndexed()
+{
+    return indexed;
+}
+
+void GeometryData::loadFromOBJFile(string filename, ScratchArena* scratch)
+{
+    chrono::steady_clock::time_point parseStart = chrono::steady_clock::now();
+    if(scratch)
+    {
+        scratch->reset();
+    }
+    OBJRecords tempGeom(scratch);
 
     ifstream inStream;
     inStream.open(filename, ifstream::in);
@@ -43,6 +193,20 @@ void GeometryData::loadFromOBJFile(string filename)
         return;
     }
 
+    // NOTE: The stream itself can't be rewound cheaply, so the file is mapped just for counting
+    MappedFile countFile;
+    if(countFile.open(filename))
+    {
+        OBJRecordCounts counts = {};
+        countOBJRecords(countFile.data(), countFile.data() + countFile.size(), &counts);
+        reserveOBJRecords(counts, tempGeom.vertices, tempGeom.textureCoords, tempGeom.normals,
+                          tempGeom.faces);
+        countFile.close();
+    }
+
+    // Polygons that refer to vertices we haven't read yet, see retriangulatePendingPolygons
+    ScratchVector<int> pendingPolygons(scratch);
+
     OBJDataType currentDataType = NONE;
     while(!inStream.eof())
     {
@@ -134,42 +298,89 @@ void GeometryData::loadFromOBJFile(string filename)
 
         case FACE:
         {
-            // NOTE: Here is where we assume that exactly 3 vertices are used to specify a face
-            int vertIndex = 0;
-            int texCoordIndex = 0;
-            int normalIndex = 0;
-
-            FaceData face = {};
-            for(int index=0; index<3; index++)
+            // Read every vertex of the face first, then split it into triangles
+            int cornerVertices[MAX_POLYGON_CORNERS];
+            int cornerTexCoords[MAX_POLYGON_CORNERS];
+            int cornerNormals[MAX_POLYGON_CORNERS];
+            int cornerCount = 0;
+            bool moreCorners = true;
+            while(moreCorners)
             {
+                int vertIndex = 0;
+                int texCoordIndex = 0;
+                int normalIndex = 0;
+
                 inStream >> vertIndex;
-                char postVertexCheckChar = inStream.get();
-                if(postVertexCheckChar == '/')
+                if(inStream.fail())
+                {
+                    inStream.clear();
+                    break;
+                }
+                if(inStream.peek() == '/')
                 {
-                    char texCoordExistCheckChar = inStream.get();
-                    inStream.unget();
-                    if(texCoordExistCheckChar != '/')
+                    inStream.get();
+                    if(inStream.peek() != '/')
                     {
                         inStream >> texCoordIndex;
                     }
-
-                    char postTexCoordCheckChar = inStream.get();
-                    if(postTexCoordCheckChar == '/')
+                    if(inStream.peek() == '/')
                     {
+                        inStream.get();
                         inStream >> normalIndex;
                     }
-                    else
+                }
+
+                // NOTE: We subtract 1 here because the OBJ format uses 1-based indices
+                if(cornerCount < MAX_POLYGON_CORNERS)
+                {
+                    cornerVertices[cornerCount] = vertIndex - 1;
+                    cornerTexCoords[cornerCount] = texCoordIndex - 1;
+                    cornerNormals[cornerCount] = normalIndex - 1;
+                    cornerCount++;
+                }
+
+                // Another vertex follows if there's a number before the end of the line (which we
+                // leave for the COMMENT state to consume)
+                int nextChar = inStream.peek();
+                while((nextChar == ' ') || (nextChar == '\t') || (nextChar == '\r'))
+                {
+                    inStream.get();
+                    nextChar = inStream.peek();
+                }
+                moreCorners = ((nextChar >= '0') && (nextChar <= '9')) || (nextChar == '-') ||
+                              (nextChar == '+');
+            }
+
+            if(cornerCount >= 3)
+            {
+                int vertexCount = tempGeom.vertices.size() / 3;
+                bool positionsKnown = true;
+                for(int corner=0; corner<cornerCount; corner++)
+                {
+                    positionsKnown = positionsKnown && (cornerVertices[corner] < vertexCount);
+                }
+                if(!positionsKnown && (cornerCount > 3))
+                {
+                    pendingPolygons.push_back(tempGeom.faces.size());
+                    pendingPolygons.push_back(cornerCount);
+                }
+
+                int triangles[3*(MAX_POLYGON_CORNERS-2)];
+                triangulatePolygon(tempGeom.vertices.empty() ? 0 : &tempGeom.vertices[0],
+                                   vertexCount, cornerVertices, cornerCount, triangles);
+                for(int triangle=0; triangle<cornerCount-2; triangle++)
+                {
+                    FaceData face = {};
+                    for(int index=0; index<3; index++)
                     {
-                        inStream.unget(); // This is just to prevent us from consuming a newline
+                        int corner = triangles[(3*triangle)+index];
+                        face.vertexIndex[index] = cornerVertices[corner];
+                        face.texCoordIndex[index] = cornerTexCoords[corner];
+                        face.normalIndex[index] = cornerNormals[corner];
                     }
+                    tempGeom.faces.push_back(face);
                 }
-                
-                // NOTE: We subtract 1 here because the OBJ format uses 1-based indices
-                face.vertexIndex[index] = vertIndex - 1;
-                face.texCoordIndex[index] = texCoordIndex - 1;
-                face.normalIndex[index] = normalIndex - 1;
             }
-            tempGeom.faces.push_back(face);
             currentDataType = COMMENT;
         } break;
 
@@ -187,130 +398,1478 @@ void GeometryData::loadFromOBJFile(string filename)
         }
     }
 
+    retriangulatePendingPolygons(pendingPolygons, tempGeom);
+    parseSeconds = chrono::duration<double>(chrono::steady_clock::now() - parseStart).count();
+    expandFaces(tempGeom);
+   // cout << "Successfully loaded an OBJ with " << vertices.size()/3 << " vertices " << endl;
+}
 
-    // NOTE: Since our rendering pipeline supports only 1 set of indices for our data, we need to
-    //       do some post-processing here in order to lay out all the unique v/vt/vn triples
-    // TODO: We're currently just assuming all the triples are distinct, but its probably worth doing
-    //       at least a little bit of checking on that front
-    // TODO: We're deciding whether or not to add texture coords and normals on a per-face basis,
-    //       which doesn't really make sense because if there are any then there should be for all
-    //       vertices, but this way that might not be the case
-    for(int faceIndex=0; faceIndex<tempGeom.faces.size(); faceIndex++)
+// NOTE: The helpers below parse directly out of the mapped file, so they all take an explicit end
+//       pointer rather than relying on a null terminator, and never read past it
+static inline bool isLineSpace(char c)
+{
+    return (c == ' ') || (c == '\t') || (c == '\r');
+}
+
+static inline bool isDigit(char c)
+{
+    return (c >= '0') && (c <= '9');
+}
+
+static inline const char* skipLineSpace(const char* p, const char* end)
+{
+    while((p < end) && isLineSpace(*p))
     {
-        FaceData face = tempGeom.faces[faceIndex];
-        bool hasTextureCoords = (face.texCoordIndex[0] >= 0);
-        bool hasNormals = (face.normalIndex[0] >= 0);
-        for(int vertIndex=0; vertIndex<3; vertIndex++)
+        p++;
+    }
+    return p;
+}
+
+static inline const char* skipWhitespace(const char* p, const char* end)
+{
+    while((p < end) && (isLineSpace(*p) || (*p == '\n')))
+    {
+        p++;
+    }
+    return p;
+}
+
+static inline const char* skipLine(const char* p, const char* end)
+{
+    const char* newline = (const char*)memchr(p, '\n', end - p);
+    return newline ? (newline + 1) : end;
+}
+
+static inline const char* parseInt(const char* p, const char* end, int* result)
+{
+    p = skipWhitespace(p, end);
+
+    bool negative = false;
+    if((p < end) && ((*p == '-') || (*p == '+')))
+    {
+        negative = (*p == '-');
+        p++;
+    }
+
+    int value = 0;
+    while((p < end) && isDigit(*p))
+    {
+        value = (value * 10) + (*p - '0');
+        p++;
+    }
+
+    *result = negative ? -value : value;
+    return p;
+}
+
+// Parses a float the same way operator>> would (ie. correctly rounded) but without any of the
+// stream or locale overhead. Numbers with at most 7 significant digits and a small exponent can be
+// converted exactly with a single float multiply or divide (both operands are exactly representable
+// so the one rounding step gives the correctly rounded result), which covers what exporters
+// normally write. Anything else is handed off to strtof so that we never lose precision
+static inline const char* parseFloat(const char* p, const char* end, float* result)
+{
+    static const float powersOf10[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f,
+                                        1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+
+    p = skipWhitespace(p, end);
+    const char* start = p;
+
+    bool negative = false;
+    if((p < end) && ((*p == '-') || (*p == '+')))
+    {
+        negative = (*p == '-');
+        p++;
+    }
+
+    unsigned long long mantissa = 0;
+    int significantDigits = 0;
+    int exponent = 0;
+    bool hasDigits = false;
+
+    while((p < end) && isDigit(*p))
+    {
+        hasDigits = true;
+        if((mantissa != 0) || (*p != '0'))
         {
-            for(int i=0; i<3; i++)
+            significantDigits++;
+        }
+        if(significantDigits <= 18)
+        {
+            mantissa = (mantissa * 10) + (*p - '0');
+        }
+        else
+        {
+            exponent++;
+        }
+        p++;
+    }
+    if((p < end) && (*p == '.'))
+    {
+        p++;
+        while((p < end) && isDigit(*p))
+        {
+            hasDigits = true;
+            if((mantissa != 0) || (*p != '0'))
             {
-                vertices.push_back(tempGeom.vertices[(3*face.vertexIndex[vertIndex])+i]);
+                significantDigits++;
             }
-
-            if(hasTextureCoords)
+            if(significantDigits <= 18)
             {
-                for(int i=0; i<2; i++)
-                {
-                    textureCoords.push_back(
-                            tempGeom.textureCoords[(2*face.texCoordIndex[vertIndex])+i]);
-                }
+                mantissa = (mantissa * 10) + (*p - '0');
+                exponent--;
             }
-            if(hasNormals)
+            p++;
+        }
+    }
+    if(hasDigits && (p < end) && ((*p == 'e') || (*p == 'E')))
+    {
+        const char* exponentStart = p;
+        p++;
+        bool negativeExponent = false;
+        if((p < end) && ((*p == '-') || (*p == '+')))
+        {
+            negativeExponent = (*p == '-');
+            p++;
+        }
+        if((p < end) && isDigit(*p))
+        {
+            int explicitExponent = 0;
+            while((p < end) && isDigit(*p))
             {
-                for(int i=0; i<3; i++)
+                if(explicitExponent < 10000)
                 {
-                    normals.push_back(tempGeom.normals[(3*face.normalIndex[vertIndex])+i]);
+                    explicitExponent = (explicitExponent * 10) + (*p - '0');
                 }
+                p++;
             }
+            exponent += negativeExponent ? -explicitExponent : explicitExponent;
         }
-
-        // Compute the (bi)tangent for the face, and add it for each vertex
-        if(hasTextureCoords && hasNormals)
+        else
         {
-            int vertexStartIndex = vertices.size() - 9;
-            int uvStartIndex = textureCoords.size() - 6;
-            float* vertices = &this->vertices[vertexStartIndex];
-            float* texCoords = &textureCoords[uvStartIndex];
-
-            float deltaX1 = vertices[3] - vertices[0];
-            float deltaY1 = vertices[4] - vertices[1];
-            float deltaZ1 = vertices[5] - vertices[2];
-            float deltaX2 = vertices[6] - vertices[0];
-            float deltaY2 = vertices[7] - vertices[1];
-            float deltaZ2 = vertices[8] - vertices[2];
-
-            float deltaU1 = texCoords[2] - texCoords[0];
-            float deltaV1 = texCoords[3] - texCoords[1];
-            float deltaU2 = texCoords[4] - texCoords[0];
-            float deltaV2 = texCoords[5] - texCoords[1];
-
-            float inverseDet = 1.0f / (deltaU1*deltaV2 - deltaU2*deltaV1);
-
-            float tangentX = inverseDet * (deltaV2*deltaX1 - deltaV1*deltaX2);
-            float tangentY = inverseDet * (deltaV2*deltaY1 - deltaV1*deltaY2);
-            float tangentZ = inverseDet * (deltaV2*deltaZ1 - deltaV1*deltaZ2);
-
-            float bitangentX = inverseDet * (deltaU1*deltaX2 - deltaU2*deltaX1);
-            float bitangentY = inverseDet * (deltaU1*deltaY2 - deltaU2*deltaY1);
-            float bitangentZ = inverseDet * (deltaU1*deltaZ2 - deltaU2*deltaZ1);
-
-            float tangentLength = sqrt(tangentX*tangentX +
-                                       tangentY*tangentY +
-                                       tangentZ*tangentZ);
-            float bitangentLength = sqrt(bitangentX*bitangentX +
-                                         bitangentY*bitangentY +
-                                         bitangentZ*bitangentZ);
-
-            tangentX /= tangentLength;
-            tangentY /= tangentLength;
-            tangentZ /= tangentLength;
-            bitangentX /= bitangentLength;
-            bitangentY /= bitangentLength;
-            bitangentZ /= bitangentLength;
-
-            // NOTE: Each vertex in the face gets the same (bi)tangent pair
-            for(int vertIndex=0; vertIndex<3; vertIndex++)
-            {
-                tangents.push_back(tangentX);
-                tangents.push_back(tangentY);
-                tangents.push_back(tangentZ);
+            p = exponentStart;
+        }
+    }
 
-                bitangents.push_back(bitangentX);
-                bitangents.push_back(bitangentY);
-                bitangents.push_back(bitangentZ);
-            }
+    if(hasDigits && (significantDigits <= 7) && (exponent >= -10) && (exponent <= 10))
+    {
+        float value = (float)mantissa;
+        if(exponent < 0)
+        {
+            value /= powersOf10[-exponent];
+        }
+        else
+        {
+            value *= powersOf10[exponent];
         }
+        *result = negative ? -value : value;
+        return p;
     }
 
-   // cout << "Successfully loaded an OBJ with " << vertices.size()/3 << " vertices " << endl;
+    // Slow path: long mantissas, large exponents, and things like inf/nan
+    const char* tokenEnd = start;
+    while((tokenEnd < end) && !isLineSpace(*tokenEnd) && (*tokenEnd != '\n'))
+    {
+        tokenEnd++;
+    }
+    string token(start, tokenEnd);
+    char* parsedEnd = 0;
+    *result = strtof(token.c_str(), &parsedEnd);
+    return start + (parsedEnd - token.c_str());
 }
 
-int GeometryData::vertexCount()
+// Reads the v/vt/vn index triples of a face, up to the end of the line, into the corner arrays.
+// The indices are left as they are in the file (so 0 means omitted), and any corners past
+// MAX_POLYGON_CORNERS are skipped over
+static const char* parseOBJFaceCorners(const char* p, const char* end, int* cornerVertices,
+                                       int* cornerTexCoords, int* cornerNormals, int* cornerCount)
 {
-    return vertices.size()/3;
+    *cornerCount = 0;
+    while(true)
+    {
+        p = skipLineSpace(p, end);
+        if((p >= end) || !(isDigit(*p) || (*p == '-') || (*p == '+')))
+        {
+            break;
+        }
+
+        int vertIndex = 0;
+        int texCoordIndex = 0;
+        int normalIndex = 0;
+        p = parseInt(p, end, &vertIndex);
+        if((p < end) && (*p == '/'))
+        {
+            p++;
+            if((p < end) && (*p != '/'))
+            {
+                p = parseInt(p, end, &texCoordIndex);
+            }
+            if((p < end) && (*p == '/'))
+            {
+                p++;
+                p = parseInt(p, end, &normalIndex);
+            }
+        }
+
+        if(*cornerCount < MAX_POLYGON_CORNERS)
+        {
+            cornerVertices[*cornerCount] = vertIndex;
+            cornerTexCoords[*cornerCount] = texCoordIndex;
+            cornerNormals[*cornerCount] = normalIndex;
+            (*cornerCount)++;
+        }
+    }
+    return p;
 }
 
-void* GeometryData::vertexData()
+// The raw records parsed out of one newline-aligned range of an OBJ file. Positive face indices
+// are absolute and so can be used as-is, but relative (negative) indices can only be resolved
+// against the records parsed in this chunk, so we resolve them locally and remember where they
+// are so that the chunk's global offset can be added once all the chunks are stitched together
+struct OBJChunk
 {
-    return (void*)&vertices[0];
-}
+    // NOTE: A chunk parsed on a worker thread mustn't share the caller's arena, so those are left on
+    //       the heap
+    OBJChunk(ScratchArena* arena = 0)
+        : vertices(arena), textureCoords(arena), normals(arena), faces(arena),
+          relativeVertexIndices(arena), relativeTexCoordIndices(arena), relativeNormalIndices(arena),
+          isFirstChunk(false), pendingPolygons(arena), sawFreeForm(false), sawUnsupported(false)
+    {
+    }
 
-void* GeometryData::textureCoordData()
+    ScratchVector<float> vertices;
+    ScratchVector<float> textureCoords;
+    ScratchVector<float> normals;
+    ScratchVector<FaceData> faces;
+
+    // NOTE: These are positions into the faces array, as (faceIndex*3 + faceVertex)
+    ScratchVector<int> relativeVertexIndices;
+    ScratchVector<int> relativeTexCoordIndices;
+    ScratchVector<int> relativeNormalIndices;
+
+    // Concave faces need the positions of their vertices to be split into triangles, but a chunk
+    // only has the vertices it has read itself. Faces referring to any other vertex (absolute
+    // indices outside the first chunk, relative ones reaching back before the chunk, or anything
+    // referring forward) are split as a fan and noted here, as (first triangle, vertex count)
+    // pairs, to be redone once the chunks are stitched together
+    bool isFirstChunk;
+    ScratchVector<int> pendingPolygons;
+
+    // Errors are only recorded while parsing (since this may be running on a worker thread) and
+    // reported once all the chunks are done
+    bool sawFreeForm;
+    bool sawUnsupported;
+    char unsupportedChars[2];
+};
+
+// Converts an OBJ index into a 0-based one (with -1 meaning the index was omitted)
+static inline int resolveOBJIndex(int index, int localCount, int position, ScratchVector<int>& relativeIndices)
 {
-    return (void*)&textureCoords[0];
+    if(index > 0)
+    {
+        return index - 1;
+    }
+    if(index < 0)
+    {
+        relativeIndices.push_back(position);
+        return localCount + index;
+    }
+    return -1;
 }
 
-void* GeometryData::normalData()
+static void parseOBJChunk(const char* start, const char* end, OBJChunk* chunk)
 {
-    return (void*)&normals[0];
+    chunk->sawFreeForm = false;
+    chunk->sawUnsupported = false;
+
+    OBJRecordCounts counts = {};
+    countOBJRecords(start, end, &counts);
+    reserveOBJRecords(counts, chunk->vertices, chunk->textureCoords, chunk->normals, chunk->faces);
+
+    const char* p = start;
+    while(true)
+    {
+        p = skipWhitespace(p, end);
+        if(p >= end)
+        {
+            break;
+        }
+
+        char typeChar1 = *p++;
+        char typeChar2 = (p < end) ? *p++ : '\0';
+
+        if(typeChar1 == 'v')
+        {
+            if(isLineSpace(typeChar2))
+            {
+                float x;
+                float y;
+                float z;
+                p = parseFloat(p, end, &x);
+                p = parseFloat(p, end, &y);
+                p = parseFloat(p, end, &z);
+                chunk->vertices.push_back(x);
+                chunk->vertices.push_back(y);
+                chunk->vertices.push_back(z);
+            }
+            else if(typeChar2 == 't')
+            {
+                float u;
+                float v;
+                p = parseFloat(p, end, &u);
+                p = parseFloat(p, end, &v);
+                chunk->textureCoords.push_back(u);
+                chunk->textureCoords.push_back(v);
+            }
+            else if(typeChar2 == 'n')
+            {
+                float x;
+                float y;
+                float z;
+                p = parseFloat(p, end, &x);
+                p = parseFloat(p, end, &y);
+                p = parseFloat(p, end, &z);
+                chunk->normals.push_back(x);
+                chunk->normals.push_back(y);
+                chunk->normals.push_back(z);
+            }
+            else if(typeChar2 == 'p')
+            {
+                chunk->sawFreeForm = true;
+            }
+            else if(!chunk->sawUnsupported)
+            {
+                chunk->sawUnsupported = true;
+                chunk->unsupportedChars[0] = typeChar1;
+                chunk->unsupportedChars[1] = typeChar2;
+            }
+        }
+        else if(typeChar1 == 'f')
+        {
+            // NOTE: As with the stream version we read every vertex of the face before splitting it
+            //       into triangles, all on the stack. The indices are kept as they are in the file
+            //       until then, since relative ones need resolving for each triangle they end up in
+            int cornerVertices[MAX_POLYGON_CORNERS];
+            int cornerTexCoords[MAX_POLYGON_CORNERS];
+            int cornerNormals[MAX_POLYGON_CORNERS];
+            int cornerPositions[MAX_POLYGON_CORNERS];
+            int cornerCount = 0;
+
+            int vertexCount = chunk->vertices.size() / 3;
+            int texCoordCount = chunk->textureCoords.size() / 2;
+            int normalCount = chunk->normals.size() / 3;
+            p = parseOBJFaceCorners(p, end, cornerVertices, cornerTexCoords, cornerNormals, &cornerCount);
+
+            bool positionsKnown = true;
+            for(int corner=0; corner<cornerCount; corner++)
+            {
+                if(cornerVertices[corner] < 0)
+                {
+                    // NOTE: After the first chunk a relative index can reach back past the start of
+                    //       the chunk, to a vertex we won't have until the chunks are stitched
+                    cornerPositions[corner] = vertexCount + cornerVertices[corner];
+                    positionsKnown = positionsKnown && ((cornerPositions[corner] >= 0) || chunk->isFirstChunk);
+                }
+                else
+                {
+                    // Absolute indices are only local to the first chunk, and even there they can
+                    // refer forward to vertices later in the file
+                    cornerPositions[corner] = cornerVertices[corner] - 1;
+                    positionsKnown = positionsKnown && chunk->isFirstChunk &&
+                                     (cornerPositions[corner] < vertexCount);
+                }
+            }
+
+            if(cornerCount >= 3)
+            {
+                int faceIndex = chunk->faces.size();
+                int triangles[3*(MAX_POLYGON_CORNERS-2)];
+                triangulatePolygon(chunk->vertices.empty() ? 0 : &chunk->vertices[0],
+                                   positionsKnown ? vertexCount : 0, cornerPositions, cornerCount,
+                                   triangles);
+                if(!positionsKnown && (cornerCount > 3))
+                {
+                    chunk->pendingPolygons.push_back(faceIndex);
+                    chunk->pendingPolygons.push_back(cornerCount);
+                }
+
+                for(int triangle=0; triangle<cornerCount-2; triangle++)
+                {
+                    FaceData face = {};
+                    for(int index=0; index<3; index++)
+                    {
+                        int corner = triangles[(3*triangle)+index];
+                        int position = (3*(faceIndex+triangle)) + index;
+                        face.vertexIndex[index] = resolveOBJIndex(cornerVertices[corner], vertexCount,
+                                                                  position, chunk->relativeVertexIndices);
+                        face.texCoordIndex[index] = resolveOBJIndex(cornerTexCoords[corner], texCoordCount,
+                                                                    position, chunk->relativeTexCoordIndices);
+                        face.normalIndex[index] = resolveOBJIndex(cornerNormals[corner], normalCount,
+                                                                  position, chunk->relativeNormalIndices);
+                    }
+                    chunk->faces.push_back(face);
+                }
+            }
+        }
+        else if((typeChar1 != '#') && !chunk->sawUnsupported)
+        {
+            chunk->sawUnsupported = true;
+            chunk->unsupportedChars[0] = typeChar1;
+            chunk->unsupportedChars[1] = typeChar2;
+        }
+
+        // Whatever is left on the line (comments, w-coordinates) is ignored
+        if((p > start) && (p[-1] == '\n'))
+        {
+            continue;
+        }
+        p = skipLine(p, end);
+    }
 }
 
-void* GeometryData::tangentData()
+// NOTE: Chunks smaller than this aren't worth handing to another thread, the cost of starting it
+//       and stitching the results back together outweighs the parsing time saved
+static const size_t MIN_PARALLEL_CHUNK_SIZE = 4*1024*1024;
+
+void GeometryData::loadFromOBJFileMapped(string filename, ScratchArena* scratch)
 {
-    return (void*)&tangents[0];
+    loadFromOBJFileParallel(filename, 1, scratch);
 }
 
-void* GeometryData::bitangentData()
+void GeometryData::loadFromOBJFileParallel(string filename, int threadCount, ScratchArena* scratch)
 {
-    return (void*)&bitangents[0];
+    chrono::steady_clock::time_point parseStart = chrono::steady_clock::now();
+    if(scratch)
+    {
+        scratch->reset();
+    }
+
+    MappedFile file;
+    if(!file.open(filename))
+    {
+        cout << "Unable to open obj file: " << filename << endl;
+        return;
+    }
+
+    const char* start = file.data();
+    const char* end = start + file.size();
+
+    if(threadCount <= 0)
+    {
+        threadCount = thread::hardware_concurrency();
+    }
+    size_t maxUsefulThreads = (file.size() / MIN_PARALLEL_CHUNK_SIZE) + 1;
+    if((size_t)threadCount > maxUsefulThreads)
+    {
+        threadCount = (int)maxUsefulThreads;
+    }
+    if(threadCount < 1)
+    {
+        threadCount = 1;
+    }
+
+    // Split the file into one chunk per thread, moving each split point forward to the start of
+    // the next line so that no record is ever split between two chunks
+    ScratchVector<const char*> boundaries(scratch);
+    boundaries.reserve(threadCount + 1);
+    boundaries.push_back(start);
+    for(int chunkIndex=1; chunkIndex<threadCount; chunkIndex++)
+    {
+        const char* split = start + ((file.size() * chunkIndex) / threadCount);
+        if(split < boundaries.back())
+        {
+            split = boundaries.back();
+        }
+        split = skipLine(split, end);
+        boundaries.push_back(split);
+    }
+    boundaries.push_back(end);
+
+    // The first chunk is parsed on this thread, so it's the only one that can use the arena
+    ScratchVector<OBJChunk> chunks(scratch);
+    chunks.reserve(threadCount);
+    chunks.push_back(OBJChunk(scratch));
+    chunks.resize(threadCount);
+    chunks[0].isFirstChunk = true;
+    vector<thread> workers;
+    for(int chunkIndex=1; chunkIndex<threadCount; chunkIndex++)
+    {
+        workers.push_back(thread(parseOBJChunk, boundaries[chunkIndex], boundaries[chunkIndex+1],
+                                 &chunks[chunkIndex]));
+    }
+    // The calling thread takes the first chunk itself rather than sitting idle
+    parseOBJChunk(boundaries[0], boundaries[1], &chunks[0]);
+    for(size_t i=0; i<workers.size(); i++)
+    {
+        workers[i].join();
+    }
+
+    // NOTE: Unlike the stream version we only report each kind of unsupported statement once,
+    //       since printing a message per line would cost more than parsing the rest of the file
+    for(int chunkIndex=0; chunkIndex<threadCount; chunkIndex++)
+    {
+        if(chunks[chunkIndex].sawFreeForm)
+        {
+            cout << "OBJ parse error: Free-form geometry is not supported, ignoring" << endl;
+            break;
+        }
+    }
+    for(int chunkIndex=0; chunkIndex<threadCount; chunkIndex++)
+    {
+        if(chunks[chunkIndex].sawUnsupported)
+        {
+            cout << "OBJ parse error: Unsupported statement, ignoring" << endl;
+            cout << "Found: " << chunks[chunkIndex].unsupportedChars[0]
+                 << chunks[chunkIndex].unsupportedChars[1] << endl;
+            break;
+        }
+    }
+
+    OBJRecords tempGeom(scratch);
+    stitchOBJChunks(&chunks[0], threadCount, tempGeom);
+    parseSeconds = chrono::duration<double>(chrono::steady_clock::now() - parseStart).count();
+
+    expandFaces(tempGeom);
+}
+
+// Concatenates the per-chunk records and offsets each chunk's relative indices by the number of
+// records that came before it in the file
+void GeometryData::stitchOBJChunks(OBJChunk* chunks, int chunkCount, OBJRecords& tempGeom)
+{
+    if(chunkCount == 1)
+    {
+        // The single-threaded case has nothing to offset, so we can just take the arrays
+        tempGeom.vertices.swap(chunks[0].vertices);
+        tempGeom.textureCoords.swap(chunks[0].textureCoords);
+        tempGeom.normals.swap(chunks[0].normals);
+        tempGeom.faces.swap(chunks[0].faces);
+        retriangulatePendingPolygons(chunks[0].pendingPolygons, tempGeom);
+        return;
+    }
+
+    size_t totalVertices = 0;
+    size_t totalTexCoords = 0;
+    size_t totalNormals = 0;
+    size_t totalFaces = 0;
+    for(int chunkIndex=0; chunkIndex<chunkCount; chunkIndex++)
+    {
+        totalVertices += chunks[chunkIndex].vertices.size();
+        totalTexCoords += chunks[chunkIndex].textureCoords.size();
+        totalNormals += chunks[chunkIndex].normals.size();
+        totalFaces += chunks[chunkIndex].faces.size();
+    }
+    tempGeom.vertices.reserve(totalVertices);
+    tempGeom.textureCoords.reserve(totalTexCoords);
+    tempGeom.normals.reserve(totalNormals);
+    tempGeom.faces.reserve(totalFaces);
+
+    for(int chunkIndex=0; chunkIndex<chunkCount; chunkIndex++)
+    {
+        OBJChunk& chunk = chunks[chunkIndex];
+
+        int faceOffset = tempGeom.faces.size();
+        for(size_t i=0; i<chunk.pendingPolygons.size(); i+=2)
+        {
+            chunk.pendingPolygons[i] += faceOffset;
+        }
+
+        int vertexOffset = tempGeom.vertices.size() / 3;
+        int texCoordOffset = tempGeom.textureCoords.size() / 2;
+        int normalOffset = tempGeom.normals.size() / 3;
+        for(size_t i=0; i<chunk.relativeVertexIndices.size(); i++)
+        {
+            int position = chunk.relativeVertexIndices[i];
+            chunk.faces[position / 3].vertexIndex[position % 3] += vertexOffset;
+        }
+        for(size_t i=0; i<chunk.relativeTexCoordIndices.size(); i++)
+        {
+            int position = chunk.relativeTexCoordIndices[i];
+            chunk.faces[position / 3].texCoordIndex[position % 3] += texCoordOffset;
+        }
+        for(size_t i=0; i<chunk.relativeNormalIndices.size(); i++)
+        {
+            int position = chunk.relativeNormalIndices[i];
+            chunk.faces[position / 3].normalIndex[position % 3] += normalOffset;
+        }
+
+        tempGeom.vertices.insert(tempGeom.vertices.end(),
+                                 chunk.vertices.begin(), chunk.vertices.end());
+        tempGeom.textureCoords.insert(tempGeom.textureCoords.end(),
+                                      chunk.textureCoords.begin(), chunk.textureCoords.end());
+        tempGeom.normals.insert(tempGeom.normals.end(),
+                                chunk.normals.begin(), chunk.normals.end());
+        tempGeom.faces.insert(tempGeom.faces.end(),
+                              chunk.faces.begin(), chunk.faces.end());
+
+        // Release each chunk as we go so we don't hold two full copies of the data at once
+        ScratchVector<float>().swap(chunk.vertices);
+        ScratchVector<float>().swap(chunk.textureCoords);
+        ScratchVector<float>().swap(chunk.normals);
+        ScratchVector<FaceData>().swap(chunk.faces);
+    }
+
+    for(int chunkIndex=0; chunkIndex<chunkCount; chunkIndex++)
+    {
+        retriangulatePendingPolygons(chunks[chunkIndex].pendingPolygons, tempGeom);
+    }
+}
+
+// NOTE: Small enough that a batch (with all its streams) stays a couple of MB, but big enough that
+//       the per batch overhead in the sink (e.g. a buffer upload) doesn't matter
+static const int STREAMING_BATCH_TRIANGLES = 16384;
+
+// Everything loadOBJFileStreaming keeps between blocks: the v/vt/vn records so far, and the
+// triangles that haven't been passed to the sink yet
+struct OBJStreamState
+{
+    TriangleSink* sink;
+
+    std::vector<float> vertices;
+    std::vector<float> textureCoords;
+    std::vector<float> normals;
+
+    std::vector<float> batchPositions;
+    std::vector<float> batchTextureCoords;
+    std::vector<float> batchNormals;
+    std::vector<float> batchTangents;
+    std::vector<float> batchBitangents;
+    int batchTriangles;
+    bool hasTextureCoords;
+    bool hasNormals;
+
+    bool sawFreeForm;
+    bool sawUnsupported;
+    bool sawBadIndex;
+    char unsupportedChars[2];
+};
+
+static void flushOBJStreamBatch(OBJStreamState* state)
+{
+    if(state->batchTriangles == 0)
+    {
+        return;
+    }
+
+    VertexStreams streams = {};
+    streams.vertexCount = 3 * state->batchTriangles;
+    streams.positions = &state->batchPositions[0];
+    streams.textureCoords = state->hasTextureCoords ? &state->batchTextureCoords[0] : 0;
+    streams.normals = state->hasNormals ? &state->batchNormals[0] : 0;
+    if(state->hasTextureCoords && state->hasNormals)
+    {
+        computeTriangleTangents(&state->batchPositions[0], &state->batchTextureCoords[0],
+                                state->batchTriangles, &state->batchTangents[0],
+                                &state->batchBitangents[0]);
+        streams.tangents = &state->batchTangents[0];
+        streams.bitangents = &state->batchBitangents[0];
+    }
+    state->sink->addTriangles(streams);
+    state->batchTriangles = 0;
+}
+
+// Converts an OBJ index into a 0-based one against the records read so far, or -1 if it was
+// omitted or is out of range
+static inline int resolveStreamedIndex(int index, int count)
+{
+    int resolved = (index < 0) ? (count + index) : (index - 1);
+    return ((index != 0) && (resolved >= 0) && (resolved < count)) ? resolved : -1;
+}
+
+// Copies one record into the batch, or zeros if there isn't one
+static inline void copyRecord(const std::vector<float>& records, int index, int components, float* destination)
+{
+    for(int i=0; i<components; i++)
+    {
+        destination[i] = (index >= 0) ? records[(components*index)+i] : 0.0f;
+    }
+}
+
+// Parses the whole lines in [start, end), which must end with a newline (or the end of the file)
+static void parseOBJStreamLines(const char* start, const char* end, OBJStreamState* state)
+{
+    const char* p = start;
+    while(true)
+    {
+        p = skipWhitespace(p, end);
+        if(p >= end)
+        {
+            break;
+        }
+
+        char typeChar1 = *p++;
+        char typeChar2 = (p < end) ? *p++ : '\0';
+
+        if(typeChar1 == 'v')
+        {
+            if(isLineSpace(typeChar2) || (typeChar2 == 'n'))
+            {
+                std::vector<float>& records = (typeChar2 == 'n') ? state->normals : state->vertices;
+                float x;
+                float y;
+                float z;
+                p = parseFloat(p, end, &x);
+                p = parseFloat(p, end, &y);
+                p = parseFloat(p, end, &z);
+                records.push_back(x);
+                records.push_back(y);
+                records.push_back(z);
+            }
+            else if(typeChar2 == 't')
+            {
+                float u;
+                float v;
+                p = parseFloat(p, end, &u);
+                p = parseFloat(p, end, &v);
+                state->textureCoords.push_back(u);
+                state->textureCoords.push_back(v);
+            }
+            else if(typeChar2 == 'p')
+            {
+                state->sawFreeForm = true;
+            }
+            else if(!state->sawUnsupported)
+            {
+                state->sawUnsupported = true;
+                state->unsupportedChars[0] = typeChar1;
+                state->unsupportedChars[1] = typeChar2;
+            }
+        }
+        else if(typeChar1 == 'f')
+        {
+            int cornerVertices[MAX_POLYGON_CORNERS];
+            int cornerTexCoords[MAX_POLYGON_CORNERS];
+            int cornerNormals[MAX_POLYGON_CORNERS];
+            int cornerCount = 0;
+            p = parseOBJFaceCorners(p, end, cornerVertices, cornerTexCoords, cornerNormals, &cornerCount);
+
+            // Unlike the other loaders every record a face can refer to has already been read, so
+            // all the indices can be resolved straight away
+            int vertexCount = state->vertices.size() / 3;
+            int texCoordCount = state->textureCoords.size() / 2;
+            int normalCount = state->normals.size() / 3;
+            bool validFace = (cornerCount >= 3);
+            for(int corner=0; corner<cornerCount; corner++)
+            {
+                cornerVertices[corner] = resolveStreamedIndex(cornerVertices[corner], vertexCount);
+                cornerTexCoords[corner] = resolveStreamedIndex(cornerTexCoords[corner], texCoordCount);
+                cornerNormals[corner] = resolveStreamedIndex(cornerNormals[corner], normalCount);
+                validFace = validFace && (cornerVertices[corner] >= 0);
+                state->hasTextureCoords = state->hasTextureCoords || (cornerTexCoords[corner] >= 0);
+                state->hasNormals = state->hasNormals || (cornerNormals[corner] >= 0);
+            }
+            state->sawBadIndex = state->sawBadIndex || !validFace;
+
+            int triangles[3*(MAX_POLYGON_CORNERS-2)];
+            if(validFace)
+            {
+                triangulatePolygon(&state->vertices[0], vertexCount, cornerVertices, cornerCount,
+                                   triangles);
+            }
+            for(int triangle=0; validFace && (triangle<cornerCount-2); triangle++)
+            {
+                int batchVertex = 3 * state->batchTriangles;
+                for(int index=0; index<3; index++)
+                {
+                    int corner = triangles[(3*triangle)+index];
+                    copyRecord(state->vertices, cornerVertices[corner], 3,
+                               &state->batchPositions[3*(batchVertex+index)]);
+                    copyRecord(state->textureCoords, cornerTexCoords[corner], 2,
+                               &state->batchTextureCoords[2*(batchVertex+index)]);
+                    copyRecord(state->normals, cornerNormals[corner], 3,
+                               &state->batchNormals[3*(batchVertex+index)]);
+                }
+
+                state->batchTriangles++;
+                if(state->batchTriangles == STREAMING_BATCH_TRIANGLES)
+                {
+                    flushOBJStreamBatch(state);
+                }
+            }
+        }
+        else if((typeChar1 != '#') && !state->sawUnsupported)
+        {
+            state->sawUnsupported = true;
+            state->unsupportedChars[0] = typeChar1;
+            state->unsupportedChars[1] = typeChar2;
+        }
+
+        if((p > start) && (p[-1] == '\n'))
+        {
+            continue;
+        }
+        p = skipLine(p, end);
+    }
+}
+
+typedef void (*OBJLinesCallback)(const char* start, const char* end, void* context);
+
+// Reads a file a block at a time, passing the whole lines in each block to parseLines. Each block
+// is handled up to its last newline, and the partial line after that is moved to the front of the
+// buffer to be finished off by the next block
+// NOTE: A single line longer than the block grows the buffer to fit it
+static bool readOBJFileBlocks(string filename, size_t blockSize, OBJLinesCallback parseLines,
+                              void* context)
+{
+    FILE* file = fopen(filename.c_str(), "rb");
+    if(!file)
+    {
+        cout << "Unable to open obj file: " << filename << endl;
+        return false;
+    }
+
+    vector<char> buffer(blockSize > 0 ? blockSize : 1);
+    size_t carried = 0;
+    while(true)
+    {
+        size_t bytesRead = fread(&buffer[carried], 1, buffer.size() - carried, file);
+        size_t filled = carried + bytesRead;
+        bool finished = (bytesRead == 0);
+
+        const char* start = &buffer[0];
+        const char* end = start + filled;
+        const char* lineEnd = end;
+        if(!finished)
+        {
+            while((lineEnd > start) && (lineEnd[-1] != '\n'))
+            {
+                lineEnd--;
+            }
+            if(lineEnd == start)
+            {
+                carried = filled;
+                if(carried == buffer.size())
+                {
+                    buffer.resize(2 * buffer.size());
+                }
+                continue;
+            }
+        }
+
+        parseLines(start, lineEnd, context);
+        if(finished)
+        {
+            break;
+        }
+        carried = end - lineEnd;
+        memmove(&buffer[0], lineEnd, carried);
+    }
+    fclose(file);
+    return true;
+}
+
+static void parseOBJStreamBlock(const char* start, const char* end, void* context)
+{
+    parseOBJStreamLines(start, end, (OBJStreamState*)context);
+}
+
+static void countOBJBlock(const char* start, const char* end, void* context)
+{
+    countOBJRecords(start, end, (OBJRecordCounts*)context);
+}
+
+bool loadOBJFileStreaming(string filename, TriangleSink* sink, size_t blockSize)
+{
+    OBJStreamState state;
+    state.sink = sink;
+    state.batchPositions.resize(9 * STREAMING_BATCH_TRIANGLES);
+    state.batchTextureCoords.resize(6 * STREAMING_BATCH_TRIANGLES);
+    state.batchNormals.resize(9 * STREAMING_BATCH_TRIANGLES);
+    state.batchTangents.resize(9 * STREAMING_BATCH_TRIANGLES);
+    state.batchBitangents.resize(9 * STREAMING_BATCH_TRIANGLES);
+    state.batchTriangles = 0;
+    state.hasTextureCoords = false;
+    state.hasNormals = false;
+    state.sawFreeForm = false;
+    state.sawUnsupported = false;
+    state.sawBadIndex = false;
+
+    if(!readOBJFileBlocks(filename, blockSize, parseOBJStreamBlock, &state))
+    {
+        return false;
+    }
+    flushOBJStreamBatch(&state);
+
+    if(state.sawFreeForm)
+    {
+        cout << "OBJ parse error: Free-form geometry is not supported, ignoring" << endl;
+    }
+    if(state.sawUnsupported)
+    {
+        cout << "OBJ parse error: Unsupported statement, ignoring" << endl;
+        cout << "Found: " << state.unsupportedChars[0] << state.unsupportedChars[1] << endl;
+    }
+    if(state.sawBadIndex)
+    {
+        cout << "OBJ parse error: Faces with missing or out of range vertices were skipped" << endl;
+    }
+    return true;
+}
+
+// Passes each batch straight on to GeometryData::appendTriangles
+class GeometrySink : public TriangleSink
+{
+public:
+    GeometrySink(GeometryData* geometry)
+        : geometry(geometry)
+    {
+    }
+
+    void addTriangles(const VertexStreams& streams)
+    {
+        geometry->appendTriangles(streams);
+    }
+
+private:
+    GeometryData* geometry;
+};
+
+void GeometryData::loadFromOBJFileStreaming(string filename)
+{
+    if(indexed)
+    {
+        cout << "Streaming OBJ loads only produce un-indexed geometry, not loading " << filename << endl;
+        return;
+    }
+
+    // NOTE: Counting the triangles first (which is cheap, and also done a block at a time) lets the
+    //       streams be allocated once up front rather than growing as each batch arrives
+    OBJRecordCounts counts = {};
+    if(!readOBJFileBlocks(filename, 4*1024*1024, countOBJBlock, &counts))
+    {
+        return;
+    }
+    size_t vertexTotal = 3 * counts.triangles;
+    vertices.reserve(vertices.size() + 3*vertexTotal);
+    if(counts.textureCoords > 0)
+    {
+        textureCoords.reserve(textureCoords.size() + 2*vertexTotal);
+    }
+    if(counts.normals > 0)
+    {
+        normals.reserve(normals.size() + 3*vertexTotal);
+    }
+    if((counts.textureCoords > 0) && (counts.normals > 0))
+    {
+        tangents.reserve(tangents.size() + 3*vertexTotal);
+        bitangents.reserve(bitangents.size() + 3*vertexTotal);
+    }
+
+    GeometrySink sink(this);
+    loadOBJFileStreaming(filename, &sink);
+}
+
+void GeometryData::appendTriangles(const VertexStreams& streams)
+{
+    int floatCount = 3 * streams.vertexCount;
+    vertices.insert(vertices.end(), streams.positions, streams.positions + floatCount);
+    if(streams.textureCoords)
+    {
+        textureCoords.insert(textureCoords.end(), streams.textureCoords,
+                             streams.textureCoords + 2*streams.vertexCount);
+    }
+    if(streams.normals)
+    {
+        normals.insert(normals.end(), streams.normals, streams.normals + floatCount);
+    }
+    if(streams.tangents && streams.bitangents)
+    {
+        tangents.insert(tangents.end(), streams.tangents, streams.tangents + floatCount);
+        bitangents.insert(bitangents.end(), streams.bitangents, streams.bitangents + floatCount);
+    }
+}
+
+void GeometryData::expandFaces(OBJRecords& tempGeom)
+{
+    if(indexed)
+    {
+        buildIndexedVertices(tempGeom);
+        return;
+    }
+
+    // NOTE: Since our rendering pipeline supports only 1 set of indices for our data, we need to
+    //       do some post-processing here in order to lay out all the unique v/vt/vn triples
+    // TODO: We're currently just assuming all the triples are distinct, but its probably worth doing
+    //       at least a little bit of checking on that front
+    // TODO: We're deciding whether or not to add texture coords and normals on a per-face basis,
+    //       which doesn't really make sense because if there are any then there should be for all
+    //       vertices, but this way that might not be the case
+    size_t faceCount = tempGeom.faces.size();
+    if(faceCount == 0)
+    {
+        return;
+    }
+
+    // Count up how many faces have each attribute first, so the output streams can be sized exactly
+    // once and then written by index, rather than pushing (and checking capacity for) every float
+    size_t textureCoordFaceCount = 0;
+    size_t normalFaceCount = 0;
+    size_t tangentFaceCount = 0;
+    for(size_t faceIndex=0; faceIndex<faceCount; faceIndex++)
+    {
+        const FaceData& face = tempGeom.faces[faceIndex];
+        bool hasTextureCoords = (face.texCoordIndex[0] >= 0);
+        bool hasNormals = (face.normalIndex[0] >= 0);
+        textureCoordFaceCount += hasTextureCoords ? 1 : 0;
+        normalFaceCount += hasNormals ? 1 : 0;
+        tangentFaceCount += (hasTextureCoords && hasNormals) ? 1 : 0;
+    }
+
+    size_t firstVertex = vertices.size();
+    size_t firstTextureCoord = textureCoords.size();
+    size_t firstNormal = normals.size();
+    vertices.resize(firstVertex + 9*faceCount);
+    textureCoords.resize(firstTextureCoord + 6*textureCoordFaceCount);
+    normals.resize(firstNormal + 9*normalFaceCount);
+
+    const FaceData* faces = &tempGeom.faces[0];
+    const float* sourceVertices = &tempGeom.vertices[0];
+    const float* sourceTextureCoords = textureCoordFaceCount ? &tempGeom.textureCoords[0] : 0;
+    const float* sourceNormals = normalFaceCount ? &tempGeom.normals[0] : 0;
+    float* vertexOut = &vertices[firstVertex];
+    float* textureCoordOut = textureCoordFaceCount ? &textureCoords[firstTextureCoord] : 0;
+    float* normalOut = normalFaceCount ? &normals[firstNormal] : 0;
+    for(size_t faceIndex=0; faceIndex<faceCount; faceIndex++)
+    {
+        const FaceData& face = faces[faceIndex];
+        for(int vertIndex=0; vertIndex<3; vertIndex++)
+        {
+            const float* position = sourceVertices + 3*(size_t)face.vertexIndex[vertIndex];
+            vertexOut[0] = position[0];
+            vertexOut[1] = position[1];
+            vertexOut[2] = position[2];
+            vertexOut += 3;
+        }
+        if(face.texCoordIndex[0] >= 0)
+        {
+            for(int vertIndex=0; vertIndex<3; vertIndex++)
+            {
+                const float* textureCoord = sourceTextureCoords + 2*(size_t)face.texCoordIndex[vertIndex];
+                textureCoordOut[0] = textureCoord[0];
+                textureCoordOut[1] = textureCoord[1];
+                textureCoordOut += 2;
+            }
+        }
+        if(face.normalIndex[0] >= 0)
+        {
+            for(int vertIndex=0; vertIndex<3; vertIndex++)
+            {
+                const float* normal = sourceNormals + 3*(size_t)face.normalIndex[vertIndex];
+                normalOut[0] = normal[0];
+                normalOut[1] = normal[1];
+                normalOut[2] = normal[2];
+                normalOut += 3;
+            }
+        }
+    }
+
+    // Compute the (bi)tangents for every face with UVs and normals, which is normally all of them, so
+    // they can be done in one batch straight into the output streams
+    if(tangentFaceCount == 0)
+    {
+        return;
+    }
+    size_t firstTangent = tangents.size();
+    tangents.resize(firstTangent + 9*tangentFaceCount);
+    bitangents.resize(firstTangent + 9*tangentFaceCount);
+    if(tangentFaceCount == faceCount)
+    {
+        computeTriangleTangents(&vertices[firstVertex], &textureCoords[firstTextureCoord],
+                                (int)tangentFaceCount, &tangents[firstTangent], &bitangents[firstTangent]);
+        return;
+    }
+
+    // NOTE: With a mix of faces the streams don't line up, so we walk the faces again to find where
+    //       each face's data ended up
+    size_t vertexOffset = firstVertex;
+    size_t textureCoordOffset = firstTextureCoord;
+    size_t tangentOffset = firstTangent;
+    for(size_t faceIndex=0; faceIndex<faceCount; faceIndex++)
+    {
+        bool hasTextureCoords = (faces[faceIndex].texCoordIndex[0] >= 0);
+        bool hasNormals = (faces[faceIndex].normalIndex[0] >= 0);
+        if(hasTextureCoords && hasNormals)
+        {
+            computeTriangleTangentsScalar(&vertices[vertexOffset], &textureCoords[textureCoordOffset], 1,
+                                          &tangents[tangentOffset], &bitangents[tangentOffset]);
+            tangentOffset += 9;
+        }
+        vertexOffset += 9;
+        textureCoordOffset += hasTextureCoords ? 6 : 0;
+    }
+}
+
+static inline unsigned int hashVertexKey(int vertIndex, int texCoordIndex, int normalIndex)
+{
+    unsigned int hash = (unsigned int)vertIndex * 0x9E3779B1u;
+    hash ^= ((unsigned int)texCoordIndex * 0x85EBCA77u) + (hash << 6) + (hash >> 2);
+    hash ^= ((unsigned int)normalIndex * 0xC2B2AE3Du) + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+void GeometryData::buildIndexedVertices(OBJRecords& tempGeom)
+{
+    // NOTE: Unlike the expanded path we decide whether there are texture coords and normals once for
+    //       the whole mesh, since every vertex has to have the same set of attributes. Any face that
+    //       doesn't reference one just gets zeros
+    bool hasTextureCoords = !tempGeom.textureCoords.empty();
+    bool hasNormals = !tempGeom.normals.empty();
+
+    int baseVertex = vertices.size() / 3;
+    size_t cornerCount = 3 * tempGeom.faces.size();
+    indices.reserve(indices.size() + cornerCount);
+
+    // Open addressing hash table from a v/vt/vn triple to its output vertex. The table holds output
+    // vertex numbers (or -1 for an empty slot) and the triple for each output vertex is kept in
+    // vertexKeys, which keeps the table itself small and avoids allocating per entry
+    size_t tableSize = 16;
+    while(tableSize < 2*cornerCount)
+    {
+        tableSize *= 2;
+    }
+    // NOTE: These are only needed while indexing, so they go in the same scratch arena (if any) as
+    //       the records
+    ScratchArena* scratch = tempGeom.vertices.get_allocator().arena;
+    ScratchVector<int> table(tableSize, -1, scratch);
+    ScratchVector<int> vertexKeys(scratch);
+    vertexKeys.reserve(cornerCount);
+
+    for(size_t faceIndex=0; faceIndex<tempGeom.faces.size(); faceIndex++)
+    {
+        const FaceData& face = tempGeom.faces[faceIndex];
+        for(int vertIndex=0; vertIndex<3; vertIndex++)
+        {
+            int positionIndex = face.vertexIndex[vertIndex];
+            int texCoordIndex = hasTextureCoords ? face.texCoordIndex[vertIndex] : -1;
+            int normalIndex = hasNormals ? face.normalIndex[vertIndex] : -1;
+
+            size_t slot = hashVertexKey(positionIndex, texCoordIndex, normalIndex) & (tableSize - 1);
+            int uniqueIndex = -1;
+            while(table[slot] >= 0)
+            {
+                const int* key = &vertexKeys[3*table[slot]];
+                if((key[0] == positionIndex) && (key[1] == texCoordIndex) && (key[2] == normalIndex))
+                {
+                    uniqueIndex = table[slot];
+                    break;
+                }
+                slot = (slot + 1) & (tableSize - 1);
+            }
+
+            if(uniqueIndex < 0)
+            {
+                uniqueIndex = vertexKeys.size() / 3;
+                table[slot] = uniqueIndex;
+                vertexKeys.push_back(positionIndex);
+                vertexKeys.push_back(texCoordIndex);
+                vertexKeys.push_back(normalIndex);
+            }
+
+            indices.push_back(baseVertex + uniqueIndex);
+        }
+    }
+
+    // Only now that we know exactly how many unique vertices there are do we fill in their
+    // attributes, so each stream is allocated once at exactly the right size
+    size_t uniqueCount = vertexKeys.size() / 3;
+    vertices.reserve(vertices.size() + 3*uniqueCount);
+    if(hasTextureCoords)
+    {
+        textureCoords.reserve(textureCoords.size() + 2*uniqueCount);
+    }
+    if(hasNormals)
+    {
+        normals.reserve(normals.size() + 3*uniqueCount);
+    }
+    for(size_t vertex=0; vertex<uniqueCount; vertex++)
+    {
+        int positionIndex = vertexKeys[3*vertex];
+        int texCoordIndex = vertexKeys[(3*vertex)+1];
+        int normalIndex = vertexKeys[(3*vertex)+2];
+        for(int i=0; i<3; i++)
+        {
+            vertices.push_back(tempGeom.vertices[(3*positionIndex)+i]);
+        }
+        if(hasTextureCoords)
+        {
+            for(int i=0; i<2; i++)
+            {
+                textureCoords.push_back((texCoordIndex >= 0) ?
+                        tempGeom.textureCoords[(2*texCoordIndex)+i] : 0.0f);
+            }
+        }
+        if(hasNormals)
+        {
+            for(int i=0; i<3; i++)
+            {
+                normals.push_back((normalIndex >= 0) ?
+                        tempGeom.normals[(3*normalIndex)+i] : 0.0f);
+            }
+        }
+    }
+
+    if(!hasTextureCoords || !hasNormals || (cornerCount == 0))
+    {
+        return;
+    }
+
+    // A vertex can now be shared by several faces which each have their own (bi)tangent, so each
+    // vertex gets a smooth frame built from all the faces sharing it
+    // NOTE: The tangent code works on indices relative to the first new vertex, which they already
+    //       are unless we're appending to geometry that was loaded earlier
+    size_t firstNewIndex = indices.size() - cornerCount;
+    const unsigned int* newIndices = &indices[firstNewIndex];
+    ScratchVector<unsigned int> relativeIndices(scratch);
+    if(baseVertex > 0)
+    {
+        relativeIndices.assign(indices.begin() + firstNewIndex, indices.end());
+        for(size_t i=0; i<relativeIndices.size(); i++)
+        {
+            relativeIndices[i] -= baseVertex;
+        }
+        newIndices = &relativeIndices[0];
+    }
+
+    int newVertexCount = vertices.size()/3 - baseVertex;
+    tangents.resize(vertices.size(), 0.0f);
+    bitangents.resize(vertices.size(), 0.0f);
+    computeVertexTangents(&vertices[3*baseVertex], &textureCoords[2*baseVertex], &normals[3*baseVertex],
+                          newIndices, (int)cornerCount, newVertexCount,
+                          &tangents[3*baseVertex], &bitangents[3*baseVertex]);
+}
+
+static inline unsigned int hashFloats(const float* values, int count, unsigned int hash)
+{
+    for(int i=0; i<count; i++)
+    {
+        unsigned int bits;
+        memcpy(&bits, &values[i], sizeof(bits));
+        hash = (hash ^ bits) * 0x01000193u;
+    }
+    return hash;
+}
+
+void GeometryData::weldVertices()
+{
+    if(indexed)
+    {
+        return;
+    }
+
+    int vertexTotal = vertexCount();
+    bool hasTextureCoords = !textureCoords.empty();
+    bool hasNormals = !normals.empty();
+    bool hasTangents = !tangents.empty();
+
+    size_t tableSize = 16;
+    while(tableSize < 2*(size_t)vertexTotal)
+    {
+        tableSize *= 2;
+    }
+    vector<int> table(tableSize, -1);
+
+    // NOTE: Welded vertices are compacted in place, this works because a vertex is only ever moved
+    //       to a position at or before its original one
+    indices.clear();
+    indices.reserve(vertexTotal);
+    int uniqueCount = 0;
+    for(int vertex=0; vertex<vertexTotal; vertex++)
+    {
+        unsigned int hash = hashFloats(&vertices[3*vertex], 3, 0x811C9DC5u);
+        if(hasTextureCoords)
+        {
+            hash = hashFloats(&textureCoords[2*vertex], 2, hash);
+        }
+        if(hasNormals)
+        {
+            hash = hashFloats(&normals[3*vertex], 3, hash);
+        }
+        if(hasTangents)
+        {
+            hash = hashFloats(&tangents[3*vertex], 3, hash);
+            hash = hashFloats(&bitangents[3*vertex], 3, hash);
+        }
+
+        size_t slot = hash & (tableSize - 1);
+        int match = -1;
+        while(table[slot] >= 0)
+        {
+            int candidate = table[slot];
+            // NOTE: memcmp rather than ==, so that we compare exact bit patterns the same way the hash does
+            if((memcmp(&vertices[3*candidate], &vertices[3*vertex], 3*sizeof(float)) == 0) &&
+               (!hasTextureCoords ||
+                (memcmp(&textureCoords[2*candidate], &textureCoords[2*vertex], 2*sizeof(float)) == 0)) &&
+               (!hasNormals ||
+                (memcmp(&normals[3*candidate], &normals[3*vertex], 3*sizeof(float)) == 0)) &&
+               (!hasTangents ||
+                ((memcmp(&tangents[3*candidate], &tangents[3*vertex], 3*sizeof(float)) == 0) &&
+                 (memcmp(&bitangents[3*candidate], &bitangents[3*vertex], 3*sizeof(float)) == 0))))
+            {
+                match = candidate;
+                break;
+            }
+            slot = (slot + 1) & (tableSize - 1);
+        }
+
+        if(match < 0)
+        {
+            match = uniqueCount;
+            table[slot] = match;
+            memmove(&vertices[3*match], &vertices[3*vertex], 3*sizeof(float));
+            if(hasTextureCoords)
+            {
+                memmove(&textureCoords[2*match], &textureCoords[2*vertex], 2*sizeof(float));
+            }
+            if(hasNormals)
+            {
+                memmove(&normals[3*match], &normals[3*vertex], 3*sizeof(float));
+            }
+            if(hasTangents)
+            {
+                memmove(&tangents[3*match], &tangents[3*vertex], 3*sizeof(float));
+                memmove(&bitangents[3*match], &bitangents[3*vertex], 3*sizeof(float));
+            }
+            uniqueCount++;
+        }
+        indices.push_back(match);
+    }
+
+    vertices.resize(3*uniqueCount);
+    if(hasTextureCoords)
+    {
+        textureCoords.resize(2*uniqueCount);
+    }
+    if(hasNormals)
+    {
+        normals.resize(3*uniqueCount);
+    }
+    if(hasTangents)
+    {
+        tangents.resize(3*uniqueCount);
+        bitangents.resize(3*uniqueCount);
+    }
+    indexed = true;
+}
+
+// Moves each vertex in a stream to its remapped position, dropping any that aren't referenced
+static void remapStream(vector<float>& stream, int components, const vector<int>& remap, int newCount)
+{
+    if(stream.empty())
+    {
+        return;
+    }
+
+    vector<float> remapped(components * newCount);
+    for(size_t vertex=0; vertex<remap.size(); vertex++)
+    {
+        if(remap[vertex] >= 0)
+        {
+            memcpy(&remapped[components*remap[vertex]], &stream[components*vertex],
+                   components*sizeof(float));
+        }
+    }
+    stream.swap(remapped);
+}
+
+void GeometryData::optimizeVertexCache(VertexCacheStats* before, VertexCacheStats* after)
+{
+    weldVertices();
+    if(indices.empty())
+    {
+        return;
+    }
+
+    if(before)
+    {
+        *before = analyzeVertexCache(&indices[0], indices.size(), vertexCount());
+    }
+
+    optimizeVertexCacheOrder(&indices[0], indices.size(), vertexCount());
+
+    vector<int> remap;
+    int referencedCount = buildVertexFetchRemap(&indices[0], indices.size(), vertexCount(), remap);
+    remapStream(vertices, 3, remap, referencedCount);
+    remapStream(textureCoords, 2, remap, referencedCount);
+    remapStream(normals, 3, remap, referencedCount);
+    remapStream(tangents, 3, remap, referencedCount);
+    remapStream(bitangents, 3, remap, referencedCount);
+    for(size_t i=0; i<indices.size(); i++)
+    {
+        indices[i] = remap[indices[i]];
+    }
+
+    if(after)
+    {
+        *after = analyzeVertexCache(&indices[0], indices.size(), vertexCount());
+    }
+}
+
+bool GeometryData::matches(GeometryData& other)
+{
+    return (indexed == other.indexed) &&
+           (indices == other.indices) &&
+           (vertices == other.vertices) &&
+           (textureCoords == other.textureCoords) &&
+           (normals == other.normals) &&
+           (tangents == other.tangents) &&
+           (bitangents == other.bitangents);
+}
+
+double GeometryData::lastParseTime()
+{
+    return parseSeconds;
+}
+
+int GeometryData::vertexCount()
+{
+    return vertices.size()/3;
+}
+
+int GeometryData::indexCount()
+{
+    return indices.size();
+}
+
+void* GeometryData::vertexData()
+{
+    return (void*)&vertices[0];
+}
+
+void* GeometryData::textureCoordData()
+{
+    return (void*)&textureCoords[0];
+}
+
+void* GeometryData::normalData()
+{
+    return (void*)&normals[0];
+}
+
+void* GeometryData::tangentData()
+{
+    return (void*)&tangents[0];
+}
+
+void* GeometryData::bitangentData()
+{
+    return (void*)&bitangents[0];
+}
+
+unsigned int* GeometryData::indexData()
+{
+    return &indices[0];
+}
+
+VertexStreams GeometryData::streams()
+{
+    VertexStreams result = {};
+    result.vertexCount = vertexCount();
+    result.indexCount = indexed ? indexCount() : 0;
+    result.indexSize = sizeof(unsigned int);
+    result.positions = vertices.empty() ? 0 : &vertices[0];
+    result.textureCoords = textureCoords.empty() ? 0 : &textureCoords[0];
+    result.normals = normals.empty() ? 0 : &normals[0];
+    result.tangents = tangents.empty() ? 0 : &tangents[0];
+    result.bitangents = bitangents.empty() ? 0 : &bitangents[0];
+    result.indices = indices.empty() ? 0 : &indices[0];
+    return result;
 }
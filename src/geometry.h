@@ -4,6 +4,49 @@
 #include <vector>
 #include <string>
 
+#include "vertexcache.h"
+
+class ScratchArena;
+struct OBJChunk;
+struct OBJRecords;
+
+// Raw pointers to every stream of a piece of geometry, which is all that's needed to upload it.
+// Streams that aren't present are null, and indices is null for un-indexed geometry. This lets the
+// same upload code take data either from a GeometryData or straight out of a mapped mesh cache
+struct VertexStreams
+{
+    int vertexCount;
+    int indexCount;
+    int indexSize; // Bytes per index, 2 or 4
+
+    const float* positions;
+    const float* textureCoords;
+    const float* normals;
+    const float* tangents;
+    const float* bitangents;
+    const void* indices;
+};
+
+// Receives the triangles produced by loadOBJFileStreaming, a batch at a time
+class TriangleSink
+{
+public:
+    virtual ~TriangleSink() {}
+
+    // The streams hold un-indexed triangles (3 vertices each, indices is null) and are only valid
+    // for the duration of the call. Once a batch has texture coordinates or normals every later
+    // batch will too, with zeros for any faces that didn't reference one
+    virtual void addTriangles(const VertexStreams& streams) = 0;
+};
+
+// Reads an OBJ file a fixed size block at a time and passes the finished triangles on to the sink
+// in batches as it goes, so neither the whole file nor the face list is ever held in memory. The
+// v/vt/vn records are still kept (since any face can refer back to any of them) but those are
+// stored as floats, a fraction of the size of the file or of the expanded triangles. Triangles get
+// per-face (bi)tangents, the same as un-indexed GeometryData. Returns false if the file couldn't
+// be opened
+bool loadOBJFileStreaming(std::string filename, TriangleSink* sink, size_t blockSize = 4*1024*1024);
+
 struct FaceData
 {
     int vertexIndex[3];
@@ -14,22 +57,74 @@ struct FaceData
 class GeometryData
 {
 public:
-    void loadFromOBJFile(std::string filename);
+    GeometryData();
+
+    // When indexed is set (before loading), each unique v/vt/vn triple is only stored once and the
+    // faces are described by an index buffer instead of being expanded out into 3 vertices each.
+    // Indexed geometry gets smooth per-vertex tangent frames built from the faces sharing each
+    // vertex, orthonormalized against the normal (see computeVertexTangents)
+    void setIndexed(bool indexed);
+    bool isIndexed();
+
+    // If given, the scratch arena is reset and then used for everything the loader only needs
+    // while it runs (the raw records and faces), so that loading many files one after another
+    // doesn't allocate and free all of that for each one. Only the final streams are allocated
+    void loadFromOBJFile(std::string filename, ScratchArena* scratch = 0);
+    // Produces exactly the same data as loadFromOBJFile, but memory maps the file and parses it in
+    // place rather than going through an ifstream, which is much faster on large files
+    void loadFromOBJFileMapped(std::string filename, ScratchArena* scratch = 0);
+    // The same as loadFromOBJFileMapped, but splits the file into chunks which are parsed on
+    // separate threads (a threadCount of 0 uses every core). Small files are still parsed on a
+    // single thread since splitting them up isn't worth it. Unlike the stream loader, both mapped
+    // loaders also support relative (negative) face indices. Chunks parsed on other threads don't
+    // use the scratch arena
+    void loadFromOBJFileParallel(std::string filename, int threadCount = 0, ScratchArena* scratch = 0);
+    // Loads through loadOBJFileStreaming, which gives the same data as the other loaders with a much
+    // lower peak memory use. This only produces un-indexed geometry (weldVertices can index it
+    // afterwards), so it does nothing if setIndexed has been set
+    void loadFromOBJFileStreaming(std::string filename);
+    // Appends un-indexed triangles (as passed to a TriangleSink) to un-indexed geometry
+    void appendTriangles(const VertexStreams& streams);
+
+    // Turns un-indexed geometry into indexed geometry by merging vertices whose attributes are
+    // all exactly the same. Does nothing if the geometry is already indexed
+    void weldVertices();
+    // Reorders the triangles for the post-transform vertex cache and then the vertices into the
+    // order they are first used. Un-indexed geometry is welded first. If given, before and after
+    // are filled in with the simulated cache behaviour of the original and optimized orders
+    void optimizeVertexCache(VertexCacheStats* before = 0, VertexCacheStats* after = 0);
+
+    bool matches(GeometryData& other);
+    // How long the last loadFromOBJFile/Mapped/Parallel spent reading the file into records, in
+    // seconds. The rest of the load is expanding (or indexing) the faces into the streams
+    double lastParseTime();
 
     int vertexCount();
+    int indexCount();
 
     void* vertexData();
     void* textureCoordData();
     void* normalData();
     void* tangentData();
     void* bitangentData();
+    unsigned int* indexData();
+
+    VertexStreams streams();
 
 private:
+    void stitchOBJChunks(OBJChunk* chunks, int chunkCount, OBJRecords& tempGeom);
+    void expandFaces(OBJRecords& tempGeom);
+    void buildIndexedVertices(OBJRecords& tempGeom);
+
+    bool indexed;
+    double parseSeconds;
+
     std::vector<float> vertices;
     std::vector<float> textureCoords;
     std::vector<float> normals;
     std::vector<float> tangents;
     std::vector<float> bitangents;
+    std::vector<unsigned int> indices;
 
     std::vector<FaceData> faces;
 };
@@ -1,5 +1,8 @@
 #include <iostream>
+#include <vector>
+
 #include <stdio.h>
+#include <string.h>
 
 #include "SDL.h"
 #include <GL/glew.h>
@@ -14,12 +17,52 @@
 using namespace glm;
 using namespace std;
 
-glm::mat4 Model;
-glm::mat4 View;
-glm::mat4 Projection;
-glm::mat4 MVP;
-
-float size = 1.0f;
+// How fast the keys move, spin and scale the model, per second (apart from the wheel's step)
+// NOTE: These match what each frame used to do when the frame rate was tied to a 60Hz display
+static const float MOVE_SPEED = 3.0f;
+static const float ROTATE_SPEED = 900.0f; // Degrees
+static const float SCALE_SPEED = 0.6f;
+static const float WHEEL_SCALE_STEP = 0.1f;
+
+// The camera is at (4,3,3) in world space and looks at the origin, with its head up (set to 0,-1,0
+// to look upside-down)
+static const glm::vec3 CAMERA_POSITION(4, 3, 3);
+static const glm::vec3 CAMERA_TARGET(0, 0, 0);
+static const glm::vec3 CAMERA_UP(0, 1, 0);
+
+// Note that these paths are relative to your working directory when running the program (IE if you
+// run from within build then you need to place these files in build as well)
+static const char* VERTEX_SHADER_FILENAME = "SimpleTransform.vertexshader";
+static const char* FRAGMENT_SHADER_FILENAME = "SingleColor.fragmentshader";
+
+// The colour the model is drawn in
+static const glm::vec4 MODEL_COLOR(1, 0, 0, 1);
+
+// The constants every program needs that only change once a frame, which are written to a uniform
+// buffer once and bound to the FrameConstants block of every program, rather than each program
+// being given them separately. This has to match the block in the shaders, which is laid out with
+// std140 rules (for mat4s that just means one after another)
+struct FrameConstants
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+};
+static const GLuint FRAME_CONSTANTS_BINDING = 0;
+
+// NOTE: A region of the buffer the frame constants go through is used each frame, so this leaves
+//       room for a few more passes (each with their own constants) before it needs to grow
+static const size_t FRAME_CONSTANTS_REGION_SIZE = 4096;
+
+// The size of the window, or of the framebuffer we render into in headless mode
+static const int WINDOW_WIDTH = 640;
+static const int WINDOW_HEIGHT = 480;
+
+// NOTE: How much mesh data may be copied into buffers each frame while models are loading. This is
+//       small enough that the copy takes a fraction of a 60Hz frame even on slow drivers, while a
+//       typical model still finishes in a handful of frames. It's also the size of each region of
+//       the staging buffer the data goes through
+static const size_t UPLOAD_BUDGET_BYTES = 4*1024*1024;
 
 const char* glGetErrorString(GLenum error)
 {
@@ -51,92 +94,81 @@ void glPrintError(const char* label="Unlabelled Error Checkpoint", bool alwaysPr
     }
 }
 
-GLuint loadShader(const char* shaderFilename, GLenum shaderType)
-{
-    FILE* shaderFile = fopen(shaderFilename, "r");
-    if(!shaderFile)
-    {
-        return 0;
-    }
-
-    fseek(shaderFile, 0, SEEK_END);
-    long shaderSize = ftell(shaderFile);
-    fseek(shaderFile, 0, SEEK_SET);
-
-    char* shaderText = new char[shaderSize+1];
-    size_t readCount = fread(shaderText, 1, shaderSize, shaderFile);
-    shaderText[readCount] = '\0';
-    fclose(shaderFile);
-
-    GLuint shader = glCreateShader(shaderType);
-    glShaderSource(shader, 1, (const char**)&shaderText, NULL);
-    glCompileShader(shader);
-
-    delete[] shaderText;
-
-    return shader;
-}
-
-GLuint loadShaderProgram(const char* vertShaderFilename,
-                       const char* fragShaderFilename)
-{
-    GLuint vertShader = loadShader(vertShaderFilename, GL_VERTEX_SHADER);
-    GLuint fragShader = loadShader(fragShaderFilename, GL_FRAGMENT_SHADER);
-
-    GLuint program = glCreateProgram();
-    glAttachShader(program, vertShader);
-    glAttachShader(program, fragShader);
-    glLinkProgram(program);
-    glDeleteShader(vertShader);
-    glDeleteShader(fragShader);
-
-    GLint linkStatus;
-    glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
-    if(linkStatus != GL_TRUE)
-    {
-        GLsizei logLength = 0;
-        GLchar message[1024];
-        glGetProgramInfoLog(program, 1024, &logLength, message);
-        cout << "Shader load error: " << message << endl;
-        return 0;
-    }
-
-    return program;
-}
-
 OpenGLWindow::OpenGLWindow()
+    : sdlWin(0), headless(false), framebuffer(0), shader(0), modelLocation(-1),
+      positionScaleLocation(-1), positionOffsetLocation(-1), uniformBufferAlignment(256),
+      cameraNode(SCENE_NO_PARENT), modelNode(SCENE_NO_PARENT), modelSize(1.0f)
 {
+    renderbuffers[0] = 0;
+    renderbuffers[1] = 0;
 }
 
 
-void OpenGLWindow::initGL()
+bool OpenGLWindow::initGL(bool headless)
 {
-    // We need to first specify what type of OpenGL context we need before we can create the window
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 2);
-    SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
-
-    sdlWin = SDL_CreateWindow("OpenGL Prac 1",
-                              SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-                              640, 480, SDL_WINDOW_OPENGL);
-    if(!sdlWin)
+    this->headless = headless;
+    if(headless)
+    {
+        if(!headlessContext.create(3, 2))
+        {
+            return false;
+        }
+    }
+    else
     {
-        SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_INFORMATION, "Error", "Unable to create window", 0);
+        // We need to first specify what type of OpenGL context we need before we can create the window
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 2);
+        SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+
+        sdlWin = SDL_CreateWindow("OpenGL Prac 1",
+                                  SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+                                  WINDOW_WIDTH, WINDOW_HEIGHT, SDL_WINDOW_OPENGL);
+        if(!sdlWin)
+        {
+            SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_INFORMATION, "Error", "Unable to create window", 0);
+        }
+        SDL_GLContext glc = SDL_GL_CreateContext(sdlWin);
+        SDL_GL_MakeCurrent(sdlWin, glc);
     }
-    SDL_GLContext glc = SDL_GL_CreateContext(sdlWin);
-    SDL_GL_MakeCurrent(sdlWin, glc);
-    SDL_GL_SetSwapInterval(1);
 
     glewExperimental = true;
     GLenum glewInitResult = glewInit();
     glGetError(); // Consume the error erroneously set by glewInit()
+    // NOTE: Without an X display glew fails to load the GLX extensions and returns this error (which
+    //       only newer versions of glew.h name), but the GL functions were all loaded before that
+    const GLenum GLEW_ERROR_NO_GLX_DISPLAY = 4;
+    if(headless && (glewInitResult == GLEW_ERROR_NO_GLX_DISPLAY))
+    {
+        glewInitResult = GLEW_OK;
+    }
     if(glewInitResult != GLEW_OK)
     {
         const GLubyte* errorString = glewGetErrorString(glewInitResult);
         cout << "Unable to initialize glew: " << errorString;
     }
 
+    // There's no window to draw to in headless mode, so we draw into a framebuffer the same size
+    if(headless)
+    {
+        glGenRenderbuffers(2, renderbuffers);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, WINDOW_WIDTH, WINDOW_HEIGHT);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, WINDOW_WIDTH, WINDOW_HEIGHT);
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+        if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            cout << "Unable to create the headless framebuffer" << endl;
+            return false;
+        }
+        glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+    }
+
     int glMajorVersion;
     int glMinorVersion;
     glGetIntegerv(GL_MAJOR_VERSION, &glMajorVersion);
@@ -152,206 +184,365 @@ void OpenGLWindow::initGL()
     glCullFace(GL_BACK);
     glClearColor(1,1,1,1); // background colour
 
-    glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
+    // Uniform buffer ranges have to start on a multiple of this
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformBufferAlignment);
 
-    // Note that this path is relative to your working directory
-    // when running the program (IE if you run from within build
-    // then you need to place these files in build as well)
-    shader = loadShaderProgram("SimpleTransform.vertexshader", "SingleColor.fragmentshader");
-    glUseProgram(shader);
+    // The program is only compiled the first time, after that it's loaded from the binary the
+    // driver gave us then (see ShaderCache). The files are watched so that edits to them show up
+    // straight away (see reloadShaders)
+    GLuint program = shaderCache.loadProgram(VERTEX_SHADER_FILENAME, FRAGMENT_SHADER_FILENAME);
+    useProgram(program);
+    shaderWatcher.watch(VERTEX_SHADER_FILENAME);
+    shaderWatcher.watch(FRAGMENT_SHADER_FILENAME);
 
-    int colorLoc = glGetUniformLocation(shader, "objectColor");
-    glUniform3f(colorLoc, 1.0f, 1.0f, 1.0f);
+    // Projection matrix : 45° Field of View, 4:3 ratio, display range : 0.1 unit <-> 100 units. This
+    // only depends on the size of the window, so it never changes
+    projection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 100.0f);
+    // Or, for an ortho camera :
+    //projection = glm::ortho(-10.0f,10.0f,-10.0f,10.0f,0.0f,100.0f); // In world coordinates
+
+    // The camera node holds where the camera is in the world, which is the inverse of the view
+    // matrix. The model starts at the origin
+    cameraNode = scene.createNode(SCENE_NO_PARENT,
+                                  glm::inverse(glm::lookAt(CAMERA_POSITION, CAMERA_TARGET, CAMERA_UP)));
+    modelNode = scene.createNode();
+    updateScene();
+    previousModelTransform = scene.worldTransform(modelNode);
+
+    // Start loading the model that we want to use. It's loaded on a worker thread and uploaded a
+    // bit at a time by render (see AssetLoader), so the window is responsive straight away and just
+    // doesn't draw the model until it's all there. The mesh keeps its buffers around until cleanup
+    // so render doesn't have to touch the file again (like the shaders above, this path is
+    // relative to the working directory)
+    // NOTE: The attributes the shader doesn't need full precision for are stored compressed, see
+    //       --bench-compress for how much error each option introduces on a given model
+    VertexCompression compression = {};
+    compression.halfFloatTextureCoords = true;
+    compression.packNormals = true;
+    compression.packTangentFrame = true;
+    VertexLayout layout = makeInterleavedVertexLayout(VERTEX_ALL_ATTRIBUTES_BIT);
+    compressVertexLayout(&layout, compression);
+    model.setVertexLayout(layout);
+    uploadStaging.create(UPLOAD_BUDGET_BYTES);
+    frameConstants.create(FRAME_CONSTANTS_REGION_SIZE);
+    profiler.create();
+    setFramePacing(FRAME_PACING_VSYNC);
+    assetLoader.loadOBJFile("doggo.obj", &model);
 
-    
     glPrintError("Setup complete", true);
+    return true;
 }
 
-void OpenGLWindow::render()
+void OpenGLWindow::setFramePacing(FramePacing pacing, double frameRate)
 {
-    //Delta Time:
-    long last = 0;
-    float deltaTime = 0.0;    
-    long now = SDL_GetTicks();
-
-    //working out deltatime
-    if (now > last) {
-        deltaTime = ((float)(now - last)) / 1000;
-        last = now;
+    if(!headless)
+    {
+        if(SDL_GL_SetSwapInterval((pacing == FRAME_PACING_VSYNC) ? 1 : 0) != 0)
+        {
+            if(pacing == FRAME_PACING_VSYNC)
+            {
+                cout << "Unable to enable vsync, capping the frame rate at 60 instead" << endl;
+                pacing = FRAME_PACING_CAPPED;
+                frameRate = 60.0;
+            }
+        }
     }
+    else if(pacing == FRAME_PACING_VSYNC)
+    {
+        // There's no display to wait for
+        pacing = FRAME_PACING_UNCAPPED;
+    }
+    pacer.setPacing(pacing, frameRate);
+}
 
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-
-    GLuint MatrixID = glGetUniformLocation(shader, "MVP");
-
-    // Projection matrix : 45° Field of View, 4:3 ratio, display range : 0.1 unit <-> 100 units
-     Projection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 100.0f);
-    // Or, for an ortho camera :
-    //glm::mat4 Projection = glm::ortho(-10.0f,10.0f,-10.0f,10.0f,0.0f,100.0f); // In world coordinates
+void OpenGLWindow::waitForNextFrame()
+{
+    pacer.waitForNextFrame();
+}
 
-    //Camera matrix;
-    
-    View       = glm::lookAt(
-                                glm::vec3(4,3,3), // Camera is at (4,3,3), in World Space
-                                glm::vec3(0,0,0), // and looks at the origin
-                                glm::vec3(0,1,0)  // Head is up (set to 0,-1,0 to look upside-down)
-                           );
-    
-    
+void OpenGLWindow::update(float timestep)
+{
+    // NOTE: The node is only touched if something actually moved it, otherwise it stays clean and
+    //       nothing about it gets recomputed
+    glm::mat4 modelTransform = scene.localTransform(modelNode);
+    bool modelMoved = false;
 
-    // Model matrix : an identity matrix (model will be at the origin)
-    // Model = glm::mat4(1.0f);
+    if(input.actionHeld(INPUT_ACTION_MOVE_RIGHT))
+    {
+        modelTransform = glm::translate(modelTransform, glm::vec3(MOVE_SPEED * timestep,0,0));
+        modelMoved = true;
+    }
 
-    const Uint8 *state = SDL_GetKeyboardState(NULL);
-   
-    if (state[SDL_SCANCODE_RIGHT]) 
+    if(input.actionHeld(INPUT_ACTION_MOVE_LEFT))
     {
-        printf("Right Key Pressed.\n");
-        Model = glm::translate(Model, glm::vec3(0.05,0,0));
+        modelTransform = glm::translate(modelTransform, glm::vec3(-MOVE_SPEED * timestep,0,0));
+        modelMoved = true;
     }
 
-    if (state[SDL_SCANCODE_LEFT]) 
+    if(input.actionHeld(INPUT_ACTION_MOVE_UP))
     {
-        printf("Left Key Pressed.\n");
-        Model = glm::translate(Model, glm::vec3(-0.05,0,0));
+        modelTransform = glm::translate(modelTransform, glm::vec3(0,MOVE_SPEED * timestep,0));
+        modelMoved = true;
     }
 
-    if (state[SDL_SCANCODE_UP]) 
+    if(input.actionHeld(INPUT_ACTION_MOVE_DOWN))
     {
-        printf("Up Key Pressed.\n");
-        Model = glm::translate(Model, glm::vec3(0,0.05,0));
+        modelTransform = glm::translate(modelTransform, glm::vec3(0,-MOVE_SPEED * timestep,0));
+        modelMoved = true;
     }
 
-    if (state[SDL_SCANCODE_DOWN]) 
+    if(input.actionHeld(INPUT_ACTION_ROTATE))
     {
-        printf("Down Key Pressed.\n");
-        Model = glm::translate(Model, glm::vec3(0,-0.05,0));
+        modelTransform = glm::rotate(modelTransform, glm::radians(ROTATE_SPEED * timestep), glm::vec3(4, 3, 3));
+        modelMoved = true;
     }
 
-    if (state[SDL_SCANCODE_R]) 
+    // The keys scale smoothly, and each step of the mouse wheel by a fixed amount
+    float sizeChange = 0.0f;
+    if(input.actionHeld(INPUT_ACTION_SHRINK))
+    {
+        sizeChange -= SCALE_SPEED * timestep;
+    }
+    if(input.actionHeld(INPUT_ACTION_GROW))
     {
-        printf("R Key Pressed.\n");
-        Model = glm::rotate(Model, glm::radians(15.0f), glm::vec3(4, 3, 3));
+        sizeChange += SCALE_SPEED * timestep;
+    }
+    sizeChange += WHEEL_SCALE_STEP * input.takeWheelSteps();
+    if(sizeChange != 0.0f)
+    {
+        modelSize = glm::clamp(modelSize + sizeChange, 0.0f, 20.0f);
+        modelTransform = glm::scale(glm::mat4(1.0f), glm::vec3(modelSize));
+        modelMoved = true;
     }
 
-    if(state[SDL_SCANCODE_S])
+    if(modelMoved)
     {
-        if(size > 0.00)
-        { 
-            size -= 0.01f;
-        }
+        scene.setLocalTransform(modelNode, modelTransform);
+    }
+}
 
-        printf("S Key Pressed.\n");
-        Model = glm::scale(glm::mat4(1.0f), glm::vec3(size));
+void OpenGLWindow::updateScene()
+{
+    if(scene.updateWorldTransforms() == 0)
+    {
+        return;
     }
 
-    if(state[SDL_SCANCODE_B])
+    const vector<SceneNode>& changed = scene.changedNodes();
+    for(size_t i=0; i<changed.size(); i++)
     {
-        if(size < 20.00)
-        { 
-            size += 0.01f;
+        if(changed[i] == cameraNode)
+        {
+            // Remember, matrix multiplication is the other way around, so the view and projection
+            // are combined once here and the model matrix is applied to them in the shader
+            view = glm::inverse(scene.worldTransform(cameraNode));
+            viewProjection = projection * view;
+            break;
         }
-        
-        printf("B Key Pressed.\n");
-        Model = glm::scale(glm::mat4(1.0f), glm::vec3(size));
     }
+}
 
-    // const Uint32 *Mstate = SDL_GetMouseState(0,0);
-    // if(Mstate[SDL_MOUSEWHEEL])
-    // {
-    //     Model = glm::scale(glm::mat4(1.0f), glm::vec3(0.5f));
-    //     cout << "hey" << endl;
-    // }
-
-    // SDL_PumpEvents();
-    // if (SDL_GetMouseState(NULL, NULL)) {
-    // SDL_Log("Mouse Button 1 (left)");
-    // }
+void OpenGLWindow::render()
+{
+    // Shaders are only swapped between frames, so a frame never mixes two versions
+    if(!shaderWatcher.changedFiles().empty())
+    {
+        reloadShaders();
+    }
 
+    profiler.beginFrame();
 
-    SDL_Event event;
-    while( SDL_PollEvent( &event ) )
+    // Catch the simulation up to the current time, in fixed steps
+    profiler.beginPass("update");
+    int updateCount = pacer.beginFrame();
+    for(int i=0; i<updateCount; i++)
     {
-        if(event.type == SDL_MOUSEWHEEL)
-        {
-            if(event.wheel.y > 0) // scroll up
-            {
-                cout << "up" << endl;
-            }
-            else if(event.wheel.y < 0) // scroll down
-            {
-                cout << "down" << endl; 
-            }
-        }
+        previousModelTransform = scene.worldTransform(modelNode);
+        update(pacer.timestep());
+        updateScene();
     }
+    profiler.endPass();
 
+    // Copy in the next part of any model that has finished loading
+    profiler.beginPass("upload");
+    assetLoader.update(UPLOAD_BUDGET_BYTES, &uploadStaging);
+    profiler.endPass();
 
-    // Our ModelViewProjection : multiplication of our 3 matrices
-    MVP  = Projection * View * Model; // Remember, matrix multiplication is the other way around
+    profiler.beginPass("draw");
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    // Load the model that we want to use and buffer the vertex attributes
-    // GeometryData geometry = loadFromOBJFile("tri.obj");
-    GeometryData doggo;
-    doggo.loadFromOBJFile("/home/t/tldlir001/OpenGL_Assignment/opengl-prac1/doggo.obj");
+    // The frame falls part way between the last two updates, so the model is drawn part way
+    // between them too
+    // NOTE: Blending the matrices isn't a proper rotation, but the steps are small enough that the
+    //       difference can't be seen
+    float alpha = pacer.interpolation();
+    glm::mat4 drawnModel = previousModelTransform * (1.0f - alpha) + scene.worldTransform(modelNode) * alpha;
+
+    // NOTE: The constants are still written every frame, since the region of the buffer they were
+    //       written to last time gets reused, but they're only recomputed when the camera moves
+    FrameConstants constants;
+    constants.view = view;
+    constants.projection = projection;
+    constants.viewProjection = viewProjection;
+    size_t constantsOffset;
+    void* constantsData = frameConstants.beginWrite(sizeof(FrameConstants), (size_t)uniformBufferAlignment,
+                                                     &constantsOffset);
+    if(constantsData)
+    {
+        memcpy(constantsData, &constants, sizeof(FrameConstants));
+        frameConstants.endWrite();
+        glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_CONSTANTS_BINDING, frameConstants.buffer(),
+                          constantsOffset, sizeof(FrameConstants));
+    }
 
-    /*
-    float vertices[9] = { 0.0f,  0.5f, 0.0f,
-                         -0.5f, -0.5f, 0.0f,
-                          0.5f, -0.5f, 0.0f }; //gonna load a picture here (triangle)
-    */
+    glUniformMatrix4fv(modelLocation, 1, GL_FALSE, &drawnModel[0][0]);
+    setSingleInstanceAttributes(MODEL_COLOR);
 
-    glGenBuffers(1, &vertexBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
-    glBufferData(GL_ARRAY_BUFFER, doggo.vertexCount() * 3 * sizeof(float),  doggo.vertexData(), GL_STATIC_DRAW);  //(old) glBufferData(GL_ARRAY_BUFFER, 9*sizeof(float), vertices, GL_STATIC_DRAW);
-    glVertexAttribPointer(MatrixID, 3, GL_FLOAT, false, 0, 0);
-    glEnableVertexAttribArray(MatrixID);
+    const VertexLayout& modelLayout = model.vertexLayout();
+    glUniform3fv(positionScaleLocation, 1, modelLayout.positionScale);
+    glUniform3fv(positionOffsetLocation, 1, modelLayout.positionOffset);
 
-    
+    // Once the model is uploaded all we need to do here is issue the draw
+    model.draw();
+    profiler.endPass();
 
-        glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &MVP[0][0]);
+    // NOTE: The frame is timed before the swap, since with vsync on the swap just waits for the
+    //       display and would hide the actual CPU cost of the frame
+    profiler.endFrame();
 
+    // Everything that reads this frame's staging data and constants has been issued now
+    uploadStaging.endFrame();
+    frameConstants.endFrame();
 
-        // 1rst attribute buffer : vertices
-        glEnableVertexAttribArray(0);
-        glBindBuffer(GL_ARRAY_BUFFER, vao);
-        glVertexAttribPointer(
-            0,                  // attribute. No particular reason for 0, but must match the layout in the shader.
-            3,                  // size
-            GL_FLOAT,           // type
-            GL_FALSE,           // normalized?
-            0,                  // stride
-            (void*)0            // array buffer offset
-        );
+    // Swap the front and back buffers on the window, effectively putting what we just "drew"
+    // onto the screen (whereas previously it only existed in memory). Headless frames stay in the
+    // framebuffer, so all we do is make sure the GPU gets started on them
+    if(headless)
+    {
+        glFlush();
+    }
+    else
+    {
+        SDL_GL_SwapWindow(sdlWin);
+    }
+}
 
+void OpenGLWindow::useProgram(GLuint program)
+{
+    shader = program;
+    glUseProgram(shader);
 
-    glDrawArrays(GL_TRIANGLES, 0, doggo.vertexCount());
+    // NOTE: A new program can put its uniforms anywhere, so the locations have to be looked up
+    //       again. They were already queried when the program was loaded, so this doesn't have to
+    //       ask the driver
+    const ProgramUniforms& uniforms = shaderCache.uniforms(shader);
+    modelLocation = uniforms.location("Model");
+    positionScaleLocation = uniforms.location("positionScale");
+    positionOffsetLocation = uniforms.location("positionOffset");
+
+    // Which binding point a block reads from is part of the program too
+    GLuint constantsBlock = uniforms.blockIndex("FrameConstants");
+    if(constantsBlock == GL_INVALID_INDEX)
+    {
+        cout << "The shader program has no FrameConstants block, it won't get the camera" << endl;
+    }
+    else if(uniforms.blockSize("FrameConstants") != sizeof(FrameConstants))
+    {
+        cout << "The shader program's FrameConstants block doesn't match the FrameConstants struct" << endl;
+    }
+    else
+    {
+        glUniformBlockBinding(shader, constantsBlock, FRAME_CONSTANTS_BINDING);
+    }
+}
 
-    // Swap the front and back buffers on the window, effectively putting what we just "drew"
-    // onto the screen (whereas previously it only existed in memory)
-    SDL_GL_SwapWindow(sdlWin);
+void OpenGLWindow::reloadShaders()
+{
+    // NOTE: This only returns a different program once the new sources have compiled and linked, so
+    //       a mistake in them just leaves the old program in use until the next save
+    GLuint program = shaderCache.loadProgram(VERTEX_SHADER_FILENAME, FRAGMENT_SHADER_FILENAME);
+    if(!program)
+    {
+        cout << "Keeping the previous shader program" << endl;
+        return;
+    }
+    if(program != shader)
+    {
+        shaderCache.releaseProgram(shader);
+        useProgram(program);
+        cout << "Reloaded the shader program" << endl;
+    }
 }
 
 // The program will exit if this function returns false
-bool OpenGLWindow::handleEvent(SDL_Event e)
+bool OpenGLWindow::pumpEvents()
 {
-    // A list of keycode constants is available here: https://wiki.libsdl.org/SDL_Keycode
-    // Note that SDL provides both Scancodes (which correspond to physical positions on the keyboard)
-    // and Keycodes (which correspond to symbols on the keyboard, and might differ across layouts)
-    if(e.type == SDL_KEYDOWN)
+    if(!input.pumpEvents())
     {
-        if(e.key.keysym.sym == SDLK_ESCAPE)
-        {
-            return false;
-        }
+        return false;
+    }
+    return !input.actionPressed(INPUT_ACTION_QUIT);
+}
+
+void OpenGLWindow::finishLoading()
+{
+    while(assetLoader.pendingCount() > 0)
+    {
+        assetLoader.update(UPLOAD_BUDGET_BYTES, &uploadStaging);
+        uploadStaging.endFrame();
+        SDL_Delay(1);
     }
-    return true;
+}
+
+bool OpenGLWindow::saveFrame(string filename)
+{
+    // NOTE: GL's rows go from the bottom up, but the image's go from the top down
+    vector<unsigned char> pixels(3 * WINDOW_WIDTH * WINDOW_HEIGHT);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadBuffer(headless ? GL_COLOR_ATTACHMENT0 : GL_BACK);
+    glReadPixels(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+
+    FILE* file = fopen(filename.c_str(), "wb");
+    if(!file)
+    {
+        cout << "Unable to write frame: " << filename << endl;
+        return false;
+    }
+    fprintf(file, "P6\n%d %d\n255\n", WINDOW_WIDTH, WINDOW_HEIGHT);
+    bool success = true;
+    for(int row=WINDOW_HEIGHT-1; row>=0; row--)
+    {
+        success = success && (fwrite(&pixels[3 * WINDOW_WIDTH * row], 3, WINDOW_WIDTH, file) == WINDOW_WIDTH);
+    }
+    fclose(file);
+    if(!success)
+    {
+        cout << "Unable to write frame: " << filename << endl;
+    }
+    return success;
+}
+
+bool OpenGLWindow::writeProfile(string filename)
+{
+    return profiler.write(filename);
 }
 
 void OpenGLWindow::cleanup()
 {
-    glDeleteBuffers(1, &vertexBuffer);
-    glDeleteVertexArrays(1, &vao);
-    SDL_DestroyWindow(sdlWin);
+    assetLoader.stop();
+    profiler.destroy();
+    uploadStaging.destroy();
+    frameConstants.destroy();
+    model.cleanup();
+    shaderCache.destroy();
+    if(headless)
+    {
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteRenderbuffers(2, renderbuffers);
+        headlessContext.destroy();
+    }
+    else
+    {
+        SDL_DestroyWindow(sdlWin);
+    }
 }
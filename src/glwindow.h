@@ -1,26 +1,91 @@
 #ifndef GL_WINDOW_H
 #define GL_WINDOW_H
 
+#include <string>
+
 #include <GL/glew.h>
 
+#include "assetloader.h"
+#include "filewatcher.h"
+#include "framepacer.h"
 #include "geometry.h"
+#include "headlesscontext.h"
+#include "input.h"
+#include "instancebuffer.h"
+#include "mesh.h"
+#include "profiler.h"
+#include "scenegraph.h"
+#include "shadercache.h"
 
 class OpenGLWindow
 {
 public:
     OpenGLWindow();
 
-    void initGL();
+    // In headless mode there's no window at all (and SDL's video doesn't need initializing), the
+    // frames are rendered into an offscreen framebuffer instead (see HeadlessContext)
+    bool initGL(bool headless = false);
+    // Defaults to vsync for a window, and uncapped in headless mode. If the driver won't let us turn
+    // vsync on, frames are capped at 60 per second instead
+    void setFramePacing(FramePacing pacing, double frameRate = 60.0);
+    // Called before reading input for each frame (see FramePacer::waitForNextFrame)
+    void waitForNextFrame();
     void render();
-    bool handleEvent(SDL_Event e);
+    // Reads this frame's input (see Input::pumpEvents), returns false when the program should exit
+    bool pumpEvents();
     void cleanup();
 
+    // Waits until every model that's loading has been uploaded, so that the frames rendered after
+    // this are all the same (which regression tests comparing frames rely on)
+    void finishLoading();
+    // Writes the last frame rendered to a binary PPM image
+    bool saveFrame(std::string filename);
+    // Writes the frame timings held by the profiler, see Profiler::write for the formats
+    bool writeProfile(std::string filename);
+
 private:
+    // Advances everything that moves by one fixed step of timestep seconds
+    void update(float timestep);
+    // Makes the program current and looks up its uniforms
+    void useProgram(GLuint program);
+    // Rebuilds the shader program from the files after they've been edited
+    void reloadShaders();
+    // Brings the scene's world transforms up to date, and the camera matrices with them if the
+    // camera has moved
+    void updateScene();
+
     SDL_Window* sdlWin;
+    bool headless;
+    HeadlessContext headlessContext;
+    GLuint framebuffer;
+    GLuint renderbuffers[2];
 
-    GLuint vao;
+    ShaderCache shaderCache;
+    FileWatcher shaderWatcher;
     GLuint shader;
-    GLuint vertexBuffer;
+    GLint modelLocation;
+    GLint positionScaleLocation;
+    GLint positionOffsetLocation;
+    StreamBuffer frameConstants;
+    GLint uniformBufferAlignment;
+
+    // Everything that has a position, the camera included. Matrices are only recomputed when
+    // something has actually moved
+    SceneGraph scene;
+    SceneNode cameraNode;
+    SceneNode modelNode;
+    glm::mat4 previousModelTransform; // As of the update before last, for interpolating between them
+    float modelSize;
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+
+    Mesh model;
+    AssetLoader assetLoader;
+    StreamBuffer uploadStaging;
+    Profiler profiler;
+    FramePacer pacer;
+    Input input;
 };
 
 #endif
@@ -0,0 +1,128 @@
+#include <iostream>
+
+#include <string.h>
+
+#ifndef _WIN32
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+using namespace std;
+
+#include "headlesscontext.h"
+
+HeadlessContext::HeadlessContext()
+    : display(0), context(0)
+{
+}
+
+HeadlessContext::~HeadlessContext()
+{
+    destroy();
+}
+
+#ifdef _WIN32
+
+bool HeadlessContext::create(int majorVersion, int minorVersion)
+{
+    cout << "Headless rendering is not supported on Windows" << endl;
+    return false;
+}
+
+void HeadlessContext::destroy()
+{
+}
+
+#else
+
+bool HeadlessContext::create(int majorVersion, int minorVersion)
+{
+    destroy();
+
+    // The surfaceless platform needs no window system at all. Without it we fall back to the
+    // default display, which still works as long as there is one
+    EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if(getPlatformDisplay)
+    {
+        eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, 0);
+    }
+    if(eglDisplay == EGL_NO_DISPLAY)
+    {
+        eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    if((eglDisplay == EGL_NO_DISPLAY) || !eglInitialize(eglDisplay, 0, 0))
+    {
+        cout << "Unable to initialize EGL for headless rendering" << endl;
+        return false;
+    }
+    display = eglDisplay;
+
+    if(!eglBindAPI(EGL_OPENGL_API))
+    {
+        cout << "EGL does not support desktop OpenGL" << endl;
+        destroy();
+        return false;
+    }
+
+    // NOTE: Since we only ever render into FBOs the context doesn't need a config (which the
+    //       surfaceless platform may not have any of for desktop GL anyway). If the display doesn't
+    //       support that then any config that can do desktop GL will do
+    EGLConfig config = 0;
+    const char* extensions = eglQueryString(eglDisplay, EGL_EXTENSIONS);
+    bool noConfig = extensions && strstr(extensions, "EGL_KHR_no_config_context");
+    if(!noConfig)
+    {
+        EGLint configAttributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+        EGLint configCount = 0;
+        if(!eglChooseConfig(eglDisplay, configAttributes, &config, 1, &configCount) ||
+           (configCount == 0))
+        {
+            cout << "No EGL config supports desktop OpenGL" << endl;
+            destroy();
+            return false;
+        }
+    }
+
+    EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, majorVersion,
+        EGL_CONTEXT_MINOR_VERSION, minorVersion,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext eglContext = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, contextAttributes);
+    if(eglContext == EGL_NO_CONTEXT)
+    {
+        cout << "Unable to create a headless OpenGL " << majorVersion << "." << minorVersion
+             << " context" << endl;
+        destroy();
+        return false;
+    }
+    context = eglContext;
+
+    if(!eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext))
+    {
+        cout << "Unable to make the headless context current" << endl;
+        destroy();
+        return false;
+    }
+    return true;
+}
+
+void HeadlessContext::destroy()
+{
+    if(context)
+    {
+        eglMakeCurrent((EGLDisplay)display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext((EGLDisplay)display, (EGLContext)context);
+        context = 0;
+    }
+    if(display)
+    {
+        eglTerminate((EGLDisplay)display);
+        display = 0;
+    }
+}
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+// An OpenGL core profile context with no window and no display, for running the renderer on
+// machines that don't have one (CI, render farm nodes). It's created through EGL's surfaceless
+// platform, which Mesa supports with any of its drivers including llvmpipe, so it doesn't need a
+// GPU at all. There's no default framebuffer, so everything has to be rendered into an FBO
+// NOTE: This is only implemented on linux, create just fails elsewhere
+class HeadlessContext
+{
+public:
+    HeadlessContext();
+    ~HeadlessContext();
+
+    // Creates the context and makes it current on the calling thread
+    bool create(int majorVersion, int minorVersion);
+    void destroy();
+
+private:
+    HeadlessContext(const HeadlessContext&);
+    HeadlessContext& operator=(const HeadlessContext&);
+
+    // NOTE: These are the EGLDisplay and EGLContext, kept as void* so that EGL's headers don't
+    //       need to be included everywhere this is
+    void* display;
+    void* context;
+};
+
+#endif
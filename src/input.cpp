@@ -0,0 +1,147 @@
+#include <stddef.h>
+
+#include "input.h"
+
+Input::Input()
+    : mousePositionX(0), mousePositionY(0), mouseButtons(0), wheelSteps(0)
+{
+    releaseAll();
+
+    bindKey(INPUT_ACTION_MOVE_LEFT, SDL_SCANCODE_LEFT);
+    bindKey(INPUT_ACTION_MOVE_RIGHT, SDL_SCANCODE_RIGHT);
+    bindKey(INPUT_ACTION_MOVE_UP, SDL_SCANCODE_UP);
+    bindKey(INPUT_ACTION_MOVE_DOWN, SDL_SCANCODE_DOWN);
+    bindKey(INPUT_ACTION_ROTATE, SDL_SCANCODE_R);
+    bindKey(INPUT_ACTION_SHRINK, SDL_SCANCODE_S);
+    bindKey(INPUT_ACTION_GROW, SDL_SCANCODE_B);
+    bindKey(INPUT_ACTION_QUIT, SDL_SCANCODE_ESCAPE);
+}
+
+bool Input::pumpEvents()
+{
+    for(int i=0; i<SDL_NUM_SCANCODES; i++)
+    {
+        pressed[i] = false;
+    }
+
+    bool running = true;
+    SDL_Event e;
+    while(SDL_PollEvent(&e))
+    {
+        switch(e.type)
+        {
+        case SDL_QUIT:
+            running = false;
+            break;
+        case SDL_KEYDOWN:
+        case SDL_KEYUP:
+            // A list of scancode constants is available here: https://wiki.libsdl.org/SDL_Scancode
+            // Scancodes correspond to physical positions on the keyboard, rather than the symbols
+            // on the keys (which might differ across layouts)
+            if(e.key.keysym.scancode < SDL_NUM_SCANCODES)
+            {
+                bool down = (e.type == SDL_KEYDOWN);
+                // NOTE: Key repeats aren't presses, the key was already held
+                if(down && !e.key.repeat)
+                {
+                    pressed[e.key.keysym.scancode] = true;
+                }
+                held[e.key.keysym.scancode] = down;
+            }
+            break;
+        case SDL_MOUSEMOTION:
+            mousePositionX = e.motion.x;
+            mousePositionY = e.motion.y;
+            break;
+        case SDL_MOUSEBUTTONDOWN:
+            mouseButtons |= SDL_BUTTON(e.button.button);
+            break;
+        case SDL_MOUSEBUTTONUP:
+            mouseButtons &= ~SDL_BUTTON(e.button.button);
+            break;
+        case SDL_MOUSEWHEEL:
+            wheelSteps += (e.wheel.direction == SDL_MOUSEWHEEL_FLIPPED) ? -e.wheel.y : e.wheel.y;
+            break;
+        case SDL_WINDOWEVENT:
+            // We don't get the key up events for keys released while another window has the focus,
+            // so without this they would stay held
+            if(e.window.event == SDL_WINDOWEVENT_FOCUS_LOST)
+            {
+                releaseAll();
+            }
+            break;
+        }
+    }
+    return running;
+}
+
+void Input::bindKey(InputAction action, SDL_Scancode key)
+{
+    bindings[action].push_back(key);
+}
+
+void Input::clearBindings(InputAction action)
+{
+    bindings[action].clear();
+}
+
+bool Input::actionHeld(InputAction action)
+{
+    for(size_t i=0; i<bindings[action].size(); i++)
+    {
+        if(held[bindings[action][i]])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Input::actionPressed(InputAction action)
+{
+    for(size_t i=0; i<bindings[action].size(); i++)
+    {
+        if(pressed[bindings[action][i]])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Input::keyHeld(SDL_Scancode key)
+{
+    return held[key];
+}
+
+int Input::mouseX()
+{
+    return mousePositionX;
+}
+
+int Input::mouseY()
+{
+    return mousePositionY;
+}
+
+bool Input::mouseButtonHeld(int button)
+{
+    return (mouseButtons & SDL_BUTTON(button)) != 0;
+}
+
+int Input::takeWheelSteps()
+{
+    int steps = wheelSteps;
+    wheelSteps = 0;
+    return steps;
+}
+
+void Input::releaseAll()
+{
+    for(int i=0; i<SDL_NUM_SCANCODES; i++)
+    {
+        held[i] = false;
+        pressed[i] = false;
+    }
+    mouseButtons = 0;
+}
@@ -0,0 +1,67 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <vector>
+
+#include "SDL.h"
+
+// The things the keys do, so that the code reacting to them doesn't need to know which keys they
+// are (see Input::bindKey)
+enum InputAction
+{
+    INPUT_ACTION_MOVE_LEFT,
+    INPUT_ACTION_MOVE_RIGHT,
+    INPUT_ACTION_MOVE_UP,
+    INPUT_ACTION_MOVE_DOWN,
+    INPUT_ACTION_ROTATE,
+    INPUT_ACTION_SHRINK,
+    INPUT_ACTION_GROW,
+    INPUT_ACTION_QUIT,
+    INPUT_ACTION_COUNT
+};
+
+// Takes every SDL event once per frame and keeps the state of the keyboard and mouse, so that the
+// rest of the program asks about the input rather than reading events itself (the events can only
+// be read once, so anything else reading them takes them away from everyone else)
+class Input
+{
+public:
+    // Starts with the default bindings, the arrow keys to move, R to rotate, S and B to shrink and
+    // grow and escape to quit
+    Input();
+
+    // Reads all of the events waiting, returns false if the program was asked to close. What was
+    // pressed since the last call is forgotten first, so this must be called exactly once a frame
+    bool pumpEvents();
+
+    // Adds a key that triggers the action, an action can have any number of keys
+    void bindKey(InputAction action, SDL_Scancode key);
+    void clearBindings(InputAction action);
+
+    // Whether any key bound to the action is down, or went down since the last pumpEvents
+    bool actionHeld(InputAction action);
+    bool actionPressed(InputAction action);
+    bool keyHeld(SDL_Scancode key);
+
+    // In window coordinates
+    int mouseX();
+    int mouseY();
+    // button is SDL_BUTTON_LEFT and so on
+    bool mouseButtonHeld(int button);
+    // Returns the wheel movement (positive away from the user) that hasn't been taken yet. This
+    // isn't cleared each frame, since a fixed update might not run in the frame it happened in
+    int takeWheelSteps();
+
+private:
+    void releaseAll();
+
+    std::vector<SDL_Scancode> bindings[INPUT_ACTION_COUNT];
+    bool held[SDL_NUM_SCANCODES];
+    bool pressed[SDL_NUM_SCANCODES];
+    int mousePositionX;
+    int mousePositionY;
+    Uint32 mouseButtons;
+    int wheelSteps;
+};
+
+#endif
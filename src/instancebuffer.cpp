@@ -0,0 +1,144 @@
+#include <iostream>
+
+#include <string.h>
+
+using namespace std;
+
+#include "instancebuffer.h"
+
+InstanceBuffer::InstanceBuffer()
+    : capacity(0), count(0), transformOffset(0), colorOffset(0), hasColors(false), batchColor(1.0f)
+{
+}
+
+bool InstanceBuffer::create(int maxInstances)
+{
+    destroy();
+
+    // NOTE: glDrawElementsInstanced is in GL 3.1, but reading attributes per instance rather than
+    //       per vertex (glVertexAttribDivisor) is only core from 3.3
+    if(!(GLEW_VERSION_3_3 || GLEW_ARB_instanced_arrays))
+    {
+        cout << "Instance buffer error: The driver doesn't support instanced arrays" << endl;
+        return false;
+    }
+
+    size_t instanceSize = sizeof(glm::mat4) + sizeof(glm::vec4);
+    if(!stream.create(maxInstances * instanceSize))
+    {
+        return false;
+    }
+    capacity = maxInstances;
+    return true;
+}
+
+void InstanceBuffer::destroy()
+{
+    stream.destroy();
+    capacity = 0;
+    count = 0;
+}
+
+bool InstanceBuffer::submit(const glm::mat4* transforms, int count, const glm::vec4* colors,
+                            const glm::vec4& color)
+{
+    this->count = 0;
+    if((count <= 0) || (count > capacity))
+    {
+        return count == 0;
+    }
+
+    size_t transformBytes = count * sizeof(glm::mat4);
+    size_t colorBytes = colors ? count * sizeof(glm::vec4) : 0;
+    size_t offset;
+    unsigned char* data = (unsigned char*)stream.beginWrite(transformBytes + colorBytes, sizeof(glm::vec4), &offset);
+    if(!data)
+    {
+        return false;
+    }
+    memcpy(data, transforms, transformBytes);
+    if(colors)
+    {
+        memcpy(data + transformBytes, colors, colorBytes);
+    }
+    stream.endWrite();
+
+    this->count = count;
+    transformOffset = offset;
+    colorOffset = offset + transformBytes;
+    hasColors = (colors != 0);
+    batchColor = color;
+    return true;
+}
+
+void InstanceBuffer::draw(Mesh& mesh)
+{
+    if((count == 0) || !mesh.bind())
+    {
+        return;
+    }
+
+    // The instance attributes are added to the mesh's vertex array just for this draw, since where
+    // the instances are in the buffer changes from one submit to the next
+    glBindBuffer(GL_ARRAY_BUFFER, stream.buffer());
+    for(GLuint column=0; column<4; column++)
+    {
+        GLuint location = INSTANCE_TRANSFORM_LOCATION + column;
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+                              (void*)(transformOffset + column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(location, 1);
+        glEnableVertexAttribArray(location);
+    }
+    if(hasColors)
+    {
+        glVertexAttribPointer(INSTANCE_COLOR_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4),
+                              (void*)colorOffset);
+        glVertexAttribDivisor(INSTANCE_COLOR_LOCATION, 1);
+        glEnableVertexAttribArray(INSTANCE_COLOR_LOCATION);
+    }
+    else
+    {
+        glVertexAttrib4f(INSTANCE_COLOR_LOCATION, batchColor.x, batchColor.y, batchColor.z, batchColor.w);
+    }
+
+    mesh.drawInstanced(count);
+
+    // NOTE: Left enabled, a later Mesh::draw of the same mesh would read the first instance from
+    //       wherever the buffer was at the time, rather than the current attribute values
+    for(GLuint location=INSTANCE_TRANSFORM_LOCATION; location<=INSTANCE_COLOR_LOCATION; location++)
+    {
+        glDisableVertexAttribArray(location);
+    }
+}
+
+void InstanceBuffer::endFrame()
+{
+    stream.endFrame();
+    count = 0;
+}
+
+int InstanceBuffer::instanceCount()
+{
+    return count;
+}
+
+int InstanceBuffer::maxInstances()
+{
+    return capacity;
+}
+
+int InstanceBuffer::stallCount()
+{
+    return stream.stallCount();
+}
+
+void setSingleInstanceAttributes(const glm::vec4& color)
+{
+    for(GLuint column=0; column<4; column++)
+    {
+        glm::vec4 identityColumn(0.0f);
+        identityColumn[column] = 1.0f;
+        glVertexAttrib4fv(INSTANCE_TRANSFORM_LOCATION + column, &identityColumn[0]);
+    }
+    glVertexAttrib4f(INSTANCE_COLOR_LOCATION, color.x, color.y, color.z, color.w);
+}
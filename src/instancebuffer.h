@@ -0,0 +1,71 @@
+#ifndef INSTANCE_BUFFER_H
+#define INSTANCE_BUFFER_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "mesh.h"
+#include "streambuffer.h"
+
+// NOTE: The shader input locations of the per-instance attributes, which come after the vertex
+//       attributes (see VertexAttribute) and have to match the layout(location = ...)
+//       declarations in the vertex shaders. A mat4 takes up 4 locations, one per column
+static const GLuint INSTANCE_TRANSFORM_LOCATION = 5;
+static const GLuint INSTANCE_COLOR_LOCATION = 9;
+
+// Draws many copies of a mesh with one draw call. Each frame the callers submit the transform of
+// every copy (and optionally a colour each), which go straight into a StreamBuffer, and then draw
+// the mesh once per instance with glDrawElementsInstanced/glDrawArraysInstanced, the shader reading
+// each instance's values from per-instance attributes.
+// The transforms and colours are kept in separate arrays, so an array of transforms that's already
+// packed together (such as SceneGraph::worldTransforms) is copied in with a single memcpy, and the
+// colours take no space at all when the whole batch is one colour
+class InstanceBuffer
+{
+public:
+    InstanceBuffer();
+
+    // Makes room for up to maxInstances instances a frame. Returns false (after printing why) if
+    // the driver can't draw instanced meshes. Like Mesh, destroy has to be called while the GL
+    // context still exists
+    bool create(int maxInstances);
+    void destroy();
+
+    // Copies the instances to be drawn by the next draw. colors can be null to draw every instance
+    // with color instead. Returns false (and draws nothing) if this frame's region is out of room
+    bool submit(const glm::mat4* transforms, int count, const glm::vec4* colors = 0,
+                const glm::vec4& color = glm::vec4(1.0f));
+    // Draws mesh once for every instance submitted, and can be called again to draw another mesh
+    // with the same instances
+    void draw(Mesh& mesh);
+
+    // Called once every draw of this frame's instances has been issued (see StreamBuffer::endFrame)
+    void endFrame();
+
+    int instanceCount();
+    int maxInstances();
+    // See StreamBuffer::stallCount
+    int stallCount();
+
+private:
+    InstanceBuffer(const InstanceBuffer&);
+    InstanceBuffer& operator=(const InstanceBuffer&);
+
+    StreamBuffer stream;
+    int capacity;
+
+    // The last submit
+    int count;
+    size_t transformOffset;
+    size_t colorOffset;
+    bool hasColors;
+    glm::vec4 batchColor;
+};
+
+// Sets the per-instance attributes up for drawing a mesh on its own (with Mesh::draw rather than
+// through an InstanceBuffer), so that the shader sees an identity transform and the given colour
+// NOTE: These are current attribute values rather than part of a vertex array, so they stay set
+//       for every draw until an InstanceBuffer draws
+void setSingleInstanceAttributes(const glm::vec4& color);
+
+#endif
@@ -1,6 +1,39 @@
+#include <string>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "SDL.h"
 
 #include "glwindow.h"
+#include "benchmark.h"
+#include "selftest.h"
+
+// Applies the --pacing option, if it was given
+static void setPacing(OpenGLWindow* window, const char* pacingName)
+{
+    if(!pacingName)
+    {
+        return;
+    }
+    if(strcmp(pacingName, "vsync") == 0)
+    {
+        window->setFramePacing(FRAME_PACING_VSYNC);
+    }
+    else if(strcmp(pacingName, "uncapped") == 0)
+    {
+        window->setFramePacing(FRAME_PACING_UNCAPPED);
+    }
+    else if(atof(pacingName) > 0.0)
+    {
+        window->setFramePacing(FRAME_PACING_CAPPED, atof(pacingName));
+    }
+    else
+    {
+        printf("Unknown frame pacing: %s\n", pacingName);
+    }
+}
 
 // In order to make cross-platform development and deployment easy, SDL implements its own main
 // function, and instead calls out to our code at this SDL_main, however on linux this is not
@@ -12,6 +45,137 @@ int main(int argc, char** argv)
 int SDL_main(int argc, char** argv)
 #endif
 {
+    // Benchmarks don't need a window, so they are handled before SDL is even initialized
+    if((argc >= 3) && (strcmp(argv[1], "--self-test") == 0))
+    {
+        return (runSelfTests(argv[2]) == 0) ? 0 : 1;
+    }
+    if((argc >= 3) && (strcmp(argv[1], "--bench-obj") == 0))
+    {
+        int iterations = (argc >= 4) ? atoi(argv[3]) : 3;
+        benchmarkOBJLoading(argv[2], (iterations > 0) ? iterations : 1);
+        return 0;
+    }
+    if((argc >= 3) && (strcmp(argv[1], "--bench-stream") == 0))
+    {
+        benchmarkStreamingLoad(argv[2], (argc >= 4) ? argv[3] : "stream");
+        return 0;
+    }
+    if((argc >= 3) && (strcmp(argv[1], "--bench-alloc") == 0))
+    {
+        benchmarkLoaderAllocations(argv[2]);
+        return 0;
+    }
+    if((argc >= 3) && (strcmp(argv[1], "--bench-bulk") == 0))
+    {
+        int fileCount = (argc >= 4) ? atoi(argv[3]) : 1000;
+        benchmarkBulkLoading(argv[2], (fileCount > 0) ? fileCount : 1000);
+        return 0;
+    }
+    if((argc >= 3) && (strcmp(argv[1], "--bench-vcache") == 0))
+    {
+        benchmarkVertexCache(argv[2]);
+        return 0;
+    }
+    if((argc >= 3) && (strcmp(argv[1], "--bench-layout") == 0))
+    {
+        benchmarkVertexLayouts(argv[2]);
+        return 0;
+    }
+    if((argc >= 3) && (strcmp(argv[1], "--bench-compress") == 0))
+    {
+        benchmarkVertexCompression(argv[2]);
+        return 0;
+    }
+    if((argc >= 2) && (strcmp(argv[1], "--bench-streambuffer") == 0))
+    {
+        int triangleCount = (argc >= 3) ? atoi(argv[2]) : 100000;
+        benchmarkStreamBuffer((triangleCount > 0) ? triangleCount : 100000);
+        return 0;
+    }
+    if((argc >= 2) && (strcmp(argv[1], "--bench-pacing") == 0))
+    {
+        int triangleCount = (argc >= 3) ? atoi(argv[2]) : 100000;
+        benchmarkFramePacing((triangleCount > 0) ? triangleCount : 100000);
+        return 0;
+    }
+    if((argc >= 2) && (strcmp(argv[1], "--bench-tangents") == 0))
+    {
+        int triangleCount = (argc >= 3) ? atoi(argv[2]) : 1000000;
+        benchmarkTangents((triangleCount > 0) ? triangleCount : 1000000);
+        return 0;
+    }
+    if((argc >= 2) && (strcmp(argv[1], "--bench-instancing") == 0))
+    {
+        int instanceCount = (argc >= 3) ? atoi(argv[2]) : 100000;
+        benchmarkInstancing((instanceCount > 0) ? instanceCount : 100000);
+        return 0;
+    }
+    if((argc >= 2) && (strcmp(argv[1], "--bench-scene") == 0))
+    {
+        int nodeCount = (argc >= 3) ? atoi(argv[2]) : 50000;
+        benchmarkSceneGraph((nodeCount > 0) ? nodeCount : 50000);
+        return 0;
+    }
+
+    // These options can be given before either of the modes below:
+    //   --profile <file> writes out the frame timings when the program exits (as a Chrome trace if
+    //       the file ends in .json, otherwise as CSV)
+    //   --pacing <vsync|uncapped|fps> sets how frames are paced, a number caps the frame rate
+    const char* profileFilename = 0;
+    const char* pacingName = 0;
+    while(argc >= 3)
+    {
+        if(strcmp(argv[1], "--profile") == 0)
+        {
+            profileFilename = argv[2];
+        }
+        else if(strcmp(argv[1], "--pacing") == 0)
+        {
+            pacingName = argv[2];
+        }
+        else
+        {
+            break;
+        }
+        argc -= 2;
+        argv += 2;
+    }
+
+    // Headless mode renders a fixed number of frames offscreen with no window (so it doesn't need
+    // SDL's video either), optionally writing each one out as <prefix>0000.ppm and so on. This is
+    // for testing on machines with no display, or no GPU (it works with Mesa's llvmpipe)
+    if((argc >= 2) && (strcmp(argv[1], "--headless") == 0))
+    {
+        int frameCount = (argc >= 3) ? atoi(argv[2]) : 100;
+        const char* framePrefix = (argc >= 4) ? argv[3] : 0;
+
+        OpenGLWindow window;
+        if(!window.initGL(true))
+        {
+            return 1;
+        }
+        setPacing(&window, pacingName);
+        window.finishLoading();
+        for(int frame=0; frame<frameCount; frame++)
+        {
+            window.waitForNextFrame();
+            window.render();
+            if(framePrefix)
+            {
+                char frameName[16];
+                snprintf(frameName, sizeof(frameName), "%04d.ppm", frame);
+                window.saveFrame(std::string(framePrefix) + frameName);
+            }
+        }
+        window.cleanup();
+        if(profileFilename)
+        {
+            window.writeProfile(profileFilename);
+        }
+        return 0;
+    }
+
     if(SDL_Init(SDL_INIT_VIDEO) != 0)
     {
         SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_INFORMATION, "Error", "Unable to initialize SDL", 0);
@@ -20,30 +184,27 @@ int SDL_main(int argc, char** argv)
 
     OpenGLWindow window;
     window.initGL();
+    setPacing(&window, pacingName);
 
     bool running = true;
     while(running)
     {
-        // Check for a quit event before passing to the GLWindow
-        SDL_Event e;
-        while(SDL_PollEvent(&e))
+        // NOTE: The wait comes before the input is read rather than after the frame, so that the
+        //       input is as fresh as possible when the frame is drawn
+        window.waitForNextFrame();
+
+        if(!window.pumpEvents())
         {
-            if(e.type == SDL_QUIT)
-            {
-                running = false;
-            }
-            else if(!window.handleEvent(e))
-            {
-                running = false;
-            }
+            running = false;
         }
         window.render();
-
-        // We sleep for 10ms here so as to prevent excessive CPU usage
-        SDL_Delay(10);
     }
 
     window.cleanup();
+    if(profileFilename)
+    {
+        window.writeProfile(profileFilename);
+    }
     SDL_Quit();
     return 0;
 }
@@ -0,0 +1,141 @@
+#include "mappedfile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+MappedFile::MappedFile()
+    : mappedData(0), mappedSize(0),
+#ifdef _WIN32
+      fileHandle(INVALID_HANDLE_VALUE), mappingHandle(0)
+#else
+      fileDescriptor(-1)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(string filename)
+{
+    close();
+
+#ifdef _WIN32
+    fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, 0,
+                             OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+    if(fileHandle == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if(!GetFileSizeEx(fileHandle, &fileSize))
+    {
+        close();
+        return false;
+    }
+    mappedSize = (size_t)fileSize.QuadPart;
+
+    // NOTE: Windows refuses to create a mapping of an empty file, but an empty file is still a
+    //       perfectly valid (if useless) thing to open
+    if(mappedSize > 0)
+    {
+        mappingHandle = CreateFileMappingA(fileHandle, 0, PAGE_READONLY, 0, 0, 0);
+        if(!mappingHandle)
+        {
+            close();
+            return false;
+        }
+        mappedData = (const char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+        if(!mappedData)
+        {
+            close();
+            return false;
+        }
+    }
+#else
+    fileDescriptor = ::open(filename.c_str(), O_RDONLY);
+    if(fileDescriptor < 0)
+    {
+        return false;
+    }
+
+    struct stat fileInfo;
+    if(fstat(fileDescriptor, &fileInfo) != 0)
+    {
+        close();
+        return false;
+    }
+    mappedSize = (size_t)fileInfo.st_size;
+
+    // NOTE: mmap fails on a zero-length mapping, so empty files just end up with a null data pointer
+    if(mappedSize > 0)
+    {
+        void* mapping = mmap(0, mappedSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+        if(mapping == MAP_FAILED)
+        {
+            close();
+            return false;
+        }
+        // We read the file front to back, so let the kernel know it can read ahead aggressively
+        madvise(mapping, mappedSize, MADV_SEQUENTIAL);
+        mappedData = (const char*)mapping;
+    }
+#endif
+
+    return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+    if(mappedData)
+    {
+        UnmapViewOfFile(mappedData);
+    }
+    if(mappingHandle)
+    {
+        CloseHandle(mappingHandle);
+        mappingHandle = 0;
+    }
+    if(fileHandle != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(fileHandle);
+        fileHandle = INVALID_HANDLE_VALUE;
+    }
+#else
+    if(mappedData)
+    {
+        munmap((void*)mappedData, mappedSize);
+    }
+    if(fileDescriptor >= 0)
+    {
+        ::close(fileDescriptor);
+        fileDescriptor = -1;
+    }
+#endif
+
+    mappedData = 0;
+    mappedSize = 0;
+}
+
+const char* MappedFile::data()
+{
+    return mappedData;
+}
+
+size_t MappedFile::size()
+{
+    return mappedSize;
+}
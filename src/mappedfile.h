@@ -0,0 +1,36 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <stddef.h>
+
+// Maps a whole file read-only into memory so that it can be parsed in place without copying it
+// through a stream. The mapping stays valid until close is called or the object is destroyed
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool open(std::string filename);
+    void close();
+
+    const char* data();
+    size_t size();
+
+private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    const char* mappedData;
+    size_t mappedSize;
+
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#else
+    int fileDescriptor;
+#endif
+};
+
+#endif
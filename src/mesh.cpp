@@ -0,0 +1,558 @@
+#include <iostream>
+#include <vector>
+
+#include <string.h>
+
+using namespace std;
+
+#include "mesh.h"
+#include "meshcache.h"
+
+// Gets the fully processed streams for an OBJ, either straight out of its mesh cache or by
+// loading, indexing and optimizing it (and then baking the cache for next time). The streams point
+// into whichever of cache and geometry they came from
+static bool loadOBJStreams(string filename, MeshCache& cache, GeometryData& geometry,
+                           VertexStreams* streams, int parserThreadCount = 0)
+{
+    const uint32_t cacheFlags = MESH_CACHE_INDEXED | MESH_CACHE_VERTEX_CACHE_OPTIMIZED;
+
+    // If we've loaded this file before then its baked copy can be used straight out of the mapped
+    // cache file, without any parsing at all
+    if(cache.open(filename, cacheFlags))
+    {
+        *streams = cache.streams();
+        return true;
+    }
+
+    geometry.setIndexed(true);
+    geometry.loadFromOBJFileParallel(filename, parserThreadCount);
+    if(geometry.vertexCount() == 0)
+    {
+        cout << "Mesh load error: No vertices were loaded from " << filename << endl;
+        return false;
+    }
+
+    VertexCacheStats before;
+    VertexCacheStats after;
+    geometry.optimizeVertexCache(&before, &after);
+    cout << "Loaded " << filename << ": " << geometry.vertexCount() << " vertices, "
+         << geometry.indexCount()/3 << " triangles, ACMR " << before.acmr << " -> " << after.acmr
+         << endl;
+
+    MeshCache::write(filename, geometry, cacheFlags);
+
+    *streams = geometry.streams();
+    return true;
+}
+
+PackedMesh::PackedMesh()
+    : indexType(GL_UNSIGNED_INT), vertexCount(0), drawCount(0)
+{
+    layout = makeInterleavedVertexLayout(VERTEX_ALL_ATTRIBUTES_BIT);
+}
+
+bool PackedMesh::loadFromOBJFile(string filename, const VertexLayout& requestedLayout,
+                                 int parserThreadCount)
+{
+    MeshCache cache;
+    GeometryData geometry;
+    VertexStreams streams;
+    if(!loadOBJStreams(filename, cache, geometry, &streams, parserThreadCount))
+    {
+        return false;
+    }
+    pack(streams, requestedLayout);
+    return drawCount > 0;
+}
+
+void PackedMesh::pack(const VertexStreams& streams, const VertexLayout& requestedLayout)
+{
+    vertexCount = streams.vertexCount;
+    drawCount = streams.indices ? streams.indexCount : vertexCount;
+
+    layout = restrictVertexLayout(requestedLayout, streams);
+    packVertexLayout(layout, streams, vertexData);
+
+    // NOTE: The same index narrowing as Mesh::upload
+    indexData.clear();
+    if(!streams.indices)
+    {
+        return;
+    }
+    if(streams.indexSize == sizeof(unsigned short))
+    {
+        indexType = GL_UNSIGNED_SHORT;
+        const unsigned char* indices = (const unsigned char*)streams.indices;
+        indexData.assign(indices, indices + drawCount * sizeof(unsigned short));
+    }
+    else if(vertexCount <= 65536)
+    {
+        indexType = GL_UNSIGNED_SHORT;
+        indexData.resize(drawCount * sizeof(unsigned short));
+        const unsigned int* indices = (const unsigned int*)streams.indices;
+        unsigned short* shortIndices = (unsigned short*)&indexData[0];
+        for(int i=0; i<drawCount; i++)
+        {
+            shortIndices[i] = (unsigned short)indices[i];
+        }
+    }
+    else
+    {
+        indexType = GL_UNSIGNED_INT;
+        const unsigned char* indices = (const unsigned char*)streams.indices;
+        indexData.assign(indices, indices + drawCount * sizeof(unsigned int));
+    }
+}
+
+size_t PackedMesh::size() const
+{
+    size_t total = indexData.size();
+    for(int buffer=0; buffer<layout.bufferCount; buffer++)
+    {
+        total += vertexData[buffer].size();
+    }
+    return total;
+}
+
+Mesh::Mesh()
+    : vao(0), indexBuffer(0), indexType(GL_UNSIGNED_INT), drawCount(0), vertexTotal(0),
+      uploadSize(0), uploadProgress(0), pendingDrawCount(0)
+{
+    requestedLayout = makeInterleavedVertexLayout(VERTEX_ALL_ATTRIBUTES_BIT);
+    layout = requestedLayout;
+    for(int buffer=0; buffer<VERTEX_ATTRIBUTE_COUNT; buffer++)
+    {
+        vertexBuffers[buffer] = 0;
+    }
+}
+
+void Mesh::setVertexLayout(const VertexLayout& layout)
+{
+    requestedLayout = layout;
+}
+
+const VertexLayout& Mesh::requestedVertexLayout()
+{
+    return requestedLayout;
+}
+
+bool Mesh::loadFromOBJFile(string filename)
+{
+    MeshCache cache;
+    GeometryData geometry;
+    VertexStreams streams;
+    if(!loadOBJStreams(filename, cache, geometry, &streams))
+    {
+        return false;
+    }
+    upload(streams);
+    return true;
+}
+
+// Appends each streamed batch to the end of the vertex buffers, so the CPU only ever holds one
+// packed batch. When a buffer fills up it's replaced with one twice the size, copying the data
+// across on the GPU
+// NOTE: The layout is fitted to the first batch, so attributes that only show up later are dropped
+class BufferStreamSink : public TriangleSink
+{
+public:
+    BufferStreamSink(const VertexLayout& requestedLayout)
+        : requestedLayout(requestedLayout), vertexCount(0), started(false)
+    {
+        decompressVertexAttribute(&this->requestedLayout, VERTEX_POSITION);
+        for(int buffer=0; buffer<VERTEX_ATTRIBUTE_COUNT; buffer++)
+        {
+            buffers[buffer] = 0;
+            capacities[buffer] = 0;
+        }
+    }
+
+    void addTriangles(const VertexStreams& streams)
+    {
+        if(!started)
+        {
+            layout = restrictVertexLayout(requestedLayout, streams);
+            started = true;
+        }
+
+        packVertexLayout(layout, streams, packed);
+        for(int buffer=0; buffer<layout.bufferCount; buffer++)
+        {
+            size_t used = layout.strides[buffer] * vertexCount;
+            size_t needed = used + packed[buffer].size();
+            if(needed > capacities[buffer])
+            {
+                resize(buffer, used, (needed > 2*capacities[buffer]) ? needed : 2*capacities[buffer]);
+            }
+            glBindBuffer(GL_ARRAY_BUFFER, buffers[buffer]);
+            glBufferSubData(GL_ARRAY_BUFFER, used, packed[buffer].size(), &packed[buffer][0]);
+        }
+        vertexCount += streams.vertexCount;
+    }
+
+    // Trims the buffers down to the data actually in them
+    void finish()
+    {
+        for(int buffer=0; started && (buffer<layout.bufferCount); buffer++)
+        {
+            size_t used = layout.strides[buffer] * vertexCount;
+            if(capacities[buffer] > used)
+            {
+                resize(buffer, used, used);
+            }
+        }
+    }
+
+    VertexLayout requestedLayout;
+    VertexLayout layout;
+    GLuint buffers[VERTEX_ATTRIBUTE_COUNT];
+    size_t capacities[VERTEX_ATTRIBUTE_COUNT];
+    int vertexCount;
+    bool started;
+
+private:
+    void resize(int buffer, size_t used, size_t capacity)
+    {
+        GLuint resized = 0;
+        glGenBuffers(1, &resized);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, resized);
+        glBufferData(GL_COPY_WRITE_BUFFER, capacity, 0, GL_STATIC_DRAW);
+        if(buffers[buffer])
+        {
+            glBindBuffer(GL_COPY_READ_BUFFER, buffers[buffer]);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used);
+            glDeleteBuffers(1, &buffers[buffer]);
+        }
+        buffers[buffer] = resized;
+        capacities[buffer] = capacity;
+    }
+
+    vector<unsigned char> packed[VERTEX_ATTRIBUTE_COUNT];
+};
+
+bool Mesh::loadFromOBJFileStreaming(string filename)
+{
+    cleanup();
+
+    BufferStreamSink sink(requestedLayout);
+    if(!loadOBJFileStreaming(filename, &sink))
+    {
+        return false;
+    }
+    sink.finish();
+    if(sink.vertexCount == 0)
+    {
+        cout << "Mesh load error: No vertices were loaded from " << filename << endl;
+        if(sink.started)
+        {
+            glDeleteBuffers(sink.layout.bufferCount, sink.buffers);
+        }
+        return false;
+    }
+
+    layout = sink.layout;
+    for(int buffer=0; buffer<layout.bufferCount; buffer++)
+    {
+        vertexBuffers[buffer] = sink.buffers[buffer];
+    }
+    vertexTotal = sink.vertexCount;
+    drawCount = vertexTotal;
+    uploadSize = vertexLayoutSize(layout, vertexTotal);
+
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    bindVertexLayout(layout, vertexBuffers);
+    glBindVertexArray(0);
+
+    cout << "Streamed " << filename << ": " << vertexTotal/3 << " triangles" << endl;
+    return true;
+}
+
+void Mesh::upload(GeometryData& geometry)
+{
+    upload(geometry.streams());
+}
+
+void Mesh::upload(const VertexStreams& streams)
+{
+    // NOTE: Re-uploading into an existing mesh releases the old objects first so that we never
+    //       leak buffers if a mesh gets reloaded
+    cleanup();
+
+    vertexTotal = streams.vertexCount;
+    drawCount = streams.indices ? streams.indexCount : vertexTotal;
+    if(drawCount == 0)
+    {
+        return;
+    }
+
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    // Drop anything the layout asks for that this particular geometry doesn't have
+    layout = restrictVertexLayout(requestedLayout, streams);
+    glGenBuffers(layout.bufferCount, vertexBuffers);
+    if(layout.interleaved || !isUncompressedVertexLayout(layout))
+    {
+        vector<unsigned char> packed[VERTEX_ATTRIBUTE_COUNT];
+        packVertexLayout(layout, streams, packed);
+        for(int buffer=0; buffer<layout.bufferCount; buffer++)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, vertexBuffers[buffer]);
+            glBufferData(GL_ARRAY_BUFFER, packed[buffer].size(),
+                         packed[buffer].empty() ? 0 : &packed[buffer][0], GL_STATIC_DRAW);
+        }
+    }
+    else
+    {
+        // NOTE: The uncompressed separate layout is exactly how the streams are already stored, so
+        //       they can be uploaded directly without packing them into a temporary copy first
+        const float* sources[VERTEX_ATTRIBUTE_COUNT] = {
+            streams.positions, streams.textureCoords, streams.normals,
+            streams.tangents, streams.bitangents
+        };
+        for(int attribute=0; attribute<VERTEX_ATTRIBUTE_COUNT; attribute++)
+        {
+            const VertexAttributeFormat& format = layout.attributes[attribute];
+            if(format.enabled)
+            {
+                glBindBuffer(GL_ARRAY_BUFFER, vertexBuffers[format.buffer]);
+                glBufferData(GL_ARRAY_BUFFER, format.size * vertexTotal, sources[attribute],
+                             GL_STATIC_DRAW);
+            }
+        }
+    }
+    uploadSize = vertexLayoutSize(layout, vertexTotal);
+    bindVertexLayout(layout, vertexBuffers);
+
+    if(streams.indices)
+    {
+        // The element buffer binding is part of the VAO state, so it has to be bound while the VAO
+        // is. Meshes with few enough vertices get 16-bit indices to halve the index buffer size
+        glGenBuffers(1, &indexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+        if(streams.indexSize == sizeof(unsigned short))
+        {
+            indexType = GL_UNSIGNED_SHORT;
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, drawCount * sizeof(unsigned short),
+                         streams.indices, GL_STATIC_DRAW);
+            uploadSize += drawCount * sizeof(unsigned short);
+        }
+        else if(vertexTotal <= 65536)
+        {
+            const unsigned int* indices = (const unsigned int*)streams.indices;
+            vector<unsigned short> shortIndices(indices, indices + drawCount);
+            indexType = GL_UNSIGNED_SHORT;
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, drawCount * sizeof(unsigned short),
+                         &shortIndices[0], GL_STATIC_DRAW);
+            uploadSize += drawCount * sizeof(unsigned short);
+        }
+        else
+        {
+            indexType = GL_UNSIGNED_INT;
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, drawCount * sizeof(unsigned int),
+                         streams.indices, GL_STATIC_DRAW);
+            uploadSize += drawCount * sizeof(unsigned int);
+        }
+    }
+
+    glBindVertexArray(0);
+}
+
+void Mesh::beginUpload(const PackedMesh& packed)
+{
+    cleanup();
+
+    layout = packed.layout;
+    vertexTotal = packed.vertexCount;
+    uploadSize = packed.size();
+    uploadProgress = 0;
+    pendingDrawCount = packed.drawCount;
+    if(pendingDrawCount == 0)
+    {
+        return;
+    }
+
+    // NOTE: The buffers are only allocated here, their contents are filled in by continueUpload
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glGenBuffers(layout.bufferCount, vertexBuffers);
+    for(int buffer=0; buffer<layout.bufferCount; buffer++)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffers[buffer]);
+        glBufferData(GL_ARRAY_BUFFER, packed.vertexData[buffer].size(), 0, GL_STATIC_DRAW);
+    }
+    bindVertexLayout(layout, vertexBuffers);
+    if(!packed.indexData.empty())
+    {
+        glGenBuffers(1, &indexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, packed.indexData.size(), 0, GL_STATIC_DRAW);
+        indexType = packed.indexType;
+    }
+    glBindVertexArray(0);
+}
+
+bool Mesh::continueUpload(const PackedMesh& packed, size_t* budget, StreamBuffer* staging)
+{
+    if(pendingDrawCount == 0)
+    {
+        return true;
+    }
+    size_t stagingLeft = staging ? staging->regionSize() : 0;
+
+    // The vertex buffers and then the index buffer are filled in order, as if they were one long
+    // buffer that uploadProgress is the position in
+    // NOTE: GL_COPY_WRITE_BUFFER is used for every buffer since it isn't used for anything else, so
+    //       this doesn't disturb the array buffer binding or need the VAO bound for the index buffer
+    size_t bufferStart = 0;
+    for(int buffer=0; (buffer<=layout.bufferCount) && (*budget > 0) && (!staging || (stagingLeft > 0));
+        buffer++)
+    {
+        bool isIndexBuffer = (buffer == layout.bufferCount);
+        const vector<unsigned char>& data = isIndexBuffer ? packed.indexData : packed.vertexData[buffer];
+        size_t bufferEnd = bufferStart + data.size();
+        if(uploadProgress < bufferEnd)
+        {
+            size_t offset = uploadProgress - bufferStart;
+            size_t count = data.size() - offset;
+            if(count > *budget)
+            {
+                count = *budget;
+            }
+            GLuint destination = isIndexBuffer ? indexBuffer : vertexBuffers[buffer];
+            if(staging)
+            {
+                count = (count > stagingLeft) ? stagingLeft : count;
+                size_t stagingOffset = 0;
+                void* stagingData = staging->beginWrite(count, 16, &stagingOffset);
+                if(!stagingData)
+                {
+                    break;
+                }
+                memcpy(stagingData, &data[offset], count);
+                staging->endWrite();
+                stagingLeft -= count;
+
+                glBindBuffer(GL_COPY_READ_BUFFER, staging->buffer());
+                glBindBuffer(GL_COPY_WRITE_BUFFER, destination);
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, stagingOffset, offset, count);
+            }
+            else
+            {
+                glBindBuffer(GL_COPY_WRITE_BUFFER, destination);
+                glBufferSubData(GL_COPY_WRITE_BUFFER, offset, count, &data[offset]);
+            }
+            uploadProgress += count;
+            *budget -= count;
+        }
+        bufferStart = bufferEnd;
+    }
+
+    if(uploadProgress < uploadSize)
+    {
+        return false;
+    }
+    drawCount = pendingDrawCount;
+    pendingDrawCount = 0;
+    return true;
+}
+
+void Mesh::draw()
+{
+    if(!isLoaded())
+    {
+        return;
+    }
+
+    glBindVertexArray(vao);
+    if(indexBuffer)
+    {
+        glDrawElements(GL_TRIANGLES, drawCount, indexType, (void*)0);
+    }
+    else
+    {
+        glDrawArrays(GL_TRIANGLES, 0, drawCount);
+    }
+}
+
+bool Mesh::bind()
+{
+    if(!isLoaded())
+    {
+        return false;
+    }
+
+    glBindVertexArray(vao);
+    return true;
+}
+
+void Mesh::drawInstanced(int instanceCount)
+{
+    if(!isLoaded() || (instanceCount <= 0))
+    {
+        return;
+    }
+
+    glBindVertexArray(vao);
+    if(indexBuffer)
+    {
+        glDrawElementsInstanced(GL_TRIANGLES, drawCount, indexType, (void*)0, instanceCount);
+    }
+    else
+    {
+        glDrawArraysInstanced(GL_TRIANGLES, 0, drawCount, instanceCount);
+    }
+}
+
+void Mesh::cleanup()
+{
+    if(vertexBuffers[0])
+    {
+        glDeleteBuffers(layout.bufferCount, vertexBuffers);
+        for(int buffer=0; buffer<VERTEX_ATTRIBUTE_COUNT; buffer++)
+        {
+            vertexBuffers[buffer] = 0;
+        }
+    }
+    if(indexBuffer)
+    {
+        glDeleteBuffers(1, &indexBuffer);
+        indexBuffer = 0;
+    }
+    if(vao)
+    {
+        glDeleteVertexArrays(1, &vao);
+        vao = 0;
+    }
+    drawCount = 0;
+    vertexTotal = 0;
+    uploadSize = 0;
+    uploadProgress = 0;
+    pendingDrawCount = 0;
+}
+
+bool Mesh::isLoaded()
+{
+    return (vao != 0) && (drawCount > 0);
+}
+
+int Mesh::vertexCount()
+{
+    return vertexTotal;
+}
+
+const VertexLayout& Mesh::vertexLayout()
+{
+    return layout;
+}
+
+size_t Mesh::uploadedSize()
+{
+    return uploadSize;
+}
+
+int Mesh::indexCount()
+{
+    return (indexBuffer != 0) ? drawCount : 0;
+}
@@ -0,0 +1,109 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "geometry.h"
+#include "streambuffer.h"
+#include "vertexlayout.h"
+
+// The CPU side of uploading a mesh: the geometry packed into its vertex layout, with the indices
+// narrowed to 16 bits where possible, ready to be copied into buffers as-is. Building one doesn't
+// touch GL at all, so it can be done on a worker thread (see AssetLoader) and handed over to
+// Mesh::beginUpload on the GL thread
+class PackedMesh
+{
+public:
+    PackedMesh();
+
+    // Loads and processes the OBJ exactly as Mesh::loadFromOBJFile does (including using and baking
+    // the mesh cache), then packs it. Returns false if nothing could be loaded. parserThreadCount is
+    // passed on to GeometryData::loadFromOBJFileParallel, so callers that are already running on a
+    // pool of threads can keep the parser from starting a thread per core of its own
+    bool loadFromOBJFile(std::string filename, const VertexLayout& requestedLayout,
+                         int parserThreadCount = 0);
+    void pack(const VertexStreams& streams, const VertexLayout& requestedLayout);
+
+    // The total number of bytes of vertex and index data
+    size_t size() const;
+
+    VertexLayout layout;
+    std::vector<unsigned char> vertexData[VERTEX_ATTRIBUTE_COUNT];
+    std::vector<unsigned char> indexData; // Empty for un-indexed meshes
+    GLenum indexType;
+    int vertexCount;
+    int drawCount;
+};
+
+// A Mesh is the GPU-resident copy of a GeometryData. The geometry is parsed and uploaded once
+// (via loadFromOBJFile or upload) and the vertex array and buffer objects are then owned by the
+// mesh until cleanup is called, so drawing it each frame is just a bind and a draw call.
+// loadFromOBJFile also bakes a binary cache of the processed geometry (see meshcache.h) which is
+// used instead of the OBJ file on later runs.
+// By default every attribute the geometry has is uploaded into a single interleaved buffer, a
+// different layout can be chosen with setVertexLayout before uploading
+class Mesh
+{
+public:
+    Mesh();
+
+    void setVertexLayout(const VertexLayout& layout);
+    const VertexLayout& requestedVertexLayout();
+    // The layout that was actually uploaded, which includes the position dequantization transform
+    // that has to be passed on to the shader
+    const VertexLayout& vertexLayout();
+
+    bool loadFromOBJFile(std::string filename);
+    // Streams the OBJ straight into the vertex buffers a batch at a time (see loadOBJFileStreaming),
+    // for meshes too big to hold in memory. This skips the mesh cache and the indexing and vertex
+    // cache optimization that loadFromOBJFile does, since those need the whole mesh. Positions are
+    // never quantized, since the bounds aren't known until the whole file has been read
+    bool loadFromOBJFileStreaming(std::string filename);
+    void upload(GeometryData& geometry);
+    void upload(const VertexStreams& streams);
+    // Uploads a PackedMesh over as many calls as it takes, so that a big mesh can be spread over
+    // several frames. beginUpload creates the (empty) buffers, then each call to continueUpload
+    // copies up to *budget more bytes into them and takes what it copied off *budget. It returns
+    // true once everything has been copied, and the mesh doesn't draw anything until then. The
+    // PackedMesh has to stay the same in between. If staging is given the data goes through it and
+    // is copied into place on the GPU, rather than through glBufferSubData (which may have to wait
+    // for the GPU, or make its own copy). Each call copies at most one staging region
+    void beginUpload(const PackedMesh& packed);
+    bool continueUpload(const PackedMesh& packed, size_t* budget, StreamBuffer* staging = 0);
+    void draw();
+    // Binds the mesh's vertex array and returns true if the mesh is loaded, so that attributes
+    // that vary per instance can be added to it before drawInstanced (see InstanceBuffer)
+    bool bind();
+    // Draws instanceCount copies of the mesh with one draw call
+    void drawInstanced(int instanceCount);
+    void cleanup();
+
+    bool isLoaded();
+    int vertexCount();
+    int indexCount();
+    // The number of bytes of vertex and index data that were uploaded
+    size_t uploadedSize();
+
+private:
+    VertexLayout requestedLayout;
+    VertexLayout layout;
+
+    GLuint vao;
+    GLuint vertexBuffers[VERTEX_ATTRIBUTE_COUNT];
+    GLuint indexBuffer;
+    GLenum indexType;
+
+    // NOTE: drawCount is the number of indices for indexed meshes and the number of vertices otherwise
+    int drawCount;
+    int vertexTotal;
+    size_t uploadSize;
+    // How many bytes of a PackedMesh have been copied so far, and the draw count to switch to once
+    // it's all there
+    size_t uploadProgress;
+    int pendingDrawCount;
+};
+
+#endif
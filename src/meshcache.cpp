@@ -0,0 +1,238 @@
+#include <iostream>
+#include <vector>
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+#include "meshcache.h"
+
+static const char MESH_CACHE_MAGIC[4] = { 'M', 'S', 'H', 'C' };
+static const uint64_t MESH_CACHE_ALIGNMENT = 64;
+
+// The floats per vertex of each vertex stream (the index stream is sized by indexSize instead)
+static const int MESH_CACHE_STREAM_COMPONENTS[MESH_CACHE_STREAM_COUNT] = { 3, 2, 3, 3, 3, 0 };
+
+static bool sourceFileInfo(string sourceFilename, uint64_t* size, int64_t* modifiedTime)
+{
+    struct stat fileInfo;
+    if(stat(sourceFilename.c_str(), &fileInfo) != 0)
+    {
+        return false;
+    }
+    *size = (uint64_t)fileInfo.st_size;
+    *modifiedTime = (int64_t)fileInfo.st_mtime;
+    return true;
+}
+
+static uint64_t alignOffset(uint64_t offset)
+{
+    return (offset + MESH_CACHE_ALIGNMENT - 1) & ~(MESH_CACHE_ALIGNMENT - 1);
+}
+
+MeshCache::MeshCache()
+    : header(0)
+{
+}
+
+string MeshCache::cachePath(string sourceFilename)
+{
+    return sourceFilename + ".meshcache";
+}
+
+bool MeshCache::open(string sourceFilename, uint32_t flags)
+{
+    close();
+
+    uint64_t sourceSize;
+    int64_t sourceModifiedTime;
+    if(!sourceFileInfo(sourceFilename, &sourceSize, &sourceModifiedTime))
+    {
+        return false;
+    }
+
+    if(!file.open(cachePath(sourceFilename)))
+    {
+        return false;
+    }
+
+    // NOTE: Anything that doesn't look exactly right is treated as a cache miss (and will get
+    //       overwritten by the caller), rather than trying to make sense of a partial file
+    const MeshCacheHeader* candidate = (const MeshCacheHeader*)file.data();
+    bool valid = (file.size() >= sizeof(MeshCacheHeader)) &&
+                 (memcmp(candidate->magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) == 0) &&
+                 (candidate->version == MESH_CACHE_VERSION) &&
+                 (candidate->flags == flags) &&
+                 (candidate->sourceSize == sourceSize) &&
+                 (candidate->sourceModifiedTime == sourceModifiedTime) &&
+                 ((candidate->indexSize == 2) || (candidate->indexSize == 4));
+    for(int stream=0; valid && (stream<MESH_CACHE_STREAM_COUNT); stream++)
+    {
+        uint64_t offset = candidate->streamOffsets[stream];
+        uint64_t size = candidate->streamSizes[stream];
+        if(offset != 0)
+        {
+            valid = (offset % MESH_CACHE_ALIGNMENT == 0) &&
+                    (offset <= file.size()) && (size <= (file.size() - offset));
+        }
+    }
+    // NOTE: Every stream that's there has to be exactly the size the counts say, otherwise the
+    //       packing and upload code would read past the end of the short ones
+    for(int stream=0; valid && (stream<MESH_CACHE_STREAM_COUNT); stream++)
+    {
+        if(candidate->streamOffsets[stream] == 0)
+        {
+            continue;
+        }
+        uint64_t expectedSize = (uint64_t)candidate->vertexCount * MESH_CACHE_STREAM_COMPONENTS[stream] *
+                                sizeof(float);
+        if(stream == MESH_CACHE_INDICES)
+        {
+            expectedSize = (uint64_t)candidate->indexCount * candidate->indexSize;
+        }
+        valid = (candidate->streamSizes[stream] == expectedSize);
+    }
+    if(valid)
+    {
+        // 16-bit indices are only written when every vertex can be reached with them
+        valid = (candidate->streamOffsets[MESH_CACHE_POSITIONS] != 0) &&
+                (candidate->streamSizes[MESH_CACHE_INDICES] ==
+                 (uint64_t)candidate->indexCount * candidate->indexSize) &&
+                ((candidate->indexSize != 2) || (candidate->vertexCount <= 65536));
+    }
+
+    if(!valid)
+    {
+        close();
+        return false;
+    }
+
+    header = candidate;
+    return true;
+}
+
+void MeshCache::close()
+{
+    header = 0;
+    file.close();
+}
+
+VertexStreams MeshCache::streams()
+{
+    VertexStreams result = {};
+    if(!header)
+    {
+        return result;
+    }
+
+    const void* streamData[MESH_CACHE_STREAM_COUNT];
+    for(int stream=0; stream<MESH_CACHE_STREAM_COUNT; stream++)
+    {
+        uint64_t offset = header->streamOffsets[stream];
+        streamData[stream] = (offset != 0) ? (const void*)(file.data() + offset) : 0;
+    }
+
+    result.vertexCount = header->vertexCount;
+    result.indexCount = header->indexCount;
+    result.indexSize = header->indexSize;
+    result.positions = (const float*)streamData[MESH_CACHE_POSITIONS];
+    result.textureCoords = (const float*)streamData[MESH_CACHE_TEXTURE_COORDS];
+    result.normals = (const float*)streamData[MESH_CACHE_NORMALS];
+    result.tangents = (const float*)streamData[MESH_CACHE_TANGENTS];
+    result.bitangents = (const float*)streamData[MESH_CACHE_BITANGENTS];
+    result.indices = streamData[MESH_CACHE_INDICES];
+    return result;
+}
+
+bool MeshCache::write(string sourceFilename, GeometryData& geometry, uint32_t flags)
+{
+    MeshCacheHeader header = {};
+    memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+    header.version = MESH_CACHE_VERSION;
+    header.flags = flags;
+    if(!sourceFileInfo(sourceFilename, &header.sourceSize, &header.sourceModifiedTime))
+    {
+        return false;
+    }
+
+    VertexStreams streams = geometry.streams();
+    header.vertexCount = streams.vertexCount;
+    header.indexCount = streams.indexCount;
+
+    vector<unsigned short> shortIndices;
+    const void* indexData = streams.indices;
+    header.indexSize = sizeof(unsigned int);
+    if(streams.indices && (streams.vertexCount <= 65536))
+    {
+        const unsigned int* indices = (const unsigned int*)streams.indices;
+        shortIndices.assign(indices, indices + streams.indexCount);
+        indexData = &shortIndices[0];
+        header.indexSize = sizeof(unsigned short);
+    }
+
+    const void* streamData[MESH_CACHE_STREAM_COUNT] = {
+        streams.positions, streams.textureCoords, streams.normals,
+        streams.tangents, streams.bitangents, indexData
+    };
+    uint64_t offset = alignOffset(sizeof(MeshCacheHeader));
+    for(int stream=0; stream<MESH_CACHE_STREAM_COUNT; stream++)
+    {
+        if(!streamData[stream])
+        {
+            continue;
+        }
+        header.streamOffsets[stream] = offset;
+        if(stream == MESH_CACHE_INDICES)
+        {
+            header.streamSizes[stream] = (uint64_t)header.indexCount * header.indexSize;
+        }
+        else
+        {
+            header.streamSizes[stream] = (uint64_t)header.vertexCount * MESH_CACHE_STREAM_COMPONENTS[stream] *
+                                         sizeof(float);
+        }
+        offset = alignOffset(offset + header.streamSizes[stream]);
+    }
+
+    // NOTE: We write to a temporary file and rename it into place once it's complete, so a crash
+    //       (or another instance reading the cache) never sees a half written file
+    string finalPath = cachePath(sourceFilename);
+    string tempPath = finalPath + ".tmp";
+    FILE* cacheFile = fopen(tempPath.c_str(), "wb");
+    if(!cacheFile)
+    {
+        cout << "Unable to write mesh cache: " << tempPath << endl;
+        return false;
+    }
+
+    static const char padding[MESH_CACHE_ALIGNMENT] = {};
+    bool success = (fwrite(&header, sizeof(header), 1, cacheFile) == 1);
+    uint64_t written = sizeof(header);
+    for(int stream=0; success && (stream<MESH_CACHE_STREAM_COUNT); stream++)
+    {
+        if(!streamData[stream])
+        {
+            continue;
+        }
+        uint64_t paddingSize = header.streamOffsets[stream] - written;
+        success = (fwrite(padding, 1, paddingSize, cacheFile) == paddingSize) &&
+                  (fwrite(streamData[stream], 1, header.streamSizes[stream], cacheFile) ==
+                   header.streamSizes[stream]);
+        written = header.streamOffsets[stream] + header.streamSizes[stream];
+    }
+    success = (fclose(cacheFile) == 0) && success;
+
+    if(success)
+    {
+        remove(finalPath.c_str()); // rename won't replace an existing file on Windows
+        success = (rename(tempPath.c_str(), finalPath.c_str()) == 0);
+    }
+    if(!success)
+    {
+        cout << "Unable to write mesh cache: " << finalPath << endl;
+        remove(tempPath.c_str());
+    }
+    return success;
+}
@@ -0,0 +1,82 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <string>
+#include <stdint.h>
+
+#include "geometry.h"
+#include "mappedfile.h"
+
+// Pre-baked binary copies of loaded meshes, so that we only have to parse an OBJ file the first
+// time it's loaded. The cache for "model.obj" lives next to it in "model.obj.meshcache" and is only
+// used if the source file still has the same size and modification time, and the cache was baked
+// with the same options (see MeshCacheFlags).
+//
+// File layout (all little endian, as written by the machine that baked it):
+//     MeshCacheHeader
+//     Each stream that is present, in MeshCacheStream order, starting on a 64 byte boundary
+//
+// A cache hit just maps the file and hands out pointers into the mapping, so the data goes
+// straight from the page cache to glBufferData without being copied or converted
+
+// NOTE: This also needs bumping whenever the loader output changes (e.g. how tangents are built),
+//       not just when the file format does, since a cache hit skips the loader entirely
+static const uint32_t MESH_CACHE_VERSION = 3;
+
+enum MeshCacheFlags
+{
+    MESH_CACHE_INDEXED = 1,
+    MESH_CACHE_VERTEX_CACHE_OPTIMIZED = 2
+};
+
+enum MeshCacheStream
+{
+    MESH_CACHE_POSITIONS,
+    MESH_CACHE_TEXTURE_COORDS,
+    MESH_CACHE_NORMALS,
+    MESH_CACHE_TANGENTS,
+    MESH_CACHE_BITANGENTS,
+    MESH_CACHE_INDICES,
+    MESH_CACHE_STREAM_COUNT
+};
+
+struct MeshCacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t flags;
+    uint32_t indexSize;
+    uint64_t sourceSize;
+    int64_t sourceModifiedTime;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    // NOTE: An offset of 0 means the stream isn't present
+    uint64_t streamOffsets[MESH_CACHE_STREAM_COUNT];
+    uint64_t streamSizes[MESH_CACHE_STREAM_COUNT];
+};
+
+class MeshCache
+{
+public:
+    MeshCache();
+
+    static std::string cachePath(std::string sourceFilename);
+
+    // Maps the cache for the given source file, returns false if there is no valid, up to date
+    // cache for it that was baked with exactly the given flags
+    bool open(std::string sourceFilename, uint32_t flags);
+    void close();
+
+    // The returned pointers are only valid until the cache is closed
+    VertexStreams streams();
+
+    // Bakes the geometry into a cache file for the given source file. Indices are narrowed to 16
+    // bits when possible so that they can be uploaded as-is
+    static bool write(std::string sourceFilename, GeometryData& geometry, uint32_t flags);
+
+private:
+    MappedFile file;
+    const MeshCacheHeader* header;
+};
+
+#endif
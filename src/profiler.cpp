@@ -0,0 +1,467 @@
+#include <algorithm>
+#include <iostream>
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+using namespace std;
+
+#include "profiler.h"
+
+Profiler::Profiler(int historySize)
+    : frameNumber(0), completedFrames(0), frame(0), activePass(-1), gpuTiming(false),
+      missedQueries(0), frequency(SDL_GetPerformanceFrequency()), firstFrameStart(0), reportStart(0)
+{
+    // NOTE: The frames have to be held at least until their queries are read
+    if(historySize <= PROFILER_QUERY_FRAMES)
+    {
+        historySize = PROFILER_QUERY_FRAMES + 1;
+    }
+    history.resize(historySize);
+
+    for(int i=0; i<PROFILER_QUERY_FRAMES; i++)
+    {
+        queryFrames[i] = 0;
+        queriesUsed[i] = 0;
+    }
+}
+
+void Profiler::create()
+{
+    gpuTiming = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+    if(!gpuTiming)
+    {
+        cout << "Profiler: Timer queries aren't supported, only CPU times will be recorded" << endl;
+    }
+}
+
+void Profiler::destroy()
+{
+    // Nothing else will read the last frames' queries, so wait for them now while we still can
+    if(gpuTiming)
+    {
+        glFinish();
+        for(int i=0; i<PROFILER_QUERY_FRAMES; i++)
+        {
+            readQueries(i);
+        }
+    }
+
+    for(int i=0; i<PROFILER_QUERY_FRAMES; i++)
+    {
+        if(!queries[i].empty())
+        {
+            glDeleteQueries(queries[i].size(), &queries[i][0]);
+            queries[i].clear();
+        }
+        queryFrames[i] = 0;
+        queriesUsed[i] = 0;
+    }
+    gpuTiming = false;
+}
+
+void Profiler::beginFrame()
+{
+    frameNumber++;
+    frame = &history[(frameNumber - 1) % history.size()];
+    frame->number = frameNumber;
+    frame->start = SDL_GetPerformanceCounter();
+    frame->end = frame->start;
+    frame->passes.clear(); // Keeps its capacity, so after the first few frames this doesn't allocate
+    if(firstFrameStart == 0)
+    {
+        firstFrameStart = frame->start;
+        reportStart = frame->start;
+    }
+
+    // This slot's queries were issued PROFILER_QUERY_FRAMES frames ago, so read them before reusing
+    int slot = frameNumber % PROFILER_QUERY_FRAMES;
+    readQueries(slot);
+    queryFrames[slot] = frameNumber;
+    queriesUsed[slot] = 0;
+}
+
+void Profiler::endFrame()
+{
+    if(!frame)
+    {
+        return;
+    }
+    if(activePass >= 0)
+    {
+        endPass();
+    }
+    Uint64 frameEnd = SDL_GetPerformanceCounter();
+    frame->end = frameEnd;
+    frame = 0;
+    completedFrames++;
+
+    // NOTE: We only report about once a second so that the printing doesn't show up in the timings
+    if((frameEnd - reportStart) >= frequency)
+    {
+        printReport();
+        reportStart = frameEnd;
+    }
+}
+
+void Profiler::beginPass(const char* name)
+{
+    if(!frame)
+    {
+        return;
+    }
+    if(activePass >= 0)
+    {
+        endPass();
+    }
+
+    PassSample sample;
+    sample.pass = findPass(name);
+    sample.gpuMs = -1.0;
+    activePass = frame->passes.size();
+
+    // Every pass gets a query when they're supported, so query i always belongs to pass i
+    if(gpuTiming)
+    {
+        int slot = frameNumber % PROFILER_QUERY_FRAMES;
+        if(queriesUsed[slot] == (int)queries[slot].size())
+        {
+            GLuint query;
+            glGenQueries(1, &query);
+            queries[slot].push_back(query);
+        }
+        glBeginQuery(GL_TIME_ELAPSED, queries[slot][queriesUsed[slot]]);
+        queriesUsed[slot]++;
+    }
+
+    sample.start = SDL_GetPerformanceCounter();
+    sample.end = sample.start;
+    frame->passes.push_back(sample);
+}
+
+void Profiler::endPass()
+{
+    if(!frame || (activePass < 0))
+    {
+        return;
+    }
+    frame->passes[activePass].end = SDL_GetPerformanceCounter();
+    if(gpuTiming)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+    }
+    activePass = -1;
+}
+
+ProfileStats Profiler::frameCPUStats()
+{
+    return collectStats(-1, false);
+}
+
+ProfileStats Profiler::frameGPUStats()
+{
+    return collectStats(-1, true);
+}
+
+ProfileStats Profiler::passCPUStats(const char* name)
+{
+    for(size_t i=0; i<passNames.size(); i++)
+    {
+        if(strcmp(passNames[i], name) == 0)
+        {
+            return collectStats(i, false);
+        }
+    }
+    ProfileStats stats = {};
+    return stats;
+}
+
+ProfileStats Profiler::passGPUStats(const char* name)
+{
+    for(size_t i=0; i<passNames.size(); i++)
+    {
+        if(strcmp(passNames[i], name) == 0)
+        {
+            return collectStats(i, true);
+        }
+    }
+    ProfileStats stats = {};
+    return stats;
+}
+
+static void printStats(const char* label, ProfileStats stats)
+{
+    if(stats.sampleCount > 0)
+    {
+        printf(" %s min %.3f avg %.3f p99 %.3f max %.3fms", label, stats.min, stats.average, stats.p99,
+               stats.max);
+    }
+}
+
+void Profiler::printReport()
+{
+    printf("Frame (last %d):", heldFrameCount());
+    printStats("CPU", frameCPUStats());
+    printStats("GPU", frameGPUStats());
+    printf("\n");
+    for(size_t i=0; i<passNames.size(); i++)
+    {
+        printf("    %s:", passNames[i]);
+        printStats("CPU", collectStats(i, false));
+        printStats("GPU", collectStats(i, true));
+        printf("\n");
+    }
+    if(missedQueries > 0)
+    {
+        printf("    (%d GPU times missed)\n", missedQueries);
+    }
+}
+
+int Profiler::missedQueryCount()
+{
+    return missedQueries;
+}
+
+// Prints a time to a CSV or JSON file, leaving it empty if it isn't known
+static void printTime(FILE* file, double ms)
+{
+    if(ms >= 0.0)
+    {
+        fprintf(file, "%.4f", ms);
+    }
+}
+
+bool Profiler::writeCSV(string filename)
+{
+    FILE* file = fopen(filename.c_str(), "w");
+    if(!file)
+    {
+        cout << "Unable to write profile: " << filename << endl;
+        return false;
+    }
+
+    fprintf(file, "frame,cpu_ms,gpu_ms");
+    for(size_t i=0; i<passNames.size(); i++)
+    {
+        fprintf(file, ",%s_cpu_ms,%s_gpu_ms", passNames[i], passNames[i]);
+    }
+    fprintf(file, "\n");
+
+    int count = heldFrameCount();
+    for(int i=0; i<count; i++)
+    {
+        const FrameSample& sample = heldFrame(i);
+        double cpuMs;
+        double gpuMs;
+        passTotals(sample, -1, &cpuMs, &gpuMs);
+        fprintf(file, "%llu,", (unsigned long long)sample.number);
+        printTime(file, cpuMs);
+        fprintf(file, ",");
+        printTime(file, gpuMs);
+        for(size_t pass=0; pass<passNames.size(); pass++)
+        {
+            passTotals(sample, pass, &cpuMs, &gpuMs);
+            fprintf(file, ",");
+            printTime(file, cpuMs);
+            fprintf(file, ",");
+            printTime(file, gpuMs);
+        }
+        fprintf(file, "\n");
+    }
+
+    bool success = !ferror(file);
+    fclose(file);
+    if(!success)
+    {
+        cout << "Unable to write profile: " << filename << endl;
+    }
+    return success;
+}
+
+bool Profiler::writeChromeTrace(string filename)
+{
+    FILE* file = fopen(filename.c_str(), "w");
+    if(!file)
+    {
+        cout << "Unable to write profile: " << filename << endl;
+        return false;
+    }
+
+    // Timestamps are in microseconds, from the start of the first frame. The metadata events just
+    // name the two tracks
+    fprintf(file, "{\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n");
+    fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}");
+    int count = heldFrameCount();
+    for(int i=0; i<count; i++)
+    {
+        const FrameSample& sample = heldFrame(i);
+        fprintf(file, ",\n{\"name\":\"Frame %llu\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+                (unsigned long long)sample.number, 1000.0 * ticksToMs(sample.start - firstFrameStart),
+                1000.0 * ticksToMs(sample.end - sample.start));
+        for(size_t pass=0; pass<sample.passes.size(); pass++)
+        {
+            const PassSample& passSample = sample.passes[pass];
+            double start = 1000.0 * ticksToMs(passSample.start - firstFrameStart);
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+                    passNames[passSample.pass], start, 1000.0 * ticksToMs(passSample.end - passSample.start));
+            if(passSample.gpuMs >= 0.0)
+            {
+                fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":%.3f,\"dur\":%.3f}",
+                        passNames[passSample.pass], start, 1000.0 * passSample.gpuMs);
+            }
+        }
+    }
+    fprintf(file, "\n]}\n");
+
+    bool success = !ferror(file);
+    fclose(file);
+    if(!success)
+    {
+        cout << "Unable to write profile: " << filename << endl;
+    }
+    return success;
+}
+
+bool Profiler::write(string filename)
+{
+    if((filename.size() >= 5) && (filename.compare(filename.size() - 5, 5, ".json") == 0))
+    {
+        return writeChromeTrace(filename);
+    }
+    return writeCSV(filename);
+}
+
+int Profiler::findPass(const char* name)
+{
+    // NOTE: There are only ever a handful of passes, so a linear search is quicker than a map
+    for(size_t i=0; i<passNames.size(); i++)
+    {
+        if(strcmp(passNames[i], name) == 0)
+        {
+            return i;
+        }
+    }
+    passNames.push_back(name);
+    return passNames.size() - 1;
+}
+
+void Profiler::readQueries(int slot)
+{
+    Uint64 number = queryFrames[slot];
+    if(!gpuTiming || (number == 0))
+    {
+        return;
+    }
+    FrameSample& sample = history[(number - 1) % history.size()];
+    if(sample.number != number)
+    {
+        return;
+    }
+
+    for(int i=0; i<queriesUsed[slot]; i++)
+    {
+        // Rather than stalling we drop a result that isn't ready, since the wait would then be part
+        // of the next frame's time
+        GLint available = 0;
+        glGetQueryObjectiv(queries[slot][i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if(!available)
+        {
+            missedQueries++;
+            continue;
+        }
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(queries[slot][i], GL_QUERY_RESULT, &nanoseconds);
+        sample.passes[i].gpuMs = nanoseconds / 1000000.0;
+    }
+    queryFrames[slot] = 0;
+}
+
+int Profiler::heldFrameCount()
+{
+    return min(completedFrames, (Uint64)history.size());
+}
+
+// index 0 is the oldest frame held
+const Profiler::FrameSample& Profiler::heldFrame(int index)
+{
+    Uint64 number = completedFrames - heldFrameCount() + index + 1;
+    return history[(number - 1) % history.size()];
+}
+
+// Sets the total CPU and GPU time of a pass in the frame, or of the whole frame if pass is -1. Each
+// is negative if it isn't known
+void Profiler::passTotals(const FrameSample& frame, int pass, double* cpuMs, double* gpuMs)
+{
+    *cpuMs = (pass < 0) ? ticksToMs(frame.end - frame.start) : -1.0;
+    *gpuMs = -1.0;
+    bool gpuKnown = true;
+    for(size_t i=0; i<frame.passes.size(); i++)
+    {
+        const PassSample& sample = frame.passes[i];
+        if((pass >= 0) && (sample.pass != pass))
+        {
+            continue;
+        }
+        if(pass >= 0)
+        {
+            *cpuMs = max(*cpuMs, 0.0) + ticksToMs(sample.end - sample.start);
+        }
+        if(sample.gpuMs < 0.0)
+        {
+            gpuKnown = false;
+        }
+        else if(gpuKnown)
+        {
+            *gpuMs = max(*gpuMs, 0.0) + sample.gpuMs;
+        }
+    }
+    if(!gpuKnown)
+    {
+        *gpuMs = -1.0;
+    }
+}
+
+ProfileStats Profiler::collectStats(int pass, bool gpu)
+{
+    vector<double> samples;
+    int count = heldFrameCount();
+    samples.reserve(count);
+    for(int i=0; i<count; i++)
+    {
+        double cpuMs;
+        double gpuMs;
+        passTotals(heldFrame(i), pass, &cpuMs, &gpuMs);
+        double ms = gpu ? gpuMs : cpuMs;
+        if(ms >= 0.0)
+        {
+            samples.push_back(ms);
+        }
+    }
+
+    ProfileStats stats = {};
+    stats.sampleCount = samples.size();
+    if(samples.empty())
+    {
+        return stats;
+    }
+
+    sort(samples.begin(), samples.end());
+    double total = 0.0;
+    for(size_t i=0; i<samples.size(); i++)
+    {
+        total += samples[i];
+    }
+    stats.min = samples.front();
+    stats.max = samples.back();
+    stats.average = total / samples.size();
+    // The nearest rank, so that with fewer than 100 samples this is the worst one
+    stats.p99 = samples[(size_t)ceil(0.99 * samples.size()) - 1];
+    return stats;
+}
+
+double Profiler::ticksToMs(Uint64 ticks)
+{
+    return (1000.0 * ticks) / frequency;
+}
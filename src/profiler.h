@@ -0,0 +1,119 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <string>
+#include <vector>
+
+#include "SDL.h"
+#include <GL/glew.h>
+
+// NOTE: GPU times are read back PROFILER_QUERY_FRAMES frames after they were issued, by which point
+//       the GPU has normally finished with them, so reading them doesn't stall the CPU
+static const int PROFILER_QUERY_FRAMES = 2;
+
+// The rolling statistics of one timing, over the frames the profiler currently holds. All of the
+// times are in milliseconds, and sampleCount is 0 if there were no samples (such as GPU times
+// without timer query support)
+struct ProfileStats
+{
+    int sampleCount;
+    double min;
+    double average;
+    double p99;
+    double max;
+};
+
+// Records how long each frame takes on the CPU, along with the CPU and GPU time of named passes
+// within it, and keeps the last historySize frames for rolling stats and export. The GPU times come
+// from GL_TIME_ELAPSED queries, which need GL 3.3 or ARB_timer_query (without either, passes only
+// get CPU times)
+// NOTE: GL doesn't allow GL_TIME_ELAPSED queries to overlap, so passes can't be nested, and the
+//       frame's GPU time is the total of its passes rather than everything the GPU did
+class Profiler
+{
+public:
+    explicit Profiler(int historySize = 600);
+
+    // Must be called with the GL context current, before the first frame
+    void create();
+    // Like Mesh, this must be called while the GL context still exists
+    void destroy();
+
+    void beginFrame();
+    void endFrame();
+    // name has to stay valid while the profiler exists (a string literal, normally)
+    void beginPass(const char* name);
+    void endPass();
+
+    ProfileStats frameCPUStats();
+    ProfileStats frameGPUStats();
+    // Both return stats with a sampleCount of 0 if there's no pass with that name
+    ProfileStats passCPUStats(const char* name);
+    ProfileStats passGPUStats(const char* name);
+
+    // Prints the stats of the frame and of every pass
+    void printReport();
+    // The number of GPU times that were dropped because the GPU still hadn't finished with them
+    // PROFILER_QUERY_FRAMES frames later (rather than waiting for them)
+    int missedQueryCount();
+
+    // Writes every frame held as one row, with the frame's CPU and GPU time followed by the CPU and
+    // GPU time of each pass. Times that aren't known (a pass that didn't run that frame, or a GPU
+    // time without timer queries) are left empty
+    bool writeCSV(std::string filename);
+    // Writes the frames held in Chrome's trace event format, which can be opened in chrome://tracing
+    // or Perfetto. The CPU passes are on one track and the GPU passes on another, with the GPU
+    // passes placed at the time their commands were issued (since only their length is measured)
+    bool writeChromeTrace(std::string filename);
+    // Picks the format from the file extension, Chrome trace for .json and CSV for anything else
+    bool write(std::string filename);
+
+private:
+    Profiler(const Profiler&);
+    Profiler& operator=(const Profiler&);
+
+    struct PassSample
+    {
+        int pass;
+        Uint64 start;
+        Uint64 end;
+        double gpuMs; // Negative until the query result has been read
+    };
+
+    struct FrameSample
+    {
+        Uint64 number;
+        Uint64 start;
+        Uint64 end;
+        std::vector<PassSample> passes;
+    };
+
+    int findPass(const char* name);
+    void readQueries(int slot);
+    int heldFrameCount();
+    const FrameSample& heldFrame(int index);
+    void passTotals(const FrameSample& frame, int pass, double* cpuMs, double* gpuMs);
+    ProfileStats collectStats(int pass, bool gpu);
+    double ticksToMs(Uint64 ticks);
+
+    std::vector<FrameSample> history;
+    Uint64 frameNumber; // Of the frame currently being recorded, counting from 1
+    Uint64 completedFrames;
+    FrameSample* frame;
+    int activePass; // Index into frame->passes, or -1
+
+    std::vector<const char*> passNames;
+
+    // Each slot holds the queries of one frame, and which entries of which frame they belong to
+    bool gpuTiming;
+    std::vector<GLuint> queries[PROFILER_QUERY_FRAMES];
+    Uint64 queryFrames[PROFILER_QUERY_FRAMES];
+    int queriesUsed[PROFILER_QUERY_FRAMES];
+    int missedQueries;
+
+    Uint64 frequency;
+    Uint64 firstFrameStart;
+    Uint64 reportStart;
+};
+
+#endif
@@ -0,0 +1,95 @@
+#include <vector>
+
+#include <string.h>
+
+using namespace std;
+
+#include "programuniforms.h"
+
+void ProgramUniforms::reflect(GLuint program)
+{
+    uniforms.clear();
+    blocks.clear();
+
+    GLint uniformCount = 0;
+    GLint maxNameLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+    vector<GLchar> name(maxNameLength + 1);
+    for(GLint i=0; i<uniformCount; i++)
+    {
+        GLuint index = i;
+        GLint blockIndex = -1;
+        glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_BLOCK_INDEX, &blockIndex);
+        if(blockIndex != -1)
+        {
+            continue;
+        }
+
+        Uniform uniform;
+        GLsizei nameLength = 0;
+        glGetActiveUniform(program, index, name.size(), &nameLength, &uniform.size, &uniform.type, &name[0]);
+        uniform.name.assign(&name[0], nameLength);
+        uniform.location = glGetUniformLocation(program, uniform.name.c_str());
+        // NOTE: Arrays are reported as "name[0]", but the location is the same as for plain "name"
+        size_t bracket = uniform.name.find('[');
+        if(bracket != string::npos)
+        {
+            uniform.name.resize(bracket);
+        }
+        uniforms.push_back(uniform);
+    }
+
+    GLint blockCount = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+    for(GLint i=0; i<blockCount; i++)
+    {
+        Block block;
+        block.index = i;
+        GLint nameLength = 0;
+        glGetActiveUniformBlockiv(program, i, GL_UNIFORM_BLOCK_NAME_LENGTH, &nameLength);
+        name.resize(nameLength + 1);
+        GLsizei writtenLength = 0;
+        glGetActiveUniformBlockName(program, i, name.size(), &writtenLength, &name[0]);
+        block.name.assign(&name[0], writtenLength);
+        glGetActiveUniformBlockiv(program, i, GL_UNIFORM_BLOCK_DATA_SIZE, &block.size);
+        blocks.push_back(block);
+    }
+}
+
+GLint ProgramUniforms::location(const char* name) const
+{
+    // NOTE: Programs only have a handful of uniforms, so a linear search is quicker than a map
+    for(size_t i=0; i<uniforms.size(); i++)
+    {
+        if(strcmp(uniforms[i].name.c_str(), name) == 0)
+        {
+            return uniforms[i].location;
+        }
+    }
+    return -1;
+}
+
+GLuint ProgramUniforms::blockIndex(const char* name) const
+{
+    for(size_t i=0; i<blocks.size(); i++)
+    {
+        if(strcmp(blocks[i].name.c_str(), name) == 0)
+        {
+            return blocks[i].index;
+        }
+    }
+    return GL_INVALID_INDEX;
+}
+
+GLint ProgramUniforms::blockSize(const char* name) const
+{
+    for(size_t i=0; i<blocks.size(); i++)
+    {
+        if(strcmp(blocks[i].name.c_str(), name) == 0)
+        {
+            return blocks[i].size;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,46 @@
+#ifndef PROGRAM_UNIFORMS_H
+#define PROGRAM_UNIFORMS_H
+
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+// The active uniforms and uniform blocks of a linked program, queried from GL once (see
+// ShaderCache, which does this right after linking) so that looking one up never has to go to the
+// driver. Uniforms inside blocks aren't listed, since they're set through the block's buffer
+class ProgramUniforms
+{
+public:
+    void reflect(GLuint program);
+
+    // -1 if the program has no active uniform with that name, which glUniform* quietly ignores.
+    // Arrays are found by their name without the "[0]"
+    GLint location(const char* name) const;
+
+    // GL_INVALID_INDEX if the program has no active block with that name
+    GLuint blockIndex(const char* name) const;
+    // The size of the block's data in bytes, or 0 if there's no such block
+    GLint blockSize(const char* name) const;
+
+private:
+    struct Uniform
+    {
+        std::string name;
+        GLint location;
+        GLenum type;
+        GLint size;
+    };
+
+    struct Block
+    {
+        std::string name;
+        GLuint index;
+        GLint size;
+    };
+
+    std::vector<Uniform> uniforms;
+    std::vector<Block> blocks;
+};
+
+#endif
@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+#include "scenegraph.h"
+
+SceneGraph::SceneGraph()
+{
+}
+
+void SceneGraph::reserve(int nodeCount)
+{
+    localTransforms.reserve(nodeCount);
+    worldTransformArray.reserve(nodeCount);
+    parents.reserve(nodeCount);
+    firstChildren.reserve(nodeCount);
+    nextSiblings.reserve(nodeCount);
+    dirtyFlags.reserve(nodeCount);
+}
+
+SceneNode SceneGraph::createNode(SceneNode parent)
+{
+    return createNode(parent, glm::mat4(1.0f));
+}
+
+SceneNode SceneGraph::createNode(SceneNode parent, const glm::mat4& localTransform)
+{
+    SceneNode node = parents.size();
+    localTransforms.push_back(localTransform);
+    worldTransformArray.push_back(localTransform);
+    parents.push_back(parent);
+    firstChildren.push_back(SCENE_NO_PARENT);
+    nextSiblings.push_back(SCENE_NO_PARENT);
+    dirtyFlags.push_back(0);
+    if(parent != SCENE_NO_PARENT)
+    {
+        nextSiblings[node] = firstChildren[parent];
+        firstChildren[parent] = node;
+    }
+
+    // A new node's world transform isn't known until its parent's is
+    dirtyFlags[node] = 1;
+    dirtyNodes.push_back(node);
+    return node;
+}
+
+void SceneGraph::setLocalTransform(SceneNode node, const glm::mat4& transform)
+{
+    localTransforms[node] = transform;
+    if(!dirtyFlags[node])
+    {
+        dirtyFlags[node] = 1;
+        dirtyNodes.push_back(node);
+    }
+}
+
+const glm::mat4& SceneGraph::localTransform(SceneNode node)
+{
+    return localTransforms[node];
+}
+
+const glm::mat4& SceneGraph::worldTransform(SceneNode node)
+{
+    return worldTransformArray[node];
+}
+
+SceneNode SceneGraph::parent(SceneNode node)
+{
+    return parents[node];
+}
+
+int SceneGraph::nodeCount()
+{
+    return parents.size();
+}
+
+int SceneGraph::updateWorldTransforms()
+{
+    changed.clear();
+    if(dirtyNodes.empty())
+    {
+        return 0;
+    }
+
+    // NOTE: Parents come before their children, so in node order a dirty ancestor is always
+    //       handled (taking its whole subtree with it) before any dirty descendant of it, which is
+    //       then skipped since its flag has been cleared
+    sort(dirtyNodes.begin(), dirtyNodes.end());
+    for(size_t i=0; i<dirtyNodes.size(); i++)
+    {
+        SceneNode root = dirtyNodes[i];
+        if(!dirtyFlags[root])
+        {
+            continue;
+        }
+
+        traversalStack.push_back(root);
+        while(!traversalStack.empty())
+        {
+            SceneNode node = traversalStack.back();
+            traversalStack.pop_back();
+
+            SceneNode parent = parents[node];
+            if(parent == SCENE_NO_PARENT)
+            {
+                worldTransformArray[node] = localTransforms[node];
+            }
+            else
+            {
+                worldTransformArray[node] = worldTransformArray[parent] * localTransforms[node];
+            }
+            dirtyFlags[node] = 0;
+            changed.push_back(node);
+
+            for(SceneNode child=firstChildren[node]; child!=SCENE_NO_PARENT; child=nextSiblings[child])
+            {
+                traversalStack.push_back(child);
+            }
+        }
+    }
+    dirtyNodes.clear();
+    return changed.size();
+}
+
+const vector<SceneNode>& SceneGraph::changedNodes()
+{
+    return changed;
+}
+
+const glm::mat4* SceneGraph::worldTransforms()
+{
+    return worldTransformArray.empty() ? 0 : &worldTransformArray[0];
+}
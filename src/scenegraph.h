@@ -0,0 +1,62 @@
+#ifndef SCENE_GRAPH_H
+#define SCENE_GRAPH_H
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Nodes are just indices, so that everything about them can be kept in arrays (see SceneGraph)
+typedef int SceneNode;
+static const SceneNode SCENE_NO_PARENT = -1;
+
+// A hierarchy of transforms. Each node has a local transform relative to its parent, and its world
+// transform (parent's world * local) is only recomputed when it or one of its ancestors has
+// changed. Each field is kept in its own array indexed by node (structure of arrays), so the world
+// transforms end up packed together ready to be uploaded, and updating a node only touches the
+// fields it needs.
+// Changing a local transform marks the node dirty and adds it to a list, and
+// updateWorldTransforms only visits the nodes on that list and their descendants, so the cost
+// depends on how much changed rather than on the size of the scene
+// NOTE: A node's parent is always created before it, so parents come before their children in the
+//       arrays. Nodes can't be removed or reparented (a node that's no longer needed can be given
+//       a zero scale, or be left alone)
+class SceneGraph
+{
+public:
+    SceneGraph();
+
+    void reserve(int nodeCount);
+    SceneNode createNode(SceneNode parent = SCENE_NO_PARENT);
+    SceneNode createNode(SceneNode parent, const glm::mat4& localTransform);
+
+    void setLocalTransform(SceneNode node, const glm::mat4& transform);
+    const glm::mat4& localTransform(SceneNode node);
+    // As of the last updateWorldTransforms
+    const glm::mat4& worldTransform(SceneNode node);
+    SceneNode parent(SceneNode node);
+    int nodeCount();
+
+    // Recomputes the world transform of every node that has changed since the last call, along
+    // with their descendants, and returns how many were recomputed
+    int updateWorldTransforms();
+    // The nodes recomputed by the last updateWorldTransforms, parents before children
+    const std::vector<SceneNode>& changedNodes();
+
+    // All of the world transforms in node order, nodeCount of them
+    const glm::mat4* worldTransforms();
+
+private:
+    std::vector<glm::mat4> localTransforms;
+    std::vector<glm::mat4> worldTransformArray;
+    std::vector<SceneNode> parents;
+    // The children of each node, as a linked list through the nodes themselves
+    std::vector<SceneNode> firstChildren;
+    std::vector<SceneNode> nextSiblings;
+    std::vector<unsigned char> dirtyFlags;
+
+    std::vector<SceneNode> dirtyNodes;
+    std::vector<SceneNode> changed;
+    std::vector<SceneNode> traversalStack;
+};
+
+#endif
@@ -0,0 +1,99 @@
+#include <new>
+
+#include <stdint.h>
+
+using namespace std;
+
+#include "scratcharena.h"
+
+// NOTE: The block header is padded out to 16 bytes so that the data after it is as aligned as the
+//       block itself
+static const size_t BLOCK_HEADER_SIZE = 16;
+
+ScratchArena::ScratchArena(size_t blockSize)
+    : currentBlock(0), next(0), blockEnd(0), blockSize(blockSize), usedBytes(0), capacityBytes(0)
+{
+}
+
+ScratchArena::~ScratchArena()
+{
+    releaseBlocks();
+}
+
+void* ScratchArena::allocate(size_t bytes, size_t alignment)
+{
+    uintptr_t aligned = ((uintptr_t)next + (alignment - 1)) & ~(uintptr_t)(alignment - 1);
+    if(!currentBlock || (aligned + bytes > (uintptr_t)blockEnd))
+    {
+        addBlock(bytes + alignment);
+        aligned = ((uintptr_t)next + (alignment - 1)) & ~(uintptr_t)(alignment - 1);
+    }
+
+    usedBytes += (aligned + bytes) - (uintptr_t)next;
+    next = (char*)(aligned + bytes);
+    return (void*)aligned;
+}
+
+void ScratchArena::reset()
+{
+    // NOTE: Merging the blocks means the next operation of the same size fits in one block, so it
+    //       neither allocates nor walks off the end of a block part way through
+    if(currentBlock && currentBlock->previous)
+    {
+        size_t total = capacityBytes;
+        releaseBlocks();
+        addBlock(total);
+    }
+
+    if(currentBlock)
+    {
+        next = (char*)currentBlock + BLOCK_HEADER_SIZE;
+    }
+    usedBytes = 0;
+}
+
+size_t ScratchArena::used()
+{
+    return usedBytes;
+}
+
+size_t ScratchArena::capacity()
+{
+    return capacityBytes;
+}
+
+void ScratchArena::addBlock(size_t minimumSize)
+{
+    // Each block is at least double the last, so a growing operation only needs a few of them
+    size_t size = blockSize;
+    if(currentBlock && (size < 2*currentBlock->size))
+    {
+        size = 2*currentBlock->size;
+    }
+    if(size < minimumSize)
+    {
+        size = minimumSize;
+    }
+
+    Block* block = (Block*)::operator new(BLOCK_HEADER_SIZE + size);
+    block->previous = currentBlock;
+    block->size = size;
+
+    currentBlock = block;
+    next = (char*)block + BLOCK_HEADER_SIZE;
+    blockEnd = next + size;
+    capacityBytes += size;
+}
+
+void ScratchArena::releaseBlocks()
+{
+    while(currentBlock)
+    {
+        Block* previous = currentBlock->previous;
+        ::operator delete(currentBlock);
+        currentBlock = previous;
+    }
+    next = 0;
+    blockEnd = 0;
+    capacityBytes = 0;
+}
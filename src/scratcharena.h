@@ -0,0 +1,111 @@
+#ifndef SCRATCH_ARENA_H
+#define SCRATCH_ARENA_H
+
+#include <type_traits>
+#include <vector>
+#include <stddef.h>
+
+// A monotonic allocator for data that only lives for the duration of one operation (such as the
+// raw records while an OBJ is loaded). Allocating just bumps a pointer through the current block,
+// freeing does nothing, and reset makes all of the memory available again at once. The memory is
+// kept across resets, so once the arena has grown to fit the biggest operation, repeating it makes
+// no heap allocations at all
+// NOTE: This isn't thread safe, each thread needs its own arena
+class ScratchArena
+{
+public:
+    // The first block is allocated on first use, at least blockSize bytes
+    explicit ScratchArena(size_t blockSize = 64*1024);
+    ~ScratchArena();
+
+    void* allocate(size_t bytes, size_t alignment);
+    // Everything allocated from the arena is invalid after this. If more than one block was needed
+    // since the last reset they are replaced with a single block big enough for all of them
+    void reset();
+
+    // Bytes handed out since the last reset, and the total size of the blocks held
+    size_t used();
+    size_t capacity();
+
+private:
+    ScratchArena(const ScratchArena&);
+    ScratchArena& operator=(const ScratchArena&);
+
+    struct Block
+    {
+        Block* previous;
+        size_t size; // Not including this header
+    };
+
+    void addBlock(size_t minimumSize);
+    void releaseBlocks();
+
+    Block* currentBlock;
+    char* next;
+    char* blockEnd;
+    size_t blockSize;
+    size_t usedBytes;
+    size_t capacityBytes;
+};
+
+// A standard allocator that takes its memory from a ScratchArena, so that the standard containers
+// can be used for scratch data. Without an arena it falls back to operator new and delete, which
+// lets the same container types be used whether or not the caller provides one
+// NOTE: The allocator moves along with the contents when a container is swapped or move assigned,
+//       so containers on different arenas (or the heap) can still be swapped safely
+template<class T>
+class ArenaAllocator
+{
+public:
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    ArenaAllocator(ScratchArena* arena = 0)
+        : arena(arena)
+    {
+    }
+
+    template<class U>
+    ArenaAllocator(const ArenaAllocator<U>& other)
+        : arena(other.arena)
+    {
+    }
+
+    T* allocate(size_t count)
+    {
+        if(arena)
+        {
+            return (T*)arena->allocate(count * sizeof(T), alignof(T));
+        }
+        return (T*)::operator new(count * sizeof(T));
+    }
+
+    void deallocate(T* pointer, size_t)
+    {
+        if(!arena)
+        {
+            ::operator delete(pointer);
+        }
+    }
+
+    ScratchArena* arena;
+};
+
+template<class T, class U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+    return a.arena == b.arena;
+}
+
+template<class T, class U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+    return a.arena != b.arena;
+}
+
+template<class T>
+using ScratchVector = std::vector<T, ArenaAllocator<T> >;
+
+#endif
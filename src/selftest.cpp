@@ -0,0 +1,152 @@
+#include <iostream>
+#include <string>
+
+#include <stdio.h>
+#include <math.h>
+
+using namespace std;
+
+#include "geometry.h"
+#include "selftest.h"
+
+// NOTE: The parallel loader only gives each thread at least this much of the file (see
+//       MIN_PARALLEL_CHUNK_SIZE in geometry.cpp), so a file has to be bigger than this for two
+//       threads to each get a chunk
+static const size_t CHUNKED_FILE_SIZE = 4*1024*1024 + 4096;
+
+static void writePadding(FILE* file, size_t bytes)
+{
+    // Comment lines of 64 bytes, then a shorter one for whatever is left
+    string line(63, '#');
+    line += '\n';
+    while(bytes >= line.size() + 2)
+    {
+        fputs(line.c_str(), file);
+        bytes -= line.size();
+    }
+    if(bytes > 0)
+    {
+        fputs((string(bytes - 1, '#') + "\n").c_str(), file);
+    }
+}
+
+// The concave quad the tests below triangulate. The corner at (1,1) is the reflex one, so the fan
+// from (0,0) puts a triangle over the notch
+static const char* CONCAVE_QUAD_VERTICES = "v 0 0 0\nv 2 1 0\nv 0 2 0\nv 1 1 0\n";
+static const float CONCAVE_QUAD_AREA = 1.0f;
+
+// Writes a file that the parallel loader splits into two chunks with two threads, with
+// firstChunkStart at the start of the first chunk, secondChunkStart as the first line of the second
+// chunk and fileEnd at the very end of the file
+static bool writeChunkedOBJFile(string filename, string firstChunkStart, string secondChunkStart,
+                                string fileEnd)
+{
+    const size_t lastLineSize = 1024;
+
+    // The split point is moved on to the start of the line after the one it falls in, so putting
+    // it in the middle of the last padding line of the first chunk makes the next line the first
+    // line of the second chunk
+    size_t firstChunkSize = (CHUNKED_FILE_SIZE / 2) + (lastLineSize / 2);
+    size_t fileSize = 2 * firstChunkSize - lastLineSize;
+
+    FILE* file = fopen(filename.c_str(), "wb");
+    if(!file)
+    {
+        cout << "Unable to write obj file: " << filename << endl;
+        return false;
+    }
+    fputs(firstChunkStart.c_str(), file);
+    writePadding(file, firstChunkSize - firstChunkStart.size() - lastLineSize);
+    writePadding(file, lastLineSize);
+    fputs(secondChunkStart.c_str(), file);
+    writePadding(file, fileSize - firstChunkSize - secondChunkStart.size() - fileEnd.size());
+    fputs(fileEnd.c_str(), file);
+    fclose(file);
+    return true;
+}
+
+// Whether the quad was ear clipped rather than split as a fan, which covers more than its area
+static bool isConcaveQuadEarClipped(GeometryData& geometry)
+{
+    if(geometry.vertexCount() != 6)
+    {
+        return false;
+    }
+    const float* positions = (const float*)geometry.vertexData();
+    float area = 0.0f;
+    for(int triangle=0; triangle<2; triangle++)
+    {
+        const float* a = &positions[9*triangle];
+        const float* b = a + 3;
+        const float* c = a + 6;
+        area += fabsf(((b[0] - a[0])*(c[1] - a[1]) - (b[1] - a[1])*(c[0] - a[0])) / 2.0f);
+    }
+    return fabsf(area - CONCAVE_QUAD_AREA) < 1e-5f;
+}
+
+// A concave quad whose face uses relative indices and is the first line of the second chunk, so
+// its positions are all in the first chunk. It has to be ear clipped the same way the single
+// chunk loader does it
+static bool testRelativeConcaveQuadAfterChunkSplit(string directory)
+{
+    string filename = directory + "/selftest_relative_quad.obj";
+    if(!writeChunkedOBJFile(filename, CONCAVE_QUAD_VERTICES, "f -4 -3 -2 -1\n", ""))
+    {
+        return false;
+    }
+
+    // NOTE: The ifstream loader doesn't resolve relative indices, so the file read as one chunk is
+    //       what the split file has to match
+    GeometryData expected;
+    expected.loadFromOBJFileMapped(filename);
+    GeometryData parallel;
+    parallel.loadFromOBJFileParallel(filename, 2);
+    remove(filename.c_str());
+
+    return isConcaveQuadEarClipped(expected) && parallel.matches(expected);
+}
+
+// A concave quad at the start of the file whose face refers forward to vertices at the very end,
+// in the second chunk. Every loader has to ear clip it once the vertices have been read, whichever
+// chunk the face and the vertices end up in
+static bool testForwardConcaveQuad(string directory)
+{
+    string filename = directory + "/selftest_forward_quad.obj";
+    if(!writeChunkedOBJFile(filename, "f 1 2 3 4\n", "", CONCAVE_QUAD_VERTICES))
+    {
+        return false;
+    }
+
+    GeometryData ifstreamGeometry;
+    ifstreamGeometry.loadFromOBJFile(filename);
+    GeometryData mapped;
+    mapped.loadFromOBJFileMapped(filename);
+    GeometryData parallel;
+    parallel.loadFromOBJFileParallel(filename, 2);
+    remove(filename.c_str());
+
+    return isConcaveQuadEarClipped(ifstreamGeometry) && mapped.matches(ifstreamGeometry) &&
+           parallel.matches(ifstreamGeometry);
+}
+
+int runSelfTests(string directory)
+{
+    struct SelfTest
+    {
+        const char* name;
+        bool (*run)(string directory);
+    };
+    const SelfTest tests[] = {
+        { "relative concave quad after a chunk split", testRelativeConcaveQuadAfterChunkSplit },
+        { "concave quad referring forward", testForwardConcaveQuad },
+    };
+
+    int failures = 0;
+    for(size_t i=0; i<sizeof(tests)/sizeof(tests[0]); i++)
+    {
+        bool passed = tests[i].run(directory);
+        printf("  %-48s %s\n", tests[i].name, passed ? "passed" : "FAILED");
+        failures += passed ? 0 : 1;
+    }
+    return failures;
+}
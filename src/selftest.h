@@ -0,0 +1,11 @@
+#ifndef SELF_TEST_H
+#define SELF_TEST_H
+
+#include <string>
+
+// Regression checks for loader behaviour that the benchmarks can't catch, run with --self-test.
+// Any files they need are written into directory (which must exist) and deleted again afterwards.
+// Prints a line per check and returns the number that failed
+int runSelfTests(std::string directory);
+
+#endif
@@ -0,0 +1,321 @@
+#include <iostream>
+#include <vector>
+
+#include <stdio.h>
+#include <string.h>
+
+using namespace std;
+
+#include "SDL.h"
+
+#include "mappedfile.h"
+#include "shadercache.h"
+
+static const char PROGRAM_CACHE_MAGIC[4] = { 'P', 'R', 'G', 'C' };
+
+// 64 bit FNV-1a, which is plenty to tell a handful of shaders (and drivers) apart
+static const uint64_t FNV_OFFSET_BASIS = 0xCBF29CE484222325ull;
+static uint64_t hashBytes(const void* data, size_t size, uint64_t hash)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    for(size_t i=0; i<size; i++)
+    {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+static bool readTextFile(string filename, string* text)
+{
+    FILE* file = fopen(filename.c_str(), "rb");
+    if(!file)
+    {
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    text->resize(size);
+    size_t readCount = (size > 0) ? fread(&(*text)[0], 1, size, file) : 0;
+    fclose(file);
+    text->resize(readCount);
+    return true;
+}
+
+static GLuint compileShader(const string& source, GLenum shaderType, string filename)
+{
+    GLuint shader = glCreateShader(shaderType);
+    const char* sourceText = source.c_str();
+    glShaderSource(shader, 1, &sourceText, NULL);
+    glCompileShader(shader);
+
+    GLint compileStatus;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compileStatus);
+    if(compileStatus != GL_TRUE)
+    {
+        GLchar message[1024];
+        glGetShaderInfoLog(shader, 1024, NULL, message);
+        cout << "Shader compile error in " << filename << ": " << message << endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+static double millisecondsSince(Uint64 start)
+{
+    return (1000.0 * (SDL_GetPerformanceCounter() - start)) / SDL_GetPerformanceFrequency();
+}
+
+ShaderCache::ShaderCache(string directory)
+    : directory(directory), driverChecked(false), binarySupport(false), driverHash(0)
+{
+}
+
+GLuint ShaderCache::loadProgram(string vertexFilename, string fragmentFilename)
+{
+    string vertexSource;
+    string fragmentSource;
+    if(!readTextFile(vertexFilename, &vertexSource) || !readTextFile(fragmentFilename, &fragmentSource))
+    {
+        cout << "Unable to read shaders: " << vertexFilename << ", " << fragmentFilename << endl;
+        return 0;
+    }
+
+    // NOTE: The terminator keeps the two sources apart, so moving text from the end of one file to
+    //       the start of the other still changes the hash
+    uint64_t sourceHash = hashBytes(vertexSource.data(), vertexSource.size(), FNV_OFFSET_BASIS);
+    sourceHash = hashBytes("", 1, sourceHash);
+    sourceHash = hashBytes(fragmentSource.data(), fragmentSource.size(), sourceHash);
+    for(size_t i=0; i<programs.size(); i++)
+    {
+        if(programs[i].sourceHash == sourceHash)
+        {
+            return programs[i].program;
+        }
+    }
+
+    binariesSupported();
+    Uint64 start = SDL_GetPerformanceCounter();
+    float compileMs = 0.0f;
+    GLuint program = binarySupport ? loadBinary(sourceHash, &compileMs) : 0;
+    if(program)
+    {
+        double loadMs = millisecondsSince(start);
+        printf("Loaded shader program %s + %s from its binary in %.2fms (compiling took %.2fms)\n",
+               vertexFilename.c_str(), fragmentFilename.c_str(), loadMs, compileMs);
+    }
+    else
+    {
+        GLuint vertexShader = compileShader(vertexSource, GL_VERTEX_SHADER, vertexFilename);
+        GLuint fragmentShader = compileShader(fragmentSource, GL_FRAGMENT_SHADER, fragmentFilename);
+        if(!vertexShader || !fragmentShader)
+        {
+            glDeleteShader(vertexShader);
+            glDeleteShader(fragmentShader);
+            return 0;
+        }
+
+        program = glCreateProgram();
+        glAttachShader(program, vertexShader);
+        glAttachShader(program, fragmentShader);
+        if(binarySupport)
+        {
+            glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+        glLinkProgram(program);
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+
+        // NOTE: Reading the link status waits for the driver to actually finish, so it's included
+        //       in the time even if the driver compiles in the background
+        GLint linkStatus;
+        glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+        if(linkStatus != GL_TRUE)
+        {
+            GLchar message[1024];
+            glGetProgramInfoLog(program, 1024, NULL, message);
+            cout << "Shader link error: " << message << endl;
+            glDeleteProgram(program);
+            return 0;
+        }
+
+        compileMs = millisecondsSince(start);
+        printf("Compiled shader program %s + %s in %.2fms\n", vertexFilename.c_str(),
+               fragmentFilename.c_str(), compileMs);
+        if(binarySupport)
+        {
+            saveBinary(program, sourceHash, compileMs);
+        }
+    }
+
+    CachedProgram cached;
+    cached.sourceHash = sourceHash;
+    cached.program = program;
+    cached.uniforms.reflect(program);
+    programs.push_back(cached);
+    return program;
+}
+
+void ShaderCache::releaseProgram(GLuint program)
+{
+    for(size_t i=0; i<programs.size(); i++)
+    {
+        if(programs[i].program == program)
+        {
+            glDeleteProgram(program);
+            programs.erase(programs.begin() + i);
+            return;
+        }
+    }
+}
+
+const ProgramUniforms& ShaderCache::uniforms(GLuint program)
+{
+    for(size_t i=0; i<programs.size(); i++)
+    {
+        if(programs[i].program == program)
+        {
+            return programs[i].uniforms;
+        }
+    }
+    static const ProgramUniforms noUniforms;
+    return noUniforms;
+}
+
+void ShaderCache::destroy()
+{
+    for(size_t i=0; i<programs.size(); i++)
+    {
+        glDeleteProgram(programs[i].program);
+    }
+    programs.clear();
+}
+
+bool ShaderCache::binariesSupported()
+{
+    if(driverChecked)
+    {
+        return binarySupport;
+    }
+    driverChecked = true;
+
+    // NOTE: A driver can support the extension and still have no binary formats, in which case
+    //       there's nothing it would accept
+    GLint formatCount = 0;
+    if(GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary)
+    {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    }
+    binarySupport = (formatCount > 0);
+
+    const char* driverStrings[3] = {
+        (const char*)glGetString(GL_VENDOR),
+        (const char*)glGetString(GL_RENDERER),
+        (const char*)glGetString(GL_VERSION)
+    };
+    driverHash = FNV_OFFSET_BASIS;
+    for(int i=0; i<3; i++)
+    {
+        if(driverStrings[i])
+        {
+            driverHash = hashBytes(driverStrings[i], strlen(driverStrings[i]) + 1, driverHash);
+        }
+    }
+    return binarySupport;
+}
+
+string ShaderCache::cachePath(uint64_t sourceHash)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.programcache", (unsigned long long)sourceHash);
+    return directory + name;
+}
+
+GLuint ShaderCache::loadBinary(uint64_t sourceHash, float* compileMs)
+{
+    MappedFile file;
+    if(!file.open(cachePath(sourceHash)))
+    {
+        return 0;
+    }
+
+    // NOTE: As with the mesh cache, anything that doesn't look exactly right is just a cache miss
+    const ProgramCacheHeader* header = (const ProgramCacheHeader*)file.data();
+    bool valid = (file.size() >= sizeof(ProgramCacheHeader)) &&
+                 (memcmp(header->magic, PROGRAM_CACHE_MAGIC, sizeof(PROGRAM_CACHE_MAGIC)) == 0) &&
+                 (header->version == PROGRAM_CACHE_VERSION) &&
+                 (header->sourceHash == sourceHash) &&
+                 (header->driverHash == driverHash) &&
+                 (header->binarySize == file.size() - sizeof(ProgramCacheHeader));
+    if(!valid)
+    {
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header->binaryFormat, file.data() + sizeof(ProgramCacheHeader),
+                    header->binarySize);
+    GLint linkStatus;
+    glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+    if(linkStatus != GL_TRUE)
+    {
+        cout << "The driver rejected the cached program binary, compiling it again" << endl;
+        glDeleteProgram(program);
+        return 0;
+    }
+    *compileMs = header->compileMs;
+    return program;
+}
+
+bool ShaderCache::saveBinary(GLuint program, uint64_t sourceHash, float compileMs)
+{
+    GLint binaryLength = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+    if(binaryLength <= 0)
+    {
+        return false;
+    }
+    vector<char> binary(binaryLength);
+    GLsizei writtenLength = 0;
+    GLenum binaryFormat = 0;
+    glGetProgramBinary(program, binaryLength, &writtenLength, &binaryFormat, &binary[0]);
+    if(writtenLength <= 0)
+    {
+        return false;
+    }
+
+    ProgramCacheHeader header = {};
+    memcpy(header.magic, PROGRAM_CACHE_MAGIC, sizeof(PROGRAM_CACHE_MAGIC));
+    header.version = PROGRAM_CACHE_VERSION;
+    header.sourceHash = sourceHash;
+    header.driverHash = driverHash;
+    header.binaryFormat = binaryFormat;
+    header.binarySize = writtenLength;
+    header.compileMs = compileMs;
+
+    // NOTE: Written to a temporary file and renamed into place, the same as the mesh cache
+    string finalPath = cachePath(sourceHash);
+    string tempPath = finalPath + ".tmp";
+    FILE* cacheFile = fopen(tempPath.c_str(), "wb");
+    if(!cacheFile)
+    {
+        cout << "Unable to write program cache: " << tempPath << endl;
+        return false;
+    }
+    bool success = (fwrite(&header, sizeof(header), 1, cacheFile) == 1) &&
+                   (fwrite(&binary[0], 1, writtenLength, cacheFile) == (size_t)writtenLength);
+    success = (fclose(cacheFile) == 0) && success;
+
+    if(success)
+    {
+        remove(finalPath.c_str()); // rename won't replace an existing file on Windows
+        success = (rename(tempPath.c_str(), finalPath.c_str()) == 0);
+    }
+    if(!success)
+    {
+        cout << "Unable to write program cache: " << finalPath << endl;
+        remove(tempPath.c_str());
+    }
+    return success;
+}
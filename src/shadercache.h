@@ -0,0 +1,88 @@
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include <GL/glew.h>
+
+#include "programuniforms.h"
+
+// NOTE: Bump this whenever the file layout changes. Anything about the driver that could make an
+//       old binary unusable is already covered by the driver hash
+static const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+// Every program linked from the same sources is the same, so each one is only compiled once per run,
+// and its handle is handed out again to anyone else loading those sources. Programs are also saved
+// to disk as driver specific binaries (with glGetProgramBinary) so that later runs can skip
+// compiling the GLSL altogether. The binary for a pair of sources lives in
+// "<directory><source hash>.programcache".
+//
+// File layout:
+//     ProgramCacheHeader
+//     The program binary, binarySize bytes
+//
+// A binary is only used if it was saved by the same driver (vendor, renderer and version string),
+// and if the driver rejects it anyway (drivers may refuse binaries for any reason, after an update
+// for example) the program is simply compiled from source and the binary replaced
+struct ProgramCacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceHash;
+    uint64_t driverHash;
+    uint32_t binaryFormat;
+    uint32_t binarySize;
+    // How long compiling took when the binary was saved, to report how much loading it saves
+    float compileMs;
+};
+
+class ShaderCache
+{
+public:
+    // directory is prepended to the cache file names as is, so it needs its trailing slash. The
+    // default keeps them in the working directory, next to the shaders
+    explicit ShaderCache(std::string directory = "");
+
+    // Returns 0 (after printing why) if the program can't be built. The program belongs to the cache
+    // and is deleted by destroy
+    GLuint loadProgram(std::string vertexFilename, std::string fragmentFilename);
+    // Deletes a program that's no longer needed, such as the old version of a reloaded program
+    void releaseProgram(GLuint program);
+
+    // The program's uniforms, which were looked up when it was loaded. The reference is only valid
+    // until the next program is loaded or released
+    const ProgramUniforms& uniforms(GLuint program);
+
+    // Like Mesh, this must be called while the GL context still exists
+    void destroy();
+
+    // Whether the driver can save and load program binaries, if not every run compiles from source
+    bool binariesSupported();
+
+private:
+    ShaderCache(const ShaderCache&);
+    ShaderCache& operator=(const ShaderCache&);
+
+    struct CachedProgram
+    {
+        uint64_t sourceHash;
+        GLuint program;
+        ProgramUniforms uniforms;
+    };
+
+    std::string cachePath(uint64_t sourceHash);
+    GLuint loadBinary(uint64_t sourceHash, float* compileMs);
+    bool saveBinary(GLuint program, uint64_t sourceHash, float compileMs);
+
+    std::string directory;
+    std::vector<CachedProgram> programs;
+
+    // Worked out on first use, since they need the GL context
+    bool driverChecked;
+    bool binarySupport;
+    uint64_t driverHash;
+};
+
+#endif
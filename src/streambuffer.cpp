@@ -0,0 +1,161 @@
+#include <iostream>
+
+using namespace std;
+
+#include "streambuffer.h"
+
+StreamBuffer::StreamBuffer()
+    : bufferObject(0), size(0), persistent(false), persistentData(0), region(0), regionUsed(0),
+      stalls(0)
+{
+    for(int i=0; i<STREAM_BUFFER_REGIONS; i++)
+    {
+        fences[i] = 0;
+    }
+}
+
+bool StreamBuffer::create(size_t regionSize, bool allowPersistent)
+{
+    destroy();
+
+    size = regionSize;
+    size_t totalSize = STREAM_BUFFER_REGIONS * regionSize;
+    persistent = allowPersistent && (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage);
+
+    // NOTE: GL_COPY_WRITE_BUFFER is used for all our own binding so that we never disturb the array
+    //       or element buffer bindings the caller is relying on
+    glGenBuffers(1, &bufferObject);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, bufferObject);
+    if(persistent)
+    {
+        // Coherent mapping means writes are visible to the GPU without flushing each range
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, totalSize, 0, flags);
+        persistentData = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, totalSize, flags);
+        if(!persistentData)
+        {
+            cout << "Stream buffer error: Unable to map the buffer persistently" << endl;
+            glDeleteBuffers(1, &bufferObject);
+            bufferObject = 0;
+            return false;
+        }
+    }
+    else
+    {
+        glBufferData(GL_COPY_WRITE_BUFFER, totalSize, 0, GL_STREAM_DRAW);
+    }
+
+    region = 0;
+    regionUsed = 0;
+    stalls = 0;
+    return true;
+}
+
+void StreamBuffer::destroy()
+{
+    for(int i=0; i<STREAM_BUFFER_REGIONS; i++)
+    {
+        if(fences[i])
+        {
+            glDeleteSync(fences[i]);
+            fences[i] = 0;
+        }
+    }
+    if(bufferObject)
+    {
+        if(persistentData)
+        {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, bufferObject);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            persistentData = 0;
+        }
+        glDeleteBuffers(1, &bufferObject);
+        bufferObject = 0;
+    }
+}
+
+void* StreamBuffer::beginWrite(size_t bytes, size_t alignment, size_t* offset)
+{
+    if(!bufferObject || (bytes > size))
+    {
+        return 0;
+    }
+
+    size_t start = ((regionUsed + alignment - 1) / alignment) * alignment;
+    if(start + bytes > size)
+    {
+        endFrame();
+        start = 0;
+    }
+    regionUsed = start + bytes;
+    *offset = (region * size) + start;
+
+    if(persistent)
+    {
+        return persistentData + *offset;
+    }
+    // NOTE: Unsynchronized is safe since the region's fence has already been waited on, and
+    //       invalidating the range tells the driver it doesn't need to keep the old contents
+    glBindBuffer(GL_COPY_WRITE_BUFFER, bufferObject);
+    return glMapBufferRange(GL_COPY_WRITE_BUFFER, *offset, bytes,
+                            GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+}
+
+void StreamBuffer::endWrite()
+{
+    if(!persistent && bufferObject)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, bufferObject);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    }
+}
+
+void StreamBuffer::endFrame()
+{
+    if(!bufferObject)
+    {
+        return;
+    }
+
+    fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    region = (region + 1) % STREAM_BUFFER_REGIONS;
+    regionUsed = 0;
+
+    GLsync fence = fences[region];
+    if(!fence)
+    {
+        return;
+    }
+    // Check without waiting first, so that we only count the times we actually had to wait
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    if(result == GL_TIMEOUT_EXPIRED)
+    {
+        stalls++;
+        while(result == GL_TIMEOUT_EXPIRED)
+        {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        }
+    }
+    glDeleteSync(fence);
+    fences[region] = 0;
+}
+
+GLuint StreamBuffer::buffer()
+{
+    return bufferObject;
+}
+
+size_t StreamBuffer::regionSize()
+{
+    return size;
+}
+
+bool StreamBuffer::isPersistent()
+{
+    return persistent;
+}
+
+int StreamBuffer::stallCount()
+{
+    return stalls;
+}
@@ -0,0 +1,66 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <stddef.h>
+
+#include <GL/glew.h>
+
+// NOTE: Enough regions that the CPU can fill one while the GPU is still reading the two before it,
+//       which is as far ahead as the driver normally lets a frame get
+static const int STREAM_BUFFER_REGIONS = 3;
+
+// A buffer for data that's rewritten every frame (dynamic geometry, or staging data on its way into
+// another buffer). It's split into STREAM_BUFFER_REGIONS regions which are used round robin, one
+// per frame, and each region is fenced when we move off it. Writes go straight into mapped memory
+// with no implicit synchronization, since the fence tells us when the GPU is done with a region
+// rather than the driver having to guess (as it does with glBufferData or glBufferSubData).
+// The buffer is mapped once and left mapped when persistent mapping is available (GL 4.4 or
+// ARB_buffer_storage, which Mesa's software drivers have too), and otherwise each write maps just
+// its own range, unsynchronized
+class StreamBuffer
+{
+public:
+    // NOTE: As with Mesh, destroy has to be called while the GL context still exists
+    StreamBuffer();
+
+    // Creates the buffer with STREAM_BUFFER_REGIONS regions of regionSize bytes each. Persistent
+    // mapping can be turned off to test (or compare against) the fallback path
+    bool create(size_t regionSize, bool allowPersistent = true);
+    void destroy();
+
+    // Reserves bytes in the current region, starting at a multiple of alignment, and returns where
+    // to write them. offset is set to their position in buffer(), for the draw or copy that uses
+    // them. If the region is full it's left early (as endFrame does). Returns null if bytes is more
+    // than a whole region. endWrite has to be called before any GL command reads the data
+    void* beginWrite(size_t bytes, size_t alignment, size_t* offset);
+    void endWrite();
+
+    // Called once every command reading this frame's data has been issued. Fences the current region
+    // and moves on to the next, first waiting for the GPU to finish with it if it hasn't already
+    // NOTE: This is also what happens when beginWrite runs out of room, so data in a region has to
+    //       be used before then too
+    void endFrame();
+
+    GLuint buffer();
+    size_t regionSize();
+    bool isPersistent();
+    // How many times moving on to a region had to wait for the GPU, which means the regions are too
+    // small or the CPU is getting more than STREAM_BUFFER_REGIONS frames ahead
+    int stallCount();
+
+private:
+    StreamBuffer(const StreamBuffer&);
+    StreamBuffer& operator=(const StreamBuffer&);
+
+    GLuint bufferObject;
+    size_t size; // Of each region
+    bool persistent;
+    unsigned char* persistentData;
+
+    int region;
+    size_t regionUsed;
+    GLsync fences[STREAM_BUFFER_REGIONS];
+    int stalls;
+};
+
+#endif
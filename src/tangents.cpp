@@ -0,0 +1,662 @@
+#include <thread>
+#include <vector>
+
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define TANGENTS_SSE 1
+#include <emmintrin.h>
+#endif
+
+// NOTE: The AVX kernel is compiled with a function level target attribute (so the rest of the
+//       program doesn't require AVX) and only used after checking the CPU at runtime, which we
+//       only know how to do with GCC and Clang
+#if defined(TANGENTS_SSE) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TANGENTS_AVX 1
+#include <immintrin.h>
+#endif
+
+// NOTE: The SSE load/store helpers are shared with the AVX kernel, and must be inlined into it to
+//       get VEX encoded, otherwise every call pays for a switch between SSE and AVX state
+#if defined(__GNUC__)
+#define TANGENTS_INLINE inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define TANGENTS_INLINE __forceinline
+#else
+#define TANGENTS_INLINE inline
+#endif
+
+using namespace std;
+
+#include "tangents.h"
+
+// The arbitrary frame used for triangles without a usable UV mapping: the first edge, and the
+// direction perpendicular to it within the triangle. If the triangle itself has no area, just the
+// x and y axes
+static void fallbackTangents(float edgeX1, float edgeY1, float edgeZ1,
+                             float edgeX2, float edgeY2, float edgeZ2,
+                             float* tangent, float* bitangent)
+{
+    float normalX = edgeY1*edgeZ2 - edgeZ1*edgeY2;
+    float normalY = edgeZ1*edgeX2 - edgeX1*edgeZ2;
+    float normalZ = edgeX1*edgeY2 - edgeY1*edgeX2;
+
+    float bitangentX = normalY*edgeZ1 - normalZ*edgeY1;
+    float bitangentY = normalZ*edgeX1 - normalX*edgeZ1;
+    float bitangentZ = normalX*edgeY1 - normalY*edgeX1;
+
+    float tangentLength = sqrt(edgeX1*edgeX1 + edgeY1*edgeY1 + edgeZ1*edgeZ1);
+    float bitangentLength = sqrt(bitangentX*bitangentX + bitangentY*bitangentY + bitangentZ*bitangentZ);
+    bool usable = (tangentLength > 0.0f) && (tangentLength < HUGE_VALF) &&
+                  (bitangentLength > 0.0f) && (bitangentLength < HUGE_VALF);
+
+    tangent[0] = usable ? (edgeX1 / tangentLength) : 1.0f;
+    tangent[1] = usable ? (edgeY1 / tangentLength) : 0.0f;
+    tangent[2] = usable ? (edgeZ1 / tangentLength) : 0.0f;
+    bitangent[0] = usable ? (bitangentX / bitangentLength) : 0.0f;
+    bitangent[1] = usable ? (bitangentY / bitangentLength) : 1.0f;
+    bitangent[2] = usable ? (bitangentZ / bitangentLength) : 0.0f;
+}
+
+bool computeFaceTangents(const float* p0, const float* p1, const float* p2,
+                         const float* uv0, const float* uv1, const float* uv2,
+                         float* tangent, float* bitangent)
+{
+    float deltaX1 = p1[0] - p0[0];
+    float deltaY1 = p1[1] - p0[1];
+    float deltaZ1 = p1[2] - p0[2];
+    float deltaX2 = p2[0] - p0[0];
+    float deltaY2 = p2[1] - p0[1];
+    float deltaZ2 = p2[2] - p0[2];
+
+    float deltaU1 = uv1[0] - uv0[0];
+    float deltaV1 = uv1[1] - uv0[1];
+    float deltaU2 = uv2[0] - uv0[0];
+    float deltaV2 = uv2[1] - uv0[1];
+
+    float inverseDet = 1.0f / (deltaU1*deltaV2 - deltaU2*deltaV1);
+
+    float tangentX = inverseDet * (deltaV2*deltaX1 - deltaV1*deltaX2);
+    float tangentY = inverseDet * (deltaV2*deltaY1 - deltaV1*deltaY2);
+    float tangentZ = inverseDet * (deltaV2*deltaZ1 - deltaV1*deltaZ2);
+
+    float bitangentX = inverseDet * (deltaU1*deltaX2 - deltaU2*deltaX1);
+    float bitangentY = inverseDet * (deltaU1*deltaY2 - deltaU2*deltaY1);
+    float bitangentZ = inverseDet * (deltaU1*deltaZ2 - deltaU2*deltaZ1);
+
+    float tangentLength = sqrt(tangentX*tangentX +
+                               tangentY*tangentY +
+                               tangentZ*tangentZ);
+    float bitangentLength = sqrt(bitangentX*bitangentX +
+                                 bitangentY*bitangentY +
+                                 bitangentZ*bitangentZ);
+
+    // NOTE: A zero determinant gives infinities (and from there NaNs), so rather than testing the
+    //       determinant against some epsilon we just check that what came out is usable. Written
+    //       this way NaN lengths fail the test too
+    if(!((tangentLength > 0.0f) && (tangentLength < HUGE_VALF) &&
+         (bitangentLength > 0.0f) && (bitangentLength < HUGE_VALF)))
+    {
+        fallbackTangents(deltaX1, deltaY1, deltaZ1, deltaX2, deltaY2, deltaZ2, tangent, bitangent);
+        return false;
+    }
+
+    tangent[0] = tangentX / tangentLength;
+    tangent[1] = tangentY / tangentLength;
+    tangent[2] = tangentZ / tangentLength;
+    bitangent[0] = bitangentX / bitangentLength;
+    bitangent[1] = bitangentY / bitangentLength;
+    bitangent[2] = bitangentZ / bitangentLength;
+    return true;
+}
+
+static inline void writeTriangleTangents(const float* tangent, const float* bitangent,
+                                         float* tangents, float* bitangents)
+{
+    // NOTE: Each vertex in the face gets the same (bi)tangent pair
+    for(int vertIndex=0; vertIndex<3; vertIndex++)
+    {
+        for(int i=0; i<3; i++)
+        {
+            tangents[(3*vertIndex)+i] = tangent[i];
+            bitangents[(3*vertIndex)+i] = bitangent[i];
+        }
+    }
+}
+
+static void computeTriangleTangentsRange(const float* positions, const float* texCoords,
+                                         int firstTriangle, int endTriangle,
+                                         float* tangents, float* bitangents)
+{
+    for(int triangle=firstTriangle; triangle<endTriangle; triangle++)
+    {
+        const float* p = &positions[9*triangle];
+        const float* uv = &texCoords[6*triangle];
+        float tangent[3];
+        float bitangent[3];
+        computeFaceTangents(&p[0], &p[3], &p[6], &uv[0], &uv[2], &uv[4], tangent, bitangent);
+        writeTriangleTangents(tangent, bitangent, &tangents[9*triangle], &bitangents[9*triangle]);
+    }
+}
+
+void computeTriangleTangentsScalar(const float* positions, const float* texCoords, int triangleCount,
+                                   float* tangents, float* bitangents)
+{
+    computeTriangleTangentsRange(positions, texCoords, 0, triangleCount, tangents, bitangents);
+}
+
+// The SIMD kernels below do exactly the same operations in exactly the same order as
+// computeFaceTangents, just on several triangles at once, so the results are bit for bit the
+// same. Any lane with a degenerate UV mapping is redone with the scalar fallback afterwards, since
+// those are rare enough that vectorizing the fallback isn't worth it
+
+#ifdef TANGENTS_SSE
+// Loads 4 triangles and works out their edge and UV deltas, transposed so that each register holds
+// one delta for all 4 triangles (deltaX1, deltaY1, deltaZ1, deltaX2, ..., deltaU1, ..., deltaV2)
+static TANGENTS_INLINE void loadTriangleDeltasSSE(const float* positions, const float* texCoords, __m128* deltas)
+{
+    __m128 edges1[4];
+    __m128 edges2[4];
+    __m128 uvDeltas[4];
+    for(int lane=0; lane<4; lane++)
+    {
+        // NOTE: The last position is loaded from one float early and shuffled into place so that we
+        //       never read past the end of the triangle (or the array, for the last one)
+        const float* p = &positions[9*lane];
+        __m128 p0 = _mm_loadu_ps(&p[0]);
+        __m128 p1 = _mm_loadu_ps(&p[3]);
+        __m128 p2 = _mm_loadu_ps(&p[5]);
+        p2 = _mm_shuffle_ps(p2, p2, _MM_SHUFFLE(0, 3, 2, 1));
+        edges1[lane] = _mm_sub_ps(p1, p0);
+        edges2[lane] = _mm_sub_ps(p2, p0);
+
+        const float* uv = &texCoords[6*lane];
+        __m128 uv01 = _mm_loadu_ps(&uv[0]);
+        __m128 uv2 = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)&uv[4]);
+        __m128 uv12 = _mm_shuffle_ps(uv01, uv2, _MM_SHUFFLE(1, 0, 3, 2));
+        __m128 uv00 = _mm_shuffle_ps(uv01, uv01, _MM_SHUFFLE(1, 0, 1, 0));
+        uvDeltas[lane] = _mm_sub_ps(uv12, uv00);
+    }
+
+    _MM_TRANSPOSE4_PS(edges1[0], edges1[1], edges1[2], edges1[3]);
+    _MM_TRANSPOSE4_PS(edges2[0], edges2[1], edges2[2], edges2[3]);
+    _MM_TRANSPOSE4_PS(uvDeltas[0], uvDeltas[1], uvDeltas[2], uvDeltas[3]);
+    for(int i=0; i<3; i++)
+    {
+        deltas[i] = edges1[i];
+        deltas[3+i] = edges2[i];
+    }
+    for(int i=0; i<4; i++)
+    {
+        deltas[6+i] = uvDeltas[i];
+    }
+}
+
+// Transposes one (bi)tangent component per register back to one vector per triangle, and writes it
+// out for each of the 4 triangles' 3 vertices
+static TANGENTS_INLINE void storeTriangleVectorsSSE(__m128 x, __m128 y, __m128 z, float* output)
+{
+    __m128 w = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+    __m128 vectors[4] = { x, y, z, w };
+    for(int lane=0; lane<4; lane++)
+    {
+        float* out = &output[9*lane];
+        _mm_storeu_ps(&out[0], vectors[lane]);
+        _mm_storeu_ps(&out[3], vectors[lane]);
+        _mm_storel_pi((__m64*)&out[6], vectors[lane]);
+        _mm_store_ss(&out[8], _mm_shuffle_ps(vectors[lane], vectors[lane], _MM_SHUFFLE(2, 2, 2, 2)));
+    }
+}
+
+static void computeTriangleTangentsSSE(const float* positions, const float* texCoords,
+                                       int triangleCount, float* tangents, float* bitangents)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 infinity = _mm_set1_ps(HUGE_VALF);
+
+    int triangle = 0;
+    for(; triangle+4<=triangleCount; triangle+=4)
+    {
+        __m128 deltas[10];
+        loadTriangleDeltasSSE(&positions[9*triangle], &texCoords[6*triangle], deltas);
+        __m128 deltaX1 = deltas[0];
+        __m128 deltaY1 = deltas[1];
+        __m128 deltaZ1 = deltas[2];
+        __m128 deltaX2 = deltas[3];
+        __m128 deltaY2 = deltas[4];
+        __m128 deltaZ2 = deltas[5];
+        __m128 deltaU1 = deltas[6];
+        __m128 deltaV1 = deltas[7];
+        __m128 deltaU2 = deltas[8];
+        __m128 deltaV2 = deltas[9];
+
+        __m128 inverseDet = _mm_div_ps(one, _mm_sub_ps(_mm_mul_ps(deltaU1, deltaV2),
+                                                       _mm_mul_ps(deltaU2, deltaV1)));
+
+        __m128 tangentX = _mm_mul_ps(inverseDet, _mm_sub_ps(_mm_mul_ps(deltaV2, deltaX1), _mm_mul_ps(deltaV1, deltaX2)));
+        __m128 tangentY = _mm_mul_ps(inverseDet, _mm_sub_ps(_mm_mul_ps(deltaV2, deltaY1), _mm_mul_ps(deltaV1, deltaY2)));
+        __m128 tangentZ = _mm_mul_ps(inverseDet, _mm_sub_ps(_mm_mul_ps(deltaV2, deltaZ1), _mm_mul_ps(deltaV1, deltaZ2)));
+
+        __m128 bitangentX = _mm_mul_ps(inverseDet, _mm_sub_ps(_mm_mul_ps(deltaU1, deltaX2), _mm_mul_ps(deltaU2, deltaX1)));
+        __m128 bitangentY = _mm_mul_ps(inverseDet, _mm_sub_ps(_mm_mul_ps(deltaU1, deltaY2), _mm_mul_ps(deltaU2, deltaY1)));
+        __m128 bitangentZ = _mm_mul_ps(inverseDet, _mm_sub_ps(_mm_mul_ps(deltaU1, deltaZ2), _mm_mul_ps(deltaU2, deltaZ1)));
+
+        __m128 tangentLength = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tangentX, tangentX),
+                                                                 _mm_mul_ps(tangentY, tangentY)),
+                                                      _mm_mul_ps(tangentZ, tangentZ)));
+        __m128 bitangentLength = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(bitangentX, bitangentX),
+                                                                   _mm_mul_ps(bitangentY, bitangentY)),
+                                                        _mm_mul_ps(bitangentZ, bitangentZ)));
+
+        __m128 valid = _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(tangentLength, zero),
+                                             _mm_cmplt_ps(tangentLength, infinity)),
+                                  _mm_and_ps(_mm_cmpgt_ps(bitangentLength, zero),
+                                             _mm_cmplt_ps(bitangentLength, infinity)));
+
+        storeTriangleVectorsSSE(_mm_div_ps(tangentX, tangentLength),
+                                _mm_div_ps(tangentY, tangentLength),
+                                _mm_div_ps(tangentZ, tangentLength),
+                                &tangents[9*triangle]);
+        storeTriangleVectorsSSE(_mm_div_ps(bitangentX, bitangentLength),
+                                _mm_div_ps(bitangentY, bitangentLength),
+                                _mm_div_ps(bitangentZ, bitangentLength),
+                                &bitangents[9*triangle]);
+
+        int validMask = _mm_movemask_ps(valid);
+        for(int lane=0; (lane<4) && (validMask != 0xF); lane++)
+        {
+            if(!(validMask & (1 << lane)))
+            {
+                computeTriangleTangentsRange(positions, texCoords, triangle+lane, triangle+lane+1,
+                                             tangents, bitangents);
+            }
+        }
+    }
+
+    computeTriangleTangentsRange(positions, texCoords, triangle, triangleCount, tangents, bitangents);
+}
+#endif
+
+#ifdef TANGENTS_AVX
+// NOTE: The loads and stores are just the SSE ones done twice, since AVX has no cheap 8 wide
+//       transpose, so only the math itself is 8 wide
+__attribute__((target("avx")))
+static void computeTriangleTangentsAVX(const float* positions, const float* texCoords,
+                                       int triangleCount, float* tangents, float* bitangents)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 infinity = _mm256_set1_ps(HUGE_VALF);
+
+    int triangle = 0;
+    for(; triangle+8<=triangleCount; triangle+=8)
+    {
+        __m128 lowDeltas[10];
+        __m128 highDeltas[10];
+        loadTriangleDeltasSSE(&positions[9*triangle], &texCoords[6*triangle], lowDeltas);
+        loadTriangleDeltasSSE(&positions[9*(triangle+4)], &texCoords[6*(triangle+4)], highDeltas);
+        __m256 deltas[10];
+        for(int i=0; i<10; i++)
+        {
+            deltas[i] = _mm256_insertf128_ps(_mm256_castps128_ps256(lowDeltas[i]), highDeltas[i], 1);
+        }
+        __m256 deltaX1 = deltas[0];
+        __m256 deltaY1 = deltas[1];
+        __m256 deltaZ1 = deltas[2];
+        __m256 deltaX2 = deltas[3];
+        __m256 deltaY2 = deltas[4];
+        __m256 deltaZ2 = deltas[5];
+        __m256 deltaU1 = deltas[6];
+        __m256 deltaV1 = deltas[7];
+        __m256 deltaU2 = deltas[8];
+        __m256 deltaV2 = deltas[9];
+
+        __m256 inverseDet = _mm256_div_ps(one, _mm256_sub_ps(_mm256_mul_ps(deltaU1, deltaV2),
+                                                             _mm256_mul_ps(deltaU2, deltaV1)));
+
+        __m256 tangentX = _mm256_mul_ps(inverseDet, _mm256_sub_ps(_mm256_mul_ps(deltaV2, deltaX1), _mm256_mul_ps(deltaV1, deltaX2)));
+        __m256 tangentY = _mm256_mul_ps(inverseDet, _mm256_sub_ps(_mm256_mul_ps(deltaV2, deltaY1), _mm256_mul_ps(deltaV1, deltaY2)));
+        __m256 tangentZ = _mm256_mul_ps(inverseDet, _mm256_sub_ps(_mm256_mul_ps(deltaV2, deltaZ1), _mm256_mul_ps(deltaV1, deltaZ2)));
+
+        __m256 bitangentX = _mm256_mul_ps(inverseDet, _mm256_sub_ps(_mm256_mul_ps(deltaU1, deltaX2), _mm256_mul_ps(deltaU2, deltaX1)));
+        __m256 bitangentY = _mm256_mul_ps(inverseDet, _mm256_sub_ps(_mm256_mul_ps(deltaU1, deltaY2), _mm256_mul_ps(deltaU2, deltaY1)));
+        __m256 bitangentZ = _mm256_mul_ps(inverseDet, _mm256_sub_ps(_mm256_mul_ps(deltaU1, deltaZ2), _mm256_mul_ps(deltaU2, deltaZ1)));
+
+        __m256 tangentLength = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(tangentX, tangentX),
+                                                                          _mm256_mul_ps(tangentY, tangentY)),
+                                                            _mm256_mul_ps(tangentZ, tangentZ)));
+        __m256 bitangentLength = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(bitangentX, bitangentX),
+                                                                            _mm256_mul_ps(bitangentY, bitangentY)),
+                                                              _mm256_mul_ps(bitangentZ, bitangentZ)));
+
+        __m256 valid = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(tangentLength, zero, _CMP_GT_OQ),
+                                                   _mm256_cmp_ps(tangentLength, infinity, _CMP_LT_OQ)),
+                                     _mm256_and_ps(_mm256_cmp_ps(bitangentLength, zero, _CMP_GT_OQ),
+                                                   _mm256_cmp_ps(bitangentLength, infinity, _CMP_LT_OQ)));
+
+        __m256 results[6] = { _mm256_div_ps(tangentX, tangentLength),
+                              _mm256_div_ps(tangentY, tangentLength),
+                              _mm256_div_ps(tangentZ, tangentLength),
+                              _mm256_div_ps(bitangentX, bitangentLength),
+                              _mm256_div_ps(bitangentY, bitangentLength),
+                              _mm256_div_ps(bitangentZ, bitangentLength) };
+        for(int half=0; half<2; half++)
+        {
+            __m128 halves[6];
+            for(int i=0; i<6; i++)
+            {
+                halves[i] = half ? _mm256_extractf128_ps(results[i], 1) : _mm256_castps256_ps128(results[i]);
+            }
+            storeTriangleVectorsSSE(halves[0], halves[1], halves[2], &tangents[9*(triangle+(4*half))]);
+            storeTriangleVectorsSSE(halves[3], halves[4], halves[5], &bitangents[9*(triangle+(4*half))]);
+        }
+
+        int validMask = _mm256_movemask_ps(valid);
+        for(int lane=0; (lane<8) && (validMask != 0xFF); lane++)
+        {
+            if(!(validMask & (1 << lane)))
+            {
+                computeTriangleTangentsRange(positions, texCoords, triangle+lane, triangle+lane+1,
+                                             tangents, bitangents);
+            }
+        }
+    }
+
+    computeTriangleTangentsRange(positions, texCoords, triangle, triangleCount, tangents, bitangents);
+}
+
+static bool cpuSupportsAVX()
+{
+    static int supported = -1;
+    if(supported < 0)
+    {
+        __builtin_cpu_init();
+        supported = __builtin_cpu_supports("avx") ? 1 : 0;
+    }
+    return supported == 1;
+}
+#endif
+
+static inline float dot3(const float* a, const float* b)
+{
+    return a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+}
+
+static inline void cross3(const float* a, const float* b, float* result)
+{
+    result[0] = a[1]*b[2] - a[2]*b[1];
+    result[1] = a[2]*b[0] - a[0]*b[2];
+    result[2] = a[0]*b[1] - a[1]*b[0];
+}
+
+static inline bool normalize3(float* v)
+{
+    float length = sqrt(dot3(v, v));
+    if(!((length > 0.0f) && (length < HUGE_VALF)))
+    {
+        return false;
+    }
+    v[0] /= length;
+    v[1] /= length;
+    v[2] /= length;
+    return true;
+}
+
+// Removes the part of v along the (unit) normal
+static inline void projectOntoPlane(const float* normal, float* v)
+{
+    float along = dot3(normal, v);
+    v[0] -= along * normal[0];
+    v[1] -= along * normal[1];
+    v[2] -= along * normal[2];
+}
+
+// Works out the tangent frame of each triangle in [firstTriangle, endTriangle), 6 floats each
+// (tangent then bitangent). Triangles with a degenerate UV mapping are left as all zeros
+static void computeIndexedFaceTangents(const float* positions, const float* texCoords,
+                                       const unsigned int* indices, int firstTriangle, int endTriangle,
+                                       float* faceTangents)
+{
+    for(int triangle=firstTriangle; triangle<endTriangle; triangle++)
+    {
+        const unsigned int* corner = &indices[3*triangle];
+        float* frame = &faceTangents[6*triangle];
+        if(!computeFaceTangents(&positions[3*corner[0]], &positions[3*corner[1]], &positions[3*corner[2]],
+                                &texCoords[2*corner[0]], &texCoords[2*corner[1]], &texCoords[2*corner[2]],
+                                &frame[0], &frame[3]))
+        {
+            for(int i=0; i<6; i++)
+            {
+                frame[i] = 0.0f;
+            }
+        }
+    }
+}
+
+// The angle of a triangle at one of its corners, in radians
+static float cornerAngle(const float* positions, const unsigned int* triangle, int corner)
+{
+    const float* p = &positions[3*triangle[corner]];
+    const float* next = &positions[3*triangle[(corner+1)%3]];
+    const float* prev = &positions[3*triangle[(corner+2)%3]];
+    float edge1[3] = { next[0] - p[0], next[1] - p[1], next[2] - p[2] };
+    float edge2[3] = { prev[0] - p[0], prev[1] - p[1], prev[2] - p[2] };
+    if(!normalize3(edge1) || !normalize3(edge2))
+    {
+        return 0.0f;
+    }
+
+    float cosine = dot3(edge1, edge2);
+    cosine = (cosine > 1.0f) ? 1.0f : ((cosine < -1.0f) ? -1.0f : cosine);
+    return acos(cosine);
+}
+
+// Sums and orthonormalizes the tangent frames of the vertices in [firstVertex, endVertex).
+// vertexCorners lists the corners (3*triangle + corner) using each vertex, in triangle order,
+// with the corners of vertex v starting at cornerStarts[v]
+static void resolveVertexTangents(const float* positions, const float* normals,
+                                  const unsigned int* indices, const float* faceTangents,
+                                  const int* cornerStarts, const int* vertexCorners,
+                                  int firstVertex, int endVertex, float* tangents, float* bitangents)
+{
+    for(int vertex=firstVertex; vertex<endVertex; vertex++)
+    {
+        float normal[3] = { normals[3*vertex], normals[(3*vertex)+1], normals[(3*vertex)+2] };
+        bool hasNormal = normalize3(normal);
+
+        float tangentSum[3] = { 0.0f, 0.0f, 0.0f };
+        float bitangentSum[3] = { 0.0f, 0.0f, 0.0f };
+        for(int entry=cornerStarts[vertex]; entry<cornerStarts[vertex+1]; entry++)
+        {
+            int triangle = vertexCorners[entry] / 3;
+            int corner = vertexCorners[entry] % 3;
+            const float* faceTangent = &faceTangents[6*triangle];
+            const float* faceBitangent = &faceTangents[(6*triangle)+3];
+
+            float tangent[3] = { faceTangent[0], faceTangent[1], faceTangent[2] };
+            if(hasNormal)
+            {
+                projectOntoPlane(normal, tangent);
+            }
+            if(!normalize3(tangent))
+            {
+                continue;
+            }
+
+            float weight = cornerAngle(positions, &indices[3*triangle], corner);
+            for(int i=0; i<3; i++)
+            {
+                tangentSum[i] += weight * tangent[i];
+                bitangentSum[i] += weight * faceBitangent[i];
+            }
+        }
+
+        float* tangent = &tangents[3*vertex];
+        float* bitangent = &bitangents[3*vertex];
+        if(!hasNormal)
+        {
+            // Without a normal there's nothing to orthonormalize against, so just keep the averages
+            if(!normalize3(tangentSum))
+            {
+                tangentSum[0] = 1.0f;
+                tangentSum[1] = 0.0f;
+                tangentSum[2] = 0.0f;
+            }
+            if(!normalize3(bitangentSum))
+            {
+                bitangentSum[0] = 0.0f;
+                bitangentSum[1] = 1.0f;
+                bitangentSum[2] = 0.0f;
+            }
+            for(int i=0; i<3; i++)
+            {
+                tangent[i] = tangentSum[i];
+                bitangent[i] = bitangentSum[i];
+            }
+            continue;
+        }
+
+        projectOntoPlane(normal, tangentSum);
+        if(!normalize3(tangentSum))
+        {
+            // NOTE: Any axis that isn't close to the normal gives a usable perpendicular
+            float axis[3] = { 0.0f, 0.0f, 0.0f };
+            axis[(fabs(normal[0]) < 0.5f) ? 0 : 1] = 1.0f;
+            cross3(normal, axis, tangentSum);
+            normalize3(tangentSum);
+        }
+
+        float rebuilt[3];
+        cross3(normal, tangentSum, rebuilt);
+        float handedness = (dot3(rebuilt, bitangentSum) < 0.0f) ? -1.0f : 1.0f;
+        for(int i=0; i<3; i++)
+        {
+            tangent[i] = tangentSum[i];
+            bitangent[i] = handedness * rebuilt[i];
+        }
+    }
+}
+
+// NOTE: Starting a thread costs about as much as building the frames of a few thousand triangles,
+//       so each thread needs a lot more than that to be worth it. Meshes with fewer triangles than
+//       two threads' worth (most props) are done entirely on the calling thread, which also stops
+//       AssetLoader workers each starting a thread per core on top of the parser's own
+static const int MIN_TANGENT_TRIANGLES_PER_THREAD = 32768;
+// Past this the counting sort (which is single threaded) dominates anyway
+static const int MAX_TANGENT_THREADS = 8;
+
+void computeVertexTangents(const float* positions, const float* texCoords, const float* normals,
+                           const unsigned int* indices, int indexCount, int vertexCount,
+                           float* tangents, float* bitangents, int threadCount)
+{
+    int triangleCount = indexCount / 3;
+    if(vertexCount <= 0)
+    {
+        return;
+    }
+    if(threadCount <= 0)
+    {
+        threadCount = thread::hardware_concurrency();
+    }
+    if(threadCount > MAX_TANGENT_THREADS)
+    {
+        threadCount = MAX_TANGENT_THREADS;
+    }
+    int maxUsefulThreads = triangleCount / MIN_TANGENT_TRIANGLES_PER_THREAD;
+    if(threadCount > maxUsefulThreads)
+    {
+        threadCount = maxUsefulThreads;
+    }
+    if(threadCount < 1)
+    {
+        threadCount = 1;
+    }
+
+    // Per triangle frames first, since each triangle is independent this splits across threads trivially
+    vector<float> faceTangents(6*(size_t)triangleCount);
+    float* frames = faceTangents.empty() ? 0 : &faceTangents[0];
+    vector<thread> workers;
+    for(int threadIndex=1; threadIndex<threadCount; threadIndex++)
+    {
+        int first = (int)(((long long)triangleCount * threadIndex) / threadCount);
+        int end = (int)(((long long)triangleCount * (threadIndex+1)) / threadCount);
+        workers.push_back(thread(computeIndexedFaceTangents, positions, texCoords, indices,
+                                 first, end, frames));
+    }
+    computeIndexedFaceTangents(positions, texCoords, indices, 0, triangleCount / threadCount, frames);
+    for(size_t i=0; i<workers.size(); i++)
+    {
+        workers[i].join();
+    }
+    workers.clear();
+
+    // NOTE: Rather than each thread summing into its own copy of the vertices and then adding those
+    //       together (which gives different rounding for different thread counts) we list the
+    //       corners using each vertex in triangle order, so each vertex can be summed on its own in
+    //       the same order every time. This is just a counting sort, which is cheap next to the rest
+    vector<int> cornerStarts(vertexCount + 1, 0);
+    for(int corner=0; corner<3*triangleCount; corner++)
+    {
+        cornerStarts[indices[corner] + 1]++;
+    }
+    for(int vertex=0; vertex<vertexCount; vertex++)
+    {
+        cornerStarts[vertex+1] += cornerStarts[vertex];
+    }
+    vector<int> vertexCorners(3*(size_t)triangleCount);
+    vector<int> nextCorner(cornerStarts.begin(), cornerStarts.end() - 1);
+    for(int corner=0; corner<3*triangleCount; corner++)
+    {
+        vertexCorners[nextCorner[indices[corner]]++] = corner;
+    }
+
+    const int* starts = &cornerStarts[0];
+    const int* corners = vertexCorners.empty() ? 0 : &vertexCorners[0];
+    for(int threadIndex=1; threadIndex<threadCount; threadIndex++)
+    {
+        int first = (int)(((long long)vertexCount * threadIndex) / threadCount);
+        int end = (int)(((long long)vertexCount * (threadIndex+1)) / threadCount);
+        workers.push_back(thread(resolveVertexTangents, positions, normals, indices, frames,
+                                 starts, corners, first, end, tangents, bitangents));
+    }
+    resolveVertexTangents(positions, normals, indices, frames, starts, corners,
+                          0, vertexCount / threadCount, tangents, bitangents);
+    for(size_t i=0; i<workers.size(); i++)
+    {
+        workers[i].join();
+    }
+}
+
+void computeTriangleTangents(const float* positions, const float* texCoords, int triangleCount,
+                             float* tangents, float* bitangents)
+{
+#ifdef TANGENTS_AVX
+    if(cpuSupportsAVX())
+    {
+        computeTriangleTangentsAVX(positions, texCoords, triangleCount, tangents, bitangents);
+        return;
+    }
+#endif
+#ifdef TANGENTS_SSE
+    computeTriangleTangentsSSE(positions, texCoords, triangleCount, tangents, bitangents);
+#else
+    computeTriangleTangentsScalar(positions, texCoords, triangleCount, tangents, bitangents);
+#endif
+}
+
+const char* triangleTangentKernelName()
+{
+#ifdef TANGENTS_AVX
+    if(cpuSupportsAVX())
+    {
+        return "avx";
+    }
+#endif
+#ifdef TANGENTS_SSE
+    return "sse";
+#else
+    return "scalar";
+#endif
+}
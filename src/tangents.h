@@ -0,0 +1,43 @@
+#ifndef TANGENTS_H
+#define TANGENTS_H
+
+// Computes the normalized tangent and bitangent of a triangle from its positions and UVs. If the
+// UV mapping is degenerate (so there is no well defined tangent) this returns false, and the
+// tangent and bitangent are instead set to an arbitrary orthonormal pair lying in the triangle's
+// plane, so the result never contains infinities or NaNs
+bool computeFaceTangents(const float* p0, const float* p1, const float* p2,
+                         const float* uv0, const float* uv1, const float* uv2,
+                         float* tangent, float* bitangent);
+
+// Computes the (bi)tangents of un-indexed triangles, where positions holds 9 floats and texCoords
+// 6 floats per triangle. Each triangle's tangent and bitangent are written out once for each of
+// its 3 vertices, so tangents and bitangents must have room for 9 floats per triangle.
+// This picks the widest SIMD kernel the CPU supports, every kernel gives exactly the same results
+void computeTriangleTangents(const float* positions, const float* texCoords, int triangleCount,
+                             float* tangents, float* bitangents);
+
+// The plain C++ kernel, this is what computeTriangleTangents falls back on without SIMD support
+void computeTriangleTangentsScalar(const float* positions, const float* texCoords, int triangleCount,
+                                   float* tangents, float* bitangents);
+
+// Computes smooth tangent frames for indexed triangles (in the same spirit as MikkTSpace): each
+// triangle's tangent is projected onto the plane of each of its vertex normals and added to that
+// vertex, weighted by the angle of the triangle at that corner. The sum is then orthonormalized
+// against the normal (Gram-Schmidt), and the bitangent is rebuilt as cross(normal, tangent) scaled
+// by the handedness of the UV mapping (+1 or -1), so the handedness is stored as the direction of
+// the bitangent. Triangles with a degenerate UV mapping don't contribute, and vertices that don't
+// end up with a tangent get an arbitrary one perpendicular to their normal.
+// The triangles are split across threadCount threads (0 uses every core, up to 8), but the sums are
+// always done in triangle order, so the results are exactly the same whatever the thread count.
+// Small meshes don't get any more threads than their size is worth, and are done entirely on the
+// calling thread when they're smaller than a couple of threads' worth of work
+// NOTE: Vertices shared between triangles with opposite handedness (mirrored UVs) aren't split, so
+//       their tangents will be poor
+void computeVertexTangents(const float* positions, const float* texCoords, const float* normals,
+                           const unsigned int* indices, int indexCount, int vertexCount,
+                           float* tangents, float* bitangents, int threadCount = 0);
+
+// The name of the kernel computeTriangleTangents uses on this machine ("avx", "sse" or "scalar")
+const char* triangleTangentKernelName();
+
+#endif
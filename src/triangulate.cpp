@@ -0,0 +1,154 @@
+#include <math.h>
+
+#include "triangulate.h"
+
+static void fanTriangulate(const int* corners, int cornerCount, int* triangles)
+{
+    for(int i=1; i<cornerCount-1; i++)
+    {
+        triangles[0] = corners[0];
+        triangles[1] = corners[i];
+        triangles[2] = corners[i+1];
+        triangles += 3;
+    }
+}
+
+// Twice the signed area of the 2D triangle abc, positive when it winds counter-clockwise
+static inline float signedArea(const float* a, const float* b, const float* c)
+{
+    return (b[0] - a[0])*(c[1] - a[1]) - (b[1] - a[1])*(c[0] - a[0]);
+}
+
+static inline bool isInsideTriangle(const float* p, const float* a, const float* b, const float* c)
+{
+    // NOTE: Points on an edge don't count, so duplicated corners and collinear runs don't stop
+    //       every neighbouring ear from being clipped
+    return (signedArea(a, b, p) > 0.0f) && (signedArea(b, c, p) > 0.0f) && (signedArea(c, a, p) > 0.0f);
+}
+
+void triangulatePolygon(const float* positions, int positionCount, const int* cornerPositions,
+                        int cornerCount, int* triangles)
+{
+    int corners[MAX_POLYGON_CORNERS];
+    for(int i=0; i<cornerCount; i++)
+    {
+        corners[i] = i;
+    }
+    if(cornerCount <= 3)
+    {
+        fanTriangulate(corners, cornerCount, triangles);
+        return;
+    }
+    for(int i=0; i<cornerCount; i++)
+    {
+        if((cornerPositions[i] < 0) || (cornerPositions[i] >= positionCount))
+        {
+            fanTriangulate(corners, cornerCount, triangles);
+            return;
+        }
+    }
+
+    // Newell's method gives a normal for the polygon even when it isn't quite planar
+    float normal[3] = { 0.0f, 0.0f, 0.0f };
+    for(int i=0; i<cornerCount; i++)
+    {
+        const float* current = &positions[3*cornerPositions[i]];
+        const float* next = &positions[3*cornerPositions[(i+1) % cornerCount]];
+        normal[0] += (current[1] - next[1]) * (current[2] + next[2]);
+        normal[1] += (current[2] - next[2]) * (current[0] + next[0]);
+        normal[2] += (current[0] - next[0]) * (current[1] + next[1]);
+    }
+
+    // Project onto the plane facing the normal's largest axis, with the axes ordered so that the
+    // polygon winds counter-clockwise in 2D
+    int dropAxis = 2;
+    if((fabs(normal[0]) > fabs(normal[1])) && (fabs(normal[0]) > fabs(normal[2])))
+    {
+        dropAxis = 0;
+    }
+    else if(fabs(normal[1]) > fabs(normal[2]))
+    {
+        dropAxis = 1;
+    }
+    int uAxis = (dropAxis + 1) % 3;
+    int vAxis = (dropAxis + 2) % 3;
+    if(normal[dropAxis] < 0.0f)
+    {
+        int swap = uAxis;
+        uAxis = vAxis;
+        vAxis = swap;
+    }
+
+    float projected[MAX_POLYGON_CORNERS][2];
+    for(int i=0; i<cornerCount; i++)
+    {
+        projected[i][0] = positions[(3*cornerPositions[i]) + uAxis];
+        projected[i][1] = positions[(3*cornerPositions[i]) + vAxis];
+    }
+
+    bool convex = true;
+    for(int i=0; (i<cornerCount) && convex; i++)
+    {
+        int previous = (i + cornerCount - 1) % cornerCount;
+        int next = (i + 1) % cornerCount;
+        convex = (signedArea(projected[previous], projected[i], projected[next]) >= 0.0f);
+    }
+    if(convex)
+    {
+        fanTriangulate(corners, cornerCount, triangles);
+        return;
+    }
+
+    // Ear clipping: repeatedly cut off a convex corner whose triangle has no other corner inside it.
+    // This is O(n^3) in the worst case but faces are small, and it only runs for concave ones
+    int remaining = cornerCount;
+    while(remaining > 3)
+    {
+        bool clipped = false;
+        for(int i=0; i<remaining; i++)
+        {
+            int previous = corners[(i + remaining - 1) % remaining];
+            int current = corners[i];
+            int next = corners[(i + 1) % remaining];
+            if(signedArea(projected[previous], projected[current], projected[next]) <= 0.0f)
+            {
+                continue;
+            }
+
+            bool isEar = true;
+            for(int j=0; (j<remaining) && isEar; j++)
+            {
+                int other = corners[j];
+                if((other != previous) && (other != current) && (other != next))
+                {
+                    isEar = !isInsideTriangle(projected[other], projected[previous],
+                                              projected[current], projected[next]);
+                }
+            }
+            if(!isEar)
+            {
+                continue;
+            }
+
+            triangles[0] = previous;
+            triangles[1] = current;
+            triangles[2] = next;
+            triangles += 3;
+            for(int j=i; j<remaining-1; j++)
+            {
+                corners[j] = corners[j+1];
+            }
+            remaining--;
+            clipped = true;
+            break;
+        }
+
+        if(!clipped)
+        {
+            // NOTE: Self intersecting (or otherwise broken) polygons can run out of ears, so we just
+            //       fan whatever is left rather than losing it
+            break;
+        }
+    }
+    fanTriangulate(corners, remaining, triangles);
+}
@@ -0,0 +1,16 @@
+#ifndef TRIANGULATE_H
+#define TRIANGULATE_H
+
+// The most corners a polygon can have, the OBJ loaders ignore any corners after this. This keeps
+// all the triangulation scratch space on the stack
+static const int MAX_POLYGON_CORNERS = 64;
+
+// Splits a polygon into cornerCount-2 triangles with the same winding, writing 3 corner numbers
+// (0 to cornerCount-1) per triangle into triangles. cornerPositions gives the index of each corner
+// in positions (3 floats each). Convex polygons are split as a fan from the first corner and concave
+// ones by ear clipping. If any corner is out of range of positionCount, or the polygon is too
+// badly formed to clip (e.g. self intersecting), this falls back to a fan
+void triangulatePolygon(const float* positions, int positionCount, const int* cornerPositions,
+                        int cornerCount, int* triangles);
+
+#endif
@@ -0,0 +1,235 @@
+#include <math.h>
+
+using namespace std;
+
+#include "vertexcache.h"
+
+VertexCacheStats analyzeVertexCache(const unsigned int* indices, int indexCount, int vertexCount,
+                                    int cacheSize)
+{
+    VertexCacheStats stats = {};
+    stats.cacheSize = cacheSize;
+    stats.triangleCount = indexCount / 3;
+    stats.vertexCount = vertexCount;
+
+    // NOTE: The cache is a FIFO, so a hit doesn't move the vertex, and we can tell whether a vertex
+    //       is still in the cache just by comparing when it was inserted against the miss counter
+    vector<int> insertedAt(vertexCount, -cacheSize - 1);
+    for(int i=0; i<indexCount; i++)
+    {
+        unsigned int vertex = indices[i];
+        if((stats.cacheMisses - insertedAt[vertex]) > cacheSize)
+        {
+            insertedAt[vertex] = stats.cacheMisses;
+            stats.cacheMisses++;
+        }
+    }
+
+    stats.acmr = (stats.triangleCount > 0) ? ((float)stats.cacheMisses / stats.triangleCount) : 0.0f;
+    stats.atvr = (vertexCount > 0) ? ((float)stats.cacheMisses / vertexCount) : 0.0f;
+    return stats;
+}
+
+// The tuning values here are the ones given in Forsyth's article
+static const int FORSYTH_CACHE_SIZE = 32;
+static const float CACHE_DECAY_POWER = 1.5f;
+static const float LAST_TRIANGLE_SCORE = 0.75f;
+static const float VALENCE_BOOST_SCALE = 2.0f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+
+static float vertexScore(int cachePosition, int remainingTriangles)
+{
+    if(remainingTriangles == 0)
+    {
+        // No triangles left need this vertex, so there's no point in it contributing
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if(cachePosition >= 0)
+    {
+        if(cachePosition < 3)
+        {
+            // The vertices of the last triangle get a fixed score so that we don't just favour
+            // strip-like orderings, which would waste the rest of the cache
+            score = LAST_TRIANGLE_SCORE;
+        }
+        else
+        {
+            float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+            score = 1.0f - ((cachePosition - 3) * scaler);
+            score = pow(score, CACHE_DECAY_POWER);
+        }
+    }
+
+    // Boost vertices with only a few triangles left, so that we finish off areas of the mesh
+    // rather than leaving lone triangles behind that will need their vertices transformed again
+    float valenceBoost = pow((float)remainingTriangles, -VALENCE_BOOST_POWER);
+    score += VALENCE_BOOST_SCALE * valenceBoost;
+    return score;
+}
+
+void optimizeVertexCacheOrder(unsigned int* indices, int indexCount, int vertexCount)
+{
+    int triangleCount = indexCount / 3;
+    if(triangleCount == 0)
+    {
+        return;
+    }
+
+    // Build the vertex -> triangle adjacency in one flat array (offsets/counts per vertex)
+    vector<int> triangleCounts(vertexCount, 0);
+    for(int i=0; i<indexCount; i++)
+    {
+        triangleCounts[indices[i]]++;
+    }
+    vector<int> adjacencyOffsets(vertexCount + 1, 0);
+    for(int vertex=0; vertex<vertexCount; vertex++)
+    {
+        adjacencyOffsets[vertex+1] = adjacencyOffsets[vertex] + triangleCounts[vertex];
+    }
+    vector<int> adjacency(indexCount);
+    vector<int> fillCounts(vertexCount, 0);
+    for(int triangle=0; triangle<triangleCount; triangle++)
+    {
+        for(int corner=0; corner<3; corner++)
+        {
+            unsigned int vertex = indices[(3*triangle)+corner];
+            adjacency[adjacencyOffsets[vertex] + fillCounts[vertex]] = triangle;
+            fillCounts[vertex]++;
+        }
+    }
+
+    // NOTE: remainingTriangles is kept as the number of not-yet-emitted triangles using each vertex,
+    //       and the first remainingTriangles entries of its adjacency list are always exactly those
+    vector<int>& remainingTriangles = triangleCounts;
+    vector<int> cachePositions(vertexCount, -1);
+    vector<float> vertexScores(vertexCount);
+    for(int vertex=0; vertex<vertexCount; vertex++)
+    {
+        vertexScores[vertex] = vertexScore(-1, remainingTriangles[vertex]);
+    }
+
+    vector<bool> emitted(triangleCount, false);
+
+    vector<unsigned int> output;
+    output.reserve(indexCount);
+
+    // The simulated cache has room for 3 extra entries, the vertices of the triangle being added
+    // get pushed on the front before the tail is dropped
+    int cache[FORSYTH_CACHE_SIZE + 3];
+    int cacheCount = 0;
+
+    int bestTriangle = -1;
+    int scanCursor = 0;
+    for(int emittedCount=0; emittedCount<triangleCount; emittedCount++)
+    {
+        if(bestTriangle < 0)
+        {
+            // Nothing in the cache is connected to a remaining triangle, which means every remaining
+            // triangle is equally cold, so just carry on from the first one that hasn't been emitted.
+            // The cursor only ever moves forward, which keeps this linear over the whole mesh
+            while(emitted[scanCursor])
+            {
+                scanCursor++;
+            }
+            bestTriangle = scanCursor;
+        }
+
+        int triangle = bestTriangle;
+        emitted[triangle] = true;
+
+        // Emit the triangle and move its vertices to the front of the cache
+        int newCache[FORSYTH_CACHE_SIZE + 3];
+        int newCacheCount = 0;
+        for(int corner=0; corner<3; corner++)
+        {
+            unsigned int vertex = indices[(3*triangle)+corner];
+            output.push_back(vertex);
+            newCache[newCacheCount++] = vertex;
+
+            // Remove the triangle from the vertex's list of remaining triangles
+            int* triangles = &adjacency[adjacencyOffsets[vertex]];
+            int remaining = remainingTriangles[vertex];
+            for(int i=0; i<remaining; i++)
+            {
+                if(triangles[i] == triangle)
+                {
+                    triangles[i] = triangles[remaining-1];
+                    triangles[remaining-1] = triangle;
+                    break;
+                }
+            }
+            remainingTriangles[vertex]--;
+        }
+        for(int i=0; i<cacheCount; i++)
+        {
+            int vertex = cache[i];
+            if((vertex != (int)indices[3*triangle]) &&
+               (vertex != (int)indices[(3*triangle)+1]) &&
+               (vertex != (int)indices[(3*triangle)+2]))
+            {
+                newCache[newCacheCount++] = vertex;
+            }
+        }
+
+        // Anything pushed past the end of the cache falls out of it
+        for(int i=FORSYTH_CACHE_SIZE; i<newCacheCount; i++)
+        {
+            cachePositions[newCache[i]] = -1;
+            vertexScores[newCache[i]] = vertexScore(-1, remainingTriangles[newCache[i]]);
+        }
+        cacheCount = (newCacheCount < FORSYTH_CACHE_SIZE) ? newCacheCount : FORSYTH_CACHE_SIZE;
+        for(int i=0; i<cacheCount; i++)
+        {
+            int vertex = newCache[i];
+            cache[i] = vertex;
+            cachePositions[vertex] = i;
+            vertexScores[vertex] = vertexScore(i, remainingTriangles[vertex]);
+        }
+
+        // Only the triangles touching the cache can have changed score, so those are the only
+        // candidates for the next triangle
+        bestTriangle = -1;
+        float bestScore = -1.0f;
+        for(int i=0; i<newCacheCount; i++)
+        {
+            int vertex = newCache[i];
+            const int* triangles = &adjacency[adjacencyOffsets[vertex]];
+            for(int j=0; j<remainingTriangles[vertex]; j++)
+            {
+                int candidate = triangles[j];
+                float score = vertexScores[indices[3*candidate]] +
+                              vertexScores[indices[(3*candidate)+1]] +
+                              vertexScores[indices[(3*candidate)+2]];
+                if(score > bestScore)
+                {
+                    bestScore = score;
+                    bestTriangle = candidate;
+                }
+            }
+        }
+    }
+
+    for(int i=0; i<indexCount; i++)
+    {
+        indices[i] = output[i];
+    }
+}
+
+int buildVertexFetchRemap(const unsigned int* indices, int indexCount, int vertexCount,
+                          vector<int>& remap)
+{
+    remap.assign(vertexCount, -1);
+    int nextVertex = 0;
+    for(int i=0; i<indexCount; i++)
+    {
+        unsigned int vertex = indices[i];
+        if(remap[vertex] < 0)
+        {
+            remap[vertex] = nextVertex;
+            nextVertex++;
+        }
+    }
+    return nextVertex;
+}
@@ -0,0 +1,34 @@
+#ifndef VERTEX_CACHE_H
+#define VERTEX_CACHE_H
+
+#include <vector>
+
+// Results of running an index buffer through a simulated FIFO post-transform vertex cache
+struct VertexCacheStats
+{
+    int cacheSize;
+    int triangleCount;
+    int vertexCount;
+    int cacheMisses;
+
+    // Average cache miss ratio: vertex shader invocations per triangle (0.5 is the best possible on
+    // a large regular mesh, 3.0 is the worst)
+    float acmr;
+    // Average transform to vertex ratio: vertex shader invocations per unique vertex (1.0 is best)
+    float atvr;
+};
+
+VertexCacheStats analyzeVertexCache(const unsigned int* indices, int indexCount, int vertexCount,
+                                    int cacheSize = 16);
+
+// Reorders the triangles in the index buffer (in place) to maximize post-transform cache hits,
+// using Tom Forsyth's "Linear-Speed Vertex Cache Optimisation" scoring
+void optimizeVertexCacheOrder(unsigned int* indices, int indexCount, int vertexCount);
+
+// Builds a remap table that renumbers the vertices in the order the index buffer first uses them,
+// so that vertex fetch walks through memory (roughly) linearly. remap[oldIndex] is the new index,
+// or -1 for vertices that aren't referenced at all. Returns the number of referenced vertices
+int buildVertexFetchRemap(const unsigned int* indices, int indexCount, int vertexCount,
+                          std::vector<int>& remap);
+
+#endif
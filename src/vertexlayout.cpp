@@ -0,0 +1,666 @@
+#include <math.h>
+#include <string.h>
+
+using namespace std;
+
+#include "vertexlayout.h"
+
+static const GLint attributeComponents[VERTEX_ATTRIBUTE_COUNT] = { 3, 2, 3, 3, 3 };
+
+static void setAttributeEncoding(VertexAttributeFormat* format, VertexEncoding encoding,
+                                 GLint floatComponents)
+{
+    format->encoding = encoding;
+    switch(encoding)
+    {
+    case VERTEX_ENCODING_HALF_FLOAT:
+        format->components = floatComponents;
+        format->type = GL_HALF_FLOAT;
+        format->normalized = GL_FALSE;
+        format->size = floatComponents * sizeof(unsigned short);
+        break;
+
+    case VERTEX_ENCODING_QUANTIZED_UNORM16:
+        // NOTE: Stored with a 4th (unused) component so that every vertex stays 4 byte aligned
+        format->components = 4;
+        format->type = GL_UNSIGNED_SHORT;
+        format->normalized = GL_TRUE;
+        format->size = 4 * sizeof(unsigned short);
+        break;
+
+    case VERTEX_ENCODING_PACKED_2_10_10_10:
+        format->components = 4;
+        format->type = GL_INT_2_10_10_10_REV;
+        format->normalized = GL_TRUE;
+        format->size = sizeof(unsigned int);
+        break;
+
+    case VERTEX_ENCODING_OCTAHEDRAL_SNORM16:
+        format->components = 2;
+        format->type = GL_SHORT;
+        format->normalized = GL_TRUE;
+        format->size = 2 * sizeof(short);
+        break;
+
+    case VERTEX_ENCODING_FLOAT:
+    default:
+        format->encoding = VERTEX_ENCODING_FLOAT;
+        format->components = floatComponents;
+        format->type = GL_FLOAT;
+        format->normalized = GL_FALSE;
+        format->size = floatComponents * sizeof(float);
+        break;
+    }
+}
+
+static void computeVertexLayout(VertexLayout* layout)
+{
+    int bufferCount = 0;
+    for(int buffer=0; buffer<VERTEX_ATTRIBUTE_COUNT; buffer++)
+    {
+        layout->strides[buffer] = 0;
+    }
+
+    size_t offset = 0;
+    for(int attribute=0; attribute<VERTEX_ATTRIBUTE_COUNT; attribute++)
+    {
+        VertexAttributeFormat& format = layout->attributes[attribute];
+        if(!format.enabled)
+        {
+            continue;
+        }
+
+        if(layout->interleaved)
+        {
+            format.buffer = 0;
+            format.offset = offset;
+            offset += format.size;
+            layout->strides[0] = offset;
+            bufferCount = 1;
+        }
+        else
+        {
+            format.buffer = bufferCount;
+            format.offset = 0;
+            layout->strides[bufferCount] = format.size;
+            bufferCount++;
+        }
+    }
+
+    // NOTE: Keeping the interleaved stride a multiple of 4 bytes keeps every vertex aligned, which
+    //       some drivers need in order to take their fast path
+    if(layout->interleaved && (bufferCount > 0))
+    {
+        layout->strides[0] = (layout->strides[0] + 3) & ~(size_t)3;
+    }
+    layout->bufferCount = bufferCount;
+}
+
+static VertexLayout makeVertexLayout(unsigned int attributeMask, bool interleaved)
+{
+    VertexLayout layout = {};
+    layout.interleaved = interleaved;
+    for(int attribute=0; attribute<VERTEX_ATTRIBUTE_COUNT; attribute++)
+    {
+        VertexAttributeFormat& format = layout.attributes[attribute];
+        format.enabled = (attributeMask & (1 << attribute)) != 0;
+        setAttributeEncoding(&format, VERTEX_ENCODING_FLOAT, attributeComponents[attribute]);
+    }
+    for(int i=0; i<3; i++)
+    {
+        layout.positionScale[i] = 1.0f;
+        layout.positionOffset[i] = 0.0f;
+    }
+    computeVertexLayout(&layout);
+    return layout;
+}
+
+VertexLayout makeSeparateVertexLayout(unsigned int attributeMask)
+{
+    return makeVertexLayout(attributeMask, false);
+}
+
+VertexLayout makeInterleavedVertexLayout(unsigned int attributeMask)
+{
+    return makeVertexLayout(attributeMask, true);
+}
+
+void compressVertexLayout(VertexLayout* layout, const VertexCompression& compression)
+{
+    VertexAttributeFormat* attributes = layout->attributes;
+    if(compression.quantizePositions)
+    {
+        setAttributeEncoding(&attributes[VERTEX_POSITION], VERTEX_ENCODING_QUANTIZED_UNORM16, 3);
+    }
+    if(compression.halfFloatTextureCoords)
+    {
+        setAttributeEncoding(&attributes[VERTEX_TEXTURE_COORD], VERTEX_ENCODING_HALF_FLOAT, 2);
+    }
+    if(compression.packNormals)
+    {
+        setAttributeEncoding(&attributes[VERTEX_NORMAL],
+                             compression.octahedralNormals ? VERTEX_ENCODING_OCTAHEDRAL_SNORM16 :
+                                                             VERTEX_ENCODING_PACKED_2_10_10_10, 3);
+    }
+    if(compression.packTangentFrame)
+    {
+        setAttributeEncoding(&attributes[VERTEX_TANGENT], VERTEX_ENCODING_PACKED_2_10_10_10, 3);
+        attributes[VERTEX_BITANGENT].enabled = false;
+    }
+    computeVertexLayout(layout);
+}
+
+void decompressVertexAttribute(VertexLayout* layout, VertexAttribute attribute)
+{
+    setAttributeEncoding(&layout->attributes[attribute], VERTEX_ENCODING_FLOAT,
+                         attributeComponents[attribute]);
+    computeVertexLayout(layout);
+}
+
+bool isUncompressedVertexLayout(const VertexLayout& layout)
+{
+    for(int attribute=0; attribute<VERTEX_ATTRIBUTE_COUNT; attribute++)
+    {
+        if(layout.attributes[attribute].enabled &&
+           (layout.attributes[attribute].encoding != VERTEX_ENCODING_FLOAT))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static const float* streamForAttribute(const VertexStreams& streams, int attribute)
+{
+    switch(attribute)
+    {
+    case VERTEX_POSITION:
+        return streams.positions;
+    case VERTEX_TEXTURE_COORD:
+        return streams.textureCoords;
+    case VERTEX_NORMAL:
+        return streams.normals;
+    case VERTEX_TANGENT:
+        return streams.tangents;
+    case VERTEX_BITANGENT:
+        return streams.bitangents;
+    default:
+        return 0;
+    }
+}
+
+VertexLayout restrictVertexLayout(const VertexLayout& layout, const VertexStreams& streams)
+{
+    VertexLayout result = layout;
+    for(int attribute=0; attribute<VERTEX_ATTRIBUTE_COUNT; attribute++)
+    {
+        if(!streamForAttribute(streams, attribute))
+        {
+            result.attributes[attribute].enabled = false;
+        }
+    }
+    computeVertexLayout(&result);
+
+    for(int i=0; i<3; i++)
+    {
+        result.positionScale[i] = 1.0f;
+        result.positionOffset[i] = 0.0f;
+    }
+    if((result.attributes[VERTEX_POSITION].encoding == VERTEX_ENCODING_QUANTIZED_UNORM16) &&
+       (streams.vertexCount > 0))
+    {
+        float minimum[3];
+        float maximum[3];
+        for(int i=0; i<3; i++)
+        {
+            minimum[i] = streams.positions[i];
+            maximum[i] = streams.positions[i];
+        }
+        for(int vertex=1; vertex<streams.vertexCount; vertex++)
+        {
+            for(int i=0; i<3; i++)
+            {
+                float value = streams.positions[(3*vertex)+i];
+                minimum[i] = (value < minimum[i]) ? value : minimum[i];
+                maximum[i] = (value > maximum[i]) ? value : maximum[i];
+            }
+        }
+        for(int i=0; i<3; i++)
+        {
+            result.positionOffset[i] = minimum[i];
+            result.positionScale[i] = maximum[i] - minimum[i];
+        }
+    }
+    return result;
+}
+
+size_t vertexLayoutSize(const VertexLayout& layout, int vertexCount)
+{
+    size_t total = 0;
+    for(int buffer=0; buffer<layout.bufferCount; buffer++)
+    {
+        total += layout.strides[buffer] * vertexCount;
+    }
+    return total;
+}
+
+// Round to nearest even conversion to IEEE 754 half precision, handling subnormals and overflow
+static unsigned short floatToHalf(float value)
+{
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    unsigned int sign = (bits >> 16) & 0x8000;
+    unsigned int mantissa = bits & 0x007FFFFF;
+    int exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+
+    if((bits & 0x7FFFFFFF) >= 0x7F800000)
+    {
+        // Infinity stays infinity, and NaN stays NaN
+        return sign | 0x7C00 | ((mantissa != 0) ? 0x200 : 0);
+    }
+    if(exponent >= 31)
+    {
+        return sign | 0x7C00;
+    }
+    if(exponent <= 0)
+    {
+        if(exponent < -10)
+        {
+            return sign;
+        }
+        mantissa |= 0x00800000;
+        unsigned int shift = 14 - exponent;
+        unsigned int half = mantissa >> shift;
+        unsigned int remainder = mantissa & ((1u << shift) - 1);
+        unsigned int halfway = 1u << (shift - 1);
+        if((remainder > halfway) || ((remainder == halfway) && (half & 1)))
+        {
+            half++;
+        }
+        return sign | half;
+    }
+
+    unsigned int half = sign | (exponent << 10) | (mantissa >> 13);
+    unsigned int remainder = mantissa & 0x1FFF;
+    if((remainder > 0x1000) || ((remainder == 0x1000) && (half & 1)))
+    {
+        // NOTE: A carry out of the mantissa correctly bumps the exponent (up to infinity)
+        half++;
+    }
+    return half;
+}
+
+static float halfToFloat(unsigned short half)
+{
+    unsigned int sign = (half & 0x8000) << 16;
+    unsigned int exponent = (half >> 10) & 0x1F;
+    unsigned int mantissa = half & 0x3FF;
+
+    float magnitude;
+    if(exponent == 0)
+    {
+        magnitude = ldexp((float)mantissa, -24);
+    }
+    else if(exponent == 31)
+    {
+        magnitude = (mantissa == 0) ? HUGE_VALF : NAN;
+    }
+    else
+    {
+        magnitude = ldexp((float)(mantissa | 0x400), (int)exponent - 25);
+    }
+
+    unsigned int bits;
+    memcpy(&bits, &magnitude, sizeof(bits));
+    bits |= sign;
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+static float clampSigned(float value)
+{
+    return (value < -1.0f) ? -1.0f : ((value > 1.0f) ? 1.0f : value);
+}
+
+static int roundToInt(float value)
+{
+    return (int)floor(value + 0.5f);
+}
+
+// NOTE: Decoding uses the GL 4.2+ snorm rule (c / (2^(b-1) - 1)). Older contexts use a slightly
+//       different rule, but the difference is far below the precision of the encoding itself
+static unsigned int packSnorm2_10_10_10(const float* vector, float w)
+{
+    // Only the direction survives (normals aren't guaranteed to be unit length in OBJ files, and
+    // anything longer would otherwise get clamped out of shape)
+    float length = sqrt(vector[0]*vector[0] + vector[1]*vector[1] + vector[2]*vector[2]);
+    float inverseLength = (length > 0.0f) ? (1.0f / length) : 0.0f;
+    unsigned int x = (unsigned int)roundToInt(clampSigned(vector[0] * inverseLength) * 511.0f) & 0x3FF;
+    unsigned int y = (unsigned int)roundToInt(clampSigned(vector[1] * inverseLength) * 511.0f) & 0x3FF;
+    unsigned int z = (unsigned int)roundToInt(clampSigned(vector[2] * inverseLength) * 511.0f) & 0x3FF;
+    unsigned int packedW = (unsigned int)roundToInt(clampSigned(w)) & 0x3;
+    return x | (y << 10) | (z << 20) | (packedW << 30);
+}
+
+static void unpackSnorm2_10_10_10(unsigned int packed, float* vector, float* w)
+{
+    for(int i=0; i<3; i++)
+    {
+        int value = (packed >> (10*i)) & 0x3FF;
+        value = (value >= 512) ? (value - 1024) : value;
+        vector[i] = clampSigned(value / 511.0f);
+    }
+    int packedW = (packed >> 30) & 0x3;
+    *w = clampSigned((float)((packedW >= 2) ? (packedW - 4) : packedW));
+}
+
+static float signNotZero(float value)
+{
+    return (value >= 0.0f) ? 1.0f : -1.0f;
+}
+
+static void encodeOctahedral(const float* vector, short* encoded)
+{
+    float length = fabs(vector[0]) + fabs(vector[1]) + fabs(vector[2]);
+    float x = (length > 0.0f) ? (vector[0] / length) : 0.0f;
+    float y = (length > 0.0f) ? (vector[1] / length) : 0.0f;
+    if(vector[2] < 0.0f)
+    {
+        // Fold the lower hemisphere over the diagonals
+        float foldedX = (1.0f - fabs(y)) * signNotZero(x);
+        float foldedY = (1.0f - fabs(x)) * signNotZero(y);
+        x = foldedX;
+        y = foldedY;
+    }
+    encoded[0] = (short)roundToInt(clampSigned(x) * 32767.0f);
+    encoded[1] = (short)roundToInt(clampSigned(y) * 32767.0f);
+}
+
+void decodeOctahedral(const short* encoded, float* vector)
+{
+    float x = clampSigned(encoded[0] / 32767.0f);
+    float y = clampSigned(encoded[1] / 32767.0f);
+    float z = 1.0f - fabs(x) - fabs(y);
+    if(z < 0.0f)
+    {
+        float unfoldedX = (1.0f - fabs(y)) * signNotZero(x);
+        float unfoldedY = (1.0f - fabs(x)) * signNotZero(y);
+        x = unfoldedX;
+        y = unfoldedY;
+    }
+    float length = sqrt(x*x + y*y + z*z);
+    vector[0] = x / length;
+    vector[1] = y / length;
+    vector[2] = z / length;
+}
+
+// The sign of the bitangent relative to cross(normal, tangent), which is all the shader needs to
+// rebuild it from the normal and tangent
+static float bitangentHandedness(const VertexStreams& streams, int vertex)
+{
+    if(!streams.normals || !streams.bitangents)
+    {
+        return 1.0f;
+    }
+    const float* n = &streams.normals[3*vertex];
+    const float* t = &streams.tangents[3*vertex];
+    const float* b = &streams.bitangents[3*vertex];
+    float crossX = n[1]*t[2] - n[2]*t[1];
+    float crossY = n[2]*t[0] - n[0]*t[2];
+    float crossZ = n[0]*t[1] - n[1]*t[0];
+    return signNotZero(crossX*b[0] + crossY*b[1] + crossZ*b[2]);
+}
+
+static void packAttribute(const VertexLayout& layout, const VertexStreams& streams, int attribute,
+                          int vertex, unsigned char* destination)
+{
+    const VertexAttributeFormat& format = layout.attributes[attribute];
+    const float* source = streamForAttribute(streams, attribute) +
+                          (attributeComponents[attribute] * vertex);
+    switch(format.encoding)
+    {
+    case VERTEX_ENCODING_HALF_FLOAT:
+    {
+        unsigned short* halves = (unsigned short*)destination;
+        for(int i=0; i<format.components; i++)
+        {
+            halves[i] = floatToHalf(source[i]);
+        }
+    } break;
+
+    case VERTEX_ENCODING_QUANTIZED_UNORM16:
+    {
+        unsigned short* quantized = (unsigned short*)destination;
+        for(int i=0; i<3; i++)
+        {
+            float scale = layout.positionScale[i];
+            float normalized = (scale > 0.0f) ? ((source[i] - layout.positionOffset[i]) / scale) : 0.0f;
+            normalized = (normalized < 0.0f) ? 0.0f : ((normalized > 1.0f) ? 1.0f : normalized);
+            quantized[i] = (unsigned short)roundToInt(normalized * 65535.0f);
+        }
+        quantized[3] = 65535;
+    } break;
+
+    case VERTEX_ENCODING_PACKED_2_10_10_10:
+    {
+        float w = (attribute == VERTEX_TANGENT) ? bitangentHandedness(streams, vertex) : 1.0f;
+        unsigned int packed = packSnorm2_10_10_10(source, w);
+        memcpy(destination, &packed, sizeof(packed));
+    } break;
+
+    case VERTEX_ENCODING_OCTAHEDRAL_SNORM16:
+    {
+        encodeOctahedral(source, (short*)destination);
+    } break;
+
+    case VERTEX_ENCODING_FLOAT:
+    default:
+    {
+        memcpy(destination, source, format.size);
+    } break;
+    }
+}
+
+void packVertexLayout(const VertexLayout& layout, const VertexStreams& streams,
+                      vector<unsigned char>* buffers)
+{
+    int vertexCount = streams.vertexCount;
+    for(int buffer=0; buffer<layout.bufferCount; buffer++)
+    {
+        buffers[buffer].assign(layout.strides[buffer] * vertexCount, 0);
+    }
+
+    for(int attribute=0; attribute<VERTEX_ATTRIBUTE_COUNT; attribute++)
+    {
+        const VertexAttributeFormat& format = layout.attributes[attribute];
+        const float* source = streamForAttribute(streams, attribute);
+        if(!format.enabled || !source)
+        {
+            continue;
+        }
+
+        size_t stride = layout.strides[format.buffer];
+        unsigned char* destination = &buffers[format.buffer][0] + format.offset;
+        if((format.encoding == VERTEX_ENCODING_FLOAT) && (stride == format.size))
+        {
+            // Tightly packed, so this is a straight copy of the whole stream
+            memcpy(destination, source, format.size * vertexCount);
+            continue;
+        }
+
+        for(int vertex=0; vertex<vertexCount; vertex++)
+        {
+            packAttribute(layout, streams, attribute, vertex, destination + (stride * vertex));
+        }
+    }
+}
+
+// Decodes a single attribute of a single vertex back to floats, returns the w component (which is
+// only meaningful for packed tangents)
+static float unpackAttribute(const VertexLayout& layout, int attribute, const unsigned char* source,
+                             float* result)
+{
+    const VertexAttributeFormat& format = layout.attributes[attribute];
+    float w = 1.0f;
+    switch(format.encoding)
+    {
+    case VERTEX_ENCODING_HALF_FLOAT:
+    {
+        const unsigned short* halves = (const unsigned short*)source;
+        for(int i=0; i<format.components; i++)
+        {
+            result[i] = halfToFloat(halves[i]);
+        }
+    } break;
+
+    case VERTEX_ENCODING_QUANTIZED_UNORM16:
+    {
+        const unsigned short* quantized = (const unsigned short*)source;
+        for(int i=0; i<3; i++)
+        {
+            result[i] = ((quantized[i] / 65535.0f) * layout.positionScale[i]) + layout.positionOffset[i];
+        }
+    } break;
+
+    case VERTEX_ENCODING_PACKED_2_10_10_10:
+    {
+        unsigned int packed;
+        memcpy(&packed, source, sizeof(packed));
+        unpackSnorm2_10_10_10(packed, result, &w);
+    } break;
+
+    case VERTEX_ENCODING_OCTAHEDRAL_SNORM16:
+    {
+        decodeOctahedral((const short*)source, result);
+    } break;
+
+    case VERTEX_ENCODING_FLOAT:
+    default:
+    {
+        memcpy(result, source, format.size);
+    } break;
+    }
+    return w;
+}
+
+// NOTE: This is done in double precision, since acos of something very close to 1 in single
+//       precision can't resolve the small angles we are trying to measure
+static float angleBetween(const float* a, const float* b)
+{
+    double lengthA = sqrt((double)a[0]*a[0] + (double)a[1]*a[1] + (double)a[2]*a[2]);
+    double lengthB = sqrt((double)b[0]*b[0] + (double)b[1]*b[1] + (double)b[2]*b[2]);
+    if((lengthA == 0.0) || (lengthB == 0.0))
+    {
+        return 0.0f;
+    }
+    double cosine = ((double)a[0]*b[0] + (double)a[1]*b[1] + (double)a[2]*b[2]) / (lengthA * lengthB);
+    cosine = (cosine < -1.0) ? -1.0 : ((cosine > 1.0) ? 1.0 : cosine);
+    return (float)(acos(cosine) * (180.0 / 3.14159265358979));
+}
+
+VertexLayoutError measureVertexLayoutError(const VertexLayout& layout, const VertexStreams& streams,
+                                           const vector<unsigned char>* buffers)
+{
+    VertexLayoutError error = {};
+    for(int vertex=0; vertex<streams.vertexCount; vertex++)
+    {
+        float decoded[VERTEX_ATTRIBUTE_COUNT][4] = {};
+        float tangentW = 1.0f;
+        for(int attribute=0; attribute<VERTEX_ATTRIBUTE_COUNT; attribute++)
+        {
+            const VertexAttributeFormat& format = layout.attributes[attribute];
+            if(format.enabled)
+            {
+                const unsigned char* source = &buffers[format.buffer][0] + format.offset +
+                                              (layout.strides[format.buffer] * vertex);
+                float w = unpackAttribute(layout, attribute, source, decoded[attribute]);
+                if(attribute == VERTEX_TANGENT)
+                {
+                    tangentW = w;
+                }
+            }
+        }
+
+        if(layout.attributes[VERTEX_POSITION].enabled)
+        {
+            const float* original = &streams.positions[3*vertex];
+            for(int i=0; i<3; i++)
+            {
+                float difference = fabs(decoded[VERTEX_POSITION][i] - original[i]);
+                error.maxPositionError = (difference > error.maxPositionError) ? difference :
+                                                                                error.maxPositionError;
+            }
+        }
+        if(layout.attributes[VERTEX_TEXTURE_COORD].enabled)
+        {
+            const float* original = &streams.textureCoords[2*vertex];
+            for(int i=0; i<2; i++)
+            {
+                float difference = fabs(decoded[VERTEX_TEXTURE_COORD][i] - original[i]);
+                error.maxTextureCoordError = (difference > error.maxTextureCoordError) ?
+                                             difference : error.maxTextureCoordError;
+            }
+        }
+        if(layout.attributes[VERTEX_NORMAL].enabled)
+        {
+            float angle = angleBetween(decoded[VERTEX_NORMAL], &streams.normals[3*vertex]);
+            error.maxNormalAngle = (angle > error.maxNormalAngle) ? angle : error.maxNormalAngle;
+        }
+        if(layout.attributes[VERTEX_TANGENT].enabled)
+        {
+            float angle = angleBetween(decoded[VERTEX_TANGENT], &streams.tangents[3*vertex]);
+            error.maxTangentAngle = (angle > error.maxTangentAngle) ? angle : error.maxTangentAngle;
+        }
+
+        if(streams.bitangents)
+        {
+            float bitangent[3];
+            bool hasBitangent = true;
+            if(layout.attributes[VERTEX_BITANGENT].enabled)
+            {
+                memcpy(bitangent, decoded[VERTEX_BITANGENT], sizeof(bitangent));
+            }
+            else if(layout.attributes[VERTEX_TANGENT].enabled && layout.attributes[VERTEX_NORMAL].enabled)
+            {
+                // Rebuild it the same way the shader would
+                const float* n = decoded[VERTEX_NORMAL];
+                const float* t = decoded[VERTEX_TANGENT];
+                bitangent[0] = (n[1]*t[2] - n[2]*t[1]) * tangentW;
+                bitangent[1] = (n[2]*t[0] - n[0]*t[2]) * tangentW;
+                bitangent[2] = (n[0]*t[1] - n[1]*t[0]) * tangentW;
+            }
+            else
+            {
+                hasBitangent = false;
+            }
+
+            if(hasBitangent)
+            {
+                float angle = angleBetween(bitangent, &streams.bitangents[3*vertex]);
+                error.maxBitangentAngle = (angle > error.maxBitangentAngle) ? angle :
+                                                                              error.maxBitangentAngle;
+            }
+        }
+    }
+    return error;
+}
+
+void bindVertexLayout(const VertexLayout& layout, const GLuint* buffers)
+{
+    for(int attribute=0; attribute<VERTEX_ATTRIBUTE_COUNT; attribute++)
+    {
+        const VertexAttributeFormat& format = layout.attributes[attribute];
+        if(!format.enabled)
+        {
+            glDisableVertexAttribArray(attribute);
+            continue;
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, buffers[format.buffer]);
+        glVertexAttribPointer(attribute, format.components, format.type, format.normalized,
+                              layout.strides[format.buffer], (void*)format.offset);
+        glEnableVertexAttribArray(attribute);
+    }
+}
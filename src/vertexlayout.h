@@ -0,0 +1,133 @@
+#ifndef VERTEX_LAYOUT_H
+#define VERTEX_LAYOUT_H
+
+#include <vector>
+#include <stddef.h>
+
+#include <GL/glew.h>
+
+#include "geometry.h"
+
+// NOTE: The attribute values double as the shader input locations, so these need to match the
+//       layout(location = ...) declarations in the vertex shaders
+enum VertexAttribute
+{
+    VERTEX_POSITION,
+    VERTEX_TEXTURE_COORD,
+    VERTEX_NORMAL,
+    VERTEX_TANGENT,
+    VERTEX_BITANGENT,
+    VERTEX_ATTRIBUTE_COUNT
+};
+
+enum VertexAttributeMask
+{
+    VERTEX_POSITION_BIT = 1 << VERTEX_POSITION,
+    VERTEX_TEXTURE_COORD_BIT = 1 << VERTEX_TEXTURE_COORD,
+    VERTEX_NORMAL_BIT = 1 << VERTEX_NORMAL,
+    VERTEX_TANGENT_BIT = 1 << VERTEX_TANGENT,
+    VERTEX_BITANGENT_BIT = 1 << VERTEX_BITANGENT,
+    VERTEX_ALL_ATTRIBUTES_BIT = (1 << VERTEX_ATTRIBUTE_COUNT) - 1
+};
+
+// How an attribute is stored in the vertex buffer. Everything other than VERTEX_ENCODING_FLOAT is
+// lossy, measureVertexLayoutError reports how much precision a given layout loses on a mesh
+enum VertexEncoding
+{
+    VERTEX_ENCODING_FLOAT,
+    // 16-bit floats, for texture coordinates
+    VERTEX_ENCODING_HALF_FLOAT,
+    // 16-bit unsigned normalized values spanning the mesh bounds, for positions. The shader has to
+    // undo this with the layout's positionScale and positionOffset
+    VERTEX_ENCODING_QUANTIZED_UNORM16,
+    // GL_INT_2_10_10_10_REV, for unit vectors. When used for the tangent, the bitangent is dropped
+    // and its handedness is stored in w instead, so the shader has to rebuild it as
+    // cross(normal, tangent.xyz) * tangent.w
+    VERTEX_ENCODING_PACKED_2_10_10_10,
+    // Octahedral mapping of a unit vector into 2 16-bit snorm values, for normals. The shader receives
+    // a vec2 and has to decode it (the same way decodeOctahedral does)
+    VERTEX_ENCODING_OCTAHEDRAL_SNORM16
+};
+
+struct VertexAttributeFormat
+{
+    bool enabled;
+    VertexEncoding encoding;
+    GLint components;
+    GLenum type;
+    GLboolean normalized;
+    int buffer;      // Which of the layout's buffers this attribute is stored in
+    size_t offset;   // Byte offset of the attribute within a vertex (or within its buffer for SoA)
+    size_t size;     // Bytes per vertex for this attribute
+};
+
+// Describes how a mesh's vertex attributes are laid out across one or more buffers. This is used
+// both to pack the data on the CPU and to set up the attribute pointers, so the two always agree
+struct VertexLayout
+{
+    VertexAttributeFormat attributes[VERTEX_ATTRIBUTE_COUNT];
+    int bufferCount;
+    size_t strides[VERTEX_ATTRIBUTE_COUNT]; // Per buffer
+    bool interleaved;
+
+    // The transform that takes quantized positions back to model space (position*scale + offset).
+    // This is the identity unless positions use VERTEX_ENCODING_QUANTIZED_UNORM16
+    float positionScale[3];
+    float positionOffset[3];
+};
+
+// Which of the lossy encodings to use, see VertexEncoding for what each of them means
+struct VertexCompression
+{
+    bool quantizePositions;
+    bool halfFloatTextureCoords;
+    bool octahedralNormals; // Otherwise normals are packed 2_10_10_10
+    bool packNormals;
+    bool packTangentFrame;
+};
+
+// The largest error introduced by a layout's encodings over every vertex of a mesh
+struct VertexLayoutError
+{
+    float maxPositionError;      // In model space units
+    float maxTextureCoordError;
+    float maxNormalAngle;        // All angles are in degrees
+    float maxTangentAngle;
+    float maxBitangentAngle;
+};
+
+// One buffer per attribute (which is how GeometryData stores them)
+VertexLayout makeSeparateVertexLayout(unsigned int attributeMask);
+// All attributes packed together into a single buffer, one vertex after another
+VertexLayout makeInterleavedVertexLayout(unsigned int attributeMask);
+
+// Switches the layout's attributes over to the compressed encodings (and recomputes the offsets and
+// strides). The position transform is filled in once the layout is fitted to some geometry
+void compressVertexLayout(VertexLayout* layout, const VertexCompression& compression);
+
+// Switches a single attribute back to plain floats (and recomputes the offsets and strides)
+void decompressVertexAttribute(VertexLayout* layout, VertexAttribute attribute);
+
+// Fits the layout to a particular set of streams: removes any attribute the streams don't have
+// data for (and recomputes the offsets and strides) and computes the position dequantization
+// transform from the mesh bounds
+VertexLayout restrictVertexLayout(const VertexLayout& layout, const VertexStreams& streams);
+
+// Packs the streams into the layout's buffers, buffers must have room for layout.bufferCount entries
+void packVertexLayout(const VertexLayout& layout, const VertexStreams& streams,
+                      std::vector<unsigned char>* buffers);
+size_t vertexLayoutSize(const VertexLayout& layout, int vertexCount);
+
+// Decodes packed buffers and compares them against the streams they were packed from
+VertexLayoutError measureVertexLayoutError(const VertexLayout& layout, const VertexStreams& streams,
+                                           const std::vector<unsigned char>* buffers);
+
+// True if every attribute is stored as plain floats, so the streams can be uploaded as they are
+bool isUncompressedVertexLayout(const VertexLayout& layout);
+
+void decodeOctahedral(const short* encoded, float* vector);
+
+// Sets up the attribute pointers (and enables the attributes) for the currently bound VAO
+void bindVertexLayout(const VertexLayout& layout, const GLuint* buffers);
+
+#endif